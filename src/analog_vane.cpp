@@ -0,0 +1,90 @@
+#include "analog_vane.h"
+
+#include "driver/adc.h"
+#include "esp_idf_version.h"
+
+// The continuous mode API of the ESP32 came with IDF 4.4 (arduino-esp32 2.0.x),
+// older cores cannot sample the vane. The bit width is the ESP32's 12 bits in
+// case the soc caps of the core do not define it.
+#define ADC_DIGI_API (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 4, 0))
+#ifndef SOC_ADC_DIGI_MAX_BITWIDTH
+#define SOC_ADC_DIGI_MAX_BITWIDTH 12
+#endif
+
+void AnalogVane::set_dead_zone(int dead_zone) {
+  uint32_t span = (65536ul * (360 - dead_zone)) / 360;
+  scale_ = (span << 12) / (kRailHigh - kRailLow);
+  dead_phase_ = (uint16_t)(span + (65536ul - span) / 2);
+}
+
+bool AnalogVane::begin() {
+#if ADC_DIGI_API
+  int channel = digitalPinToAnalogChannel(pin_);
+  if ((channel < 0) || (channel > 7)) return false;
+
+  adc_digi_init_config_t init_config = {};
+  init_config.max_store_buf_size = 2048;
+  init_config.conv_num_each_intr = 256;
+  init_config.adc1_chan_mask = 1ul << channel;
+  if (adc_digi_initialize(&init_config) != ESP_OK) return false;
+
+  adc_digi_pattern_config_t pattern = {};
+  pattern.atten = ADC_ATTEN_DB_11;
+  pattern.channel = channel;
+  pattern.unit = 0;  // ADC1
+  pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+  adc_digi_configuration_t config = {};
+  config.conv_limit_en = true;  // Required on the ESP32
+  config.conv_limit_num = 250;
+  config.pattern_num = 1;
+  config.adc_pattern = &pattern;
+  config.sample_freq_hz = kSampleRate;
+  config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+  if (adc_digi_controller_configure(&config) != ESP_OK) return false;
+
+  return adc_digi_start() == ESP_OK;
+#else
+  return false;
+#endif
+}
+
+void AnalogVane::update() {
+#if ADC_DIGI_API
+  uint8_t buf[kMaxBatch * sizeof(adc_digi_output_data_t)];
+  int count = 0;
+  uint32_t length = 0;
+
+  // Read whatever is buffered without waiting, at most one batch
+  while ((count < kMaxBatch) &&
+         (adc_digi_read_bytes(buf, (kMaxBatch - count) * sizeof(adc_digi_output_data_t),
+                              &length, 0) == ESP_OK)) {
+    if (length == 0) break;
+    adc_digi_output_data_t* data = (adc_digi_output_data_t*)buf;
+    for (uint32_t i = 0; i < length / sizeof(adc_digi_output_data_t); i++) {
+      batch_[count++] = data[i].type1.data;
+    }
+  }
+
+  if (count > 0) add_batch(batch_, count);
+#endif
+}
+
+void AnalogVane::add_batch(const uint16_t* samples, int count) {
+  uint16_t reference = to_phase(samples[0]);
+  int32_t sum = 0;
+  int dead = 0;
+  for (int i = 0; i < count; i++) {
+    // Not by the phase, a live sample can map to that of the dead zone
+    if (is_dead(samples[i])) dead++;
+    uint16_t phase = to_phase(samples[i]);
+    // Difference to the first sample, wrapped into -180 to +180 degrees
+    sum += (int16_t)(phase - reference);
+  }
+
+  phase_ = reference + (int16_t)(sum / count);
+  dead_share_ = (float)dead / count;
+  raw_ = samples[count - 1];
+  batches_++;
+}
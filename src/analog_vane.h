@@ -0,0 +1,95 @@
+#ifndef ANALOG_VANE_H_
+#define ANALOG_VANE_H_
+
+#include "Arduino.h"
+
+/**
+ * @brief Reads a potentiometer or hall wind vane with the ADC in continuous
+ * (DMA) mode.
+ *
+ * The ADC samples the vane at kSampleRate into DMA buffers without any CPU
+ * involvement. update() drains the buffers from the main loop and decimates
+ * them into one direction phase per call, so the CPU cost is constant and
+ * independent of the wind speed.
+ *
+ * The vane covers 360 degrees minus its dead zone over the ADC range. Inside
+ * the dead zone the wiper is open and the input sits at a rail; samples in
+ * the bands next to the rails count as the middle of the dead zone, and as
+ * dead in get_dead_share(). The samples of a batch are averaged
+ * as phase differences to its first sample, which is wrap-safe around north
+ * as long as the vane turns less than 180 degrees within a batch.
+ *
+ * Only ADC1 pins (GPIO 32 to 39) can be used, ADC2 is taken by WiFi.
+ */
+class AnalogVane {
+ public:
+  static const uint32_t kSampleRate = 20000;  ///< Hz, the ESP32 minimum
+
+  /**
+   * @param pin ADC1 input of the vane
+   * @param dead_zone Dead zone of the vane in degrees, at the top of the
+   *   range
+   */
+  AnalogVane(uint8_t pin, int dead_zone) : pin_(pin) {
+    set_dead_zone(dead_zone);
+  }
+
+  /// Dead zone in degrees, when the vane is changed
+  void set_dead_zone(int dead_zone);
+
+  /// Start the continuous conversion, false if the ADC could not be set up
+  bool begin();
+
+  /// Drain the DMA buffers, call regularly (at least every 20 ms)
+  void update();
+
+  /**
+   * @brief Average a batch of raw 12-bit readings into the phase.
+   *
+   * Public so that recorded or generated readings can be fed without an ADC.
+   */
+  void add_batch(const uint16_t* samples, int count);
+
+  /**
+   * @brief Direction of the last batch, 65536 per turn, clockwise from the
+   * start of the vane's range.
+   */
+  uint16_t get_phase() { return phase_; }
+
+  /// A batch has been decoded since begin()
+  bool ready() { return batches_ > 0; }
+
+  /// Share of the last batch inside the dead zone, 0 to 1
+  float get_dead_share() { return dead_share_; }
+
+  uint32_t get_batches() { return batches_; }
+
+  /// Last raw 12-bit reading of the last batch
+  uint16_t get_raw() { return raw_; }
+
+ protected:
+  static const uint16_t kRailLow = 8;
+  static const uint16_t kRailHigh = 4087;
+  static const int kMaxBatch = 256;
+
+  /// In the dead band next to a rail, which no position of the wiper gives
+  static bool is_dead(uint16_t raw) {
+    return (raw < kRailLow) || (raw > kRailHigh);
+  }
+
+  uint16_t to_phase(uint16_t raw) {
+    if (is_dead(raw)) return dead_phase_;
+    return (uint16_t)(((uint32_t)(raw - kRailLow) * scale_) >> 12);
+  }
+
+  uint8_t pin_;
+  uint32_t scale_;       // Phase per ADC count, Q12
+  uint16_t dead_phase_;  // Middle of the dead zone
+  uint16_t phase_ = 0;
+  uint16_t raw_ = 0;
+  uint32_t batches_ = 0;
+  float dead_share_ = 0;
+  uint16_t batch_[kMaxBatch];
+};
+
+#endif  // ANALOG_VANE_H_
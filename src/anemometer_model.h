@@ -0,0 +1,143 @@
+#ifndef ANEMOMETER_MODEL_H_
+#define ANEMOMETER_MODEL_H_
+
+/**
+ * @file anemometer_model.h
+ * @brief Traits of the supported masthead units.
+ *
+ * The processing in main.cpp is a template on one of these models, so the
+ * calibration curve and limits compile to constants and there is no runtime
+ * dispatch per revolution. Select the model with the build flag
+ * ANEMOMETER_MODEL (see platformio.ini), PeetBrosPro by default.
+ *
+ * Each model provides:
+ * - kPulsesPerRevolution: speed pulses per rotor revolution
+ * - kDirection: how the vane reports the direction
+ * - kRotor: true for cup rotors, which overspeed in gusts
+ * - kMaxSpeed: highest plausible speed in cm/s, readings above are rejected
+ * - kVaneDeadZone: dead zone of an analog vane in degrees
+ * - kReedSwitch: the speed pulses come from a reed switch, which bounces
+ * - kDebounce: minimum time between two pulses of an input in microseconds
+ * - kStormRate, kSaneRate: input edge rates of the storm guard, see WindLimits
+ * - kBand0, kBand1 and the deviation limits per band, see WindLimits
+ * - calibrate(rps): speed in cm/s from revolutions per 100 s
+ */
+
+enum DirectionEncoding {
+  kPhasePulse,  ///< Direction pulse, its phase in the revolution is the angle
+  kAnalogVane   ///< Potentiometer or hall vane on an ADC input
+};
+
+/**
+ * @brief Plausibility limits shared by the models.
+ *
+ * Speeds are in cm/s. A new reading is only used if it deviates from the
+ * previous one by less than the limit of its speed band; the direction
+ * limits are tighter at high speed, where the vane moves less per update.
+ */
+struct WindLimits {
+  static const int kBand0 = 5 * 100;  ///< Band 0: 0 to 5 m/s
+  static const int kBand1 = 40 * 100; ///< Band 1: 5 to 40 m/s, band 2 above
+
+  static const int kSpeedDevLimit0 = 5 * 100;
+  static const int kSpeedDevLimit1 = 10 * 100;
+  static const int kSpeedDevLimit2 = 30 * 100;
+
+  static const int kDirDevLimit0 = 25;
+  static const int kDirDevLimit1 = 18;
+  static const int kDirDevLimit2 = 10;
+
+  static const int kVaneDeadZone = 0;
+  static const bool kReedSwitch = true;
+
+  // A reed switch bounces for a few ms, and cup rotors stay below 100
+  // revolutions/s. The storm guard masks the interrupts above kStormRate
+  // edges/s on either input, and re-arms them once the rate has dropped to
+  // kSaneRate, which has to be above the rate at kMaxSpeed. The rates are
+  // counted by the pulse counters, whose glitch filter passes reed bounce,
+  // so kStormRate leaves room for a few bounces per pulse.
+  static const unsigned long kDebounce = 10000ul;
+  static const unsigned long kStormRate = 500ul;
+  static const unsigned long kSaneRate = 150ul;
+};
+
+/**
+ * @brief Peet Bros. ULTIMETER PRO anemometer.
+ *
+ * One speed and one direction pulse per revolution. The calibration follows
+ * the Peet Bros. piecemeal calibration data.
+ */
+struct PeetBrosPro : WindLimits {
+  static const int kPulsesPerRevolution = 1;
+  static const DirectionEncoding kDirection = kPhasePulse;
+  static const bool kRotor = true;
+  static const long kMaxSpeed = 80 * 100;
+
+  static long calibrate(long rps) {
+    if (rps < 323) {
+      return (rps * rps * -11) / 22369 + (293 * rps) / 223 - 12;
+    } else if (rps < 5436) {
+      return (rps * rps / 2) / 22369 + (220 * rps) / 223 + 96;
+    } else {
+      return (rps * rps * 11) / 22369 - (957 * rps) / 223 + 28664;
+    }
+  }
+};
+
+/**
+ * @brief Davis 6410 anemometer.
+ *
+ * A reed switch closes once per revolution, 2.25 mph per revolution per
+ * second. The vane is a 20 kOhm potentiometer with a dead zone near north.
+ */
+struct Davis6410 : WindLimits {
+  static const int kPulsesPerRevolution = 1;
+  static const DirectionEncoding kDirection = kAnalogVane;
+  static const bool kRotor = true;
+  static const long kMaxSpeed = 89 * 100;
+  static const int kVaneDeadZone = 10;
+
+  static long calibrate(long rps) { return (rps * 1006) / 1000; }
+};
+
+/**
+ * @brief Inspeed Vortex anemometer with e-Vane.
+ *
+ * One pulse per revolution, 2.5 mph per revolution per second. The e-Vane
+ * is a ratiometric hall sensor without a dead zone.
+ */
+struct InspeedVortex : WindLimits {
+  static const int kPulsesPerRevolution = 1;
+  static const DirectionEncoding kDirection = kAnalogVane;
+  static const bool kRotor = true;
+  static const long kMaxSpeed = 56 * 100;
+
+  static long calibrate(long rps) { return (rps * 1118) / 1000; }
+};
+
+/**
+ * @brief Ultrasonic sensor emulating a cup anemometer.
+ *
+ * The speed output is 10 Hz per m/s and the direction pulse follows each
+ * speed pulse at the phase of the angle, as with the Peet Bros. There is no
+ * rotor, so no overspeed, and the speed can change faster.
+ */
+struct UltrasonicPulse : WindLimits {
+  static const int kPulsesPerRevolution = 1;
+  static const DirectionEncoding kDirection = kPhasePulse;
+  static const bool kRotor = false;
+  static const long kMaxSpeed = 60 * 100;
+
+  static const int kSpeedDevLimit0 = 10 * 100;
+  static const int kSpeedDevLimit1 = 20 * 100;
+
+  // 600 pulses/s at kMaxSpeed, from a push-pull output that does not bounce
+  static const bool kReedSwitch = false;
+  static const unsigned long kDebounce = 1000ul;
+  static const unsigned long kStormRate = 2500ul;
+  static const unsigned long kSaneRate = 800ul;
+
+  static long calibrate(long rps) { return rps / 10; }
+};
+
+#endif  // ANEMOMETER_MODEL_H_
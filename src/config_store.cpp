@@ -0,0 +1,151 @@
+#include "config_store.h"
+
+#include "SPIFFS.h"
+#include "sensesp/system/hash.h"
+
+namespace {
+
+// Delete the file Configurable::load_configuration() reads, under any of the
+// names it looks for
+void remove_config_file(const String& config_path) {
+  String hash_path = String("/") + Base64Sha1(config_path);
+  String paths[] = {hash_path, hash_path + "\n", config_path};
+  for (const String& path : paths) {
+    if (SPIFFS.exists(path.c_str())) SPIFFS.remove(path.c_str());
+  }
+}
+
+}  // namespace
+
+ConfigStore* ConfigStore::instance_ = nullptr;
+
+bool ConfigStore::begin() {
+  instance_ = this;
+  unsigned long start = micros();
+
+  String tmp_path = String(path_) + ".tmp";
+  const char* path = path_;
+  if (!SPIFFS.exists(path)) {
+    if (!SPIFFS.exists(tmp_path.c_str())) return false;
+    path = tmp_path.c_str();
+  }
+
+  File file = SPIFFS.open(path, "r");
+  if (!file) return false;
+  DeserializationError error = deserializeMsgPack(doc_, file);
+  file.close();
+  if (error) {
+    doc_.clear();
+    return false;
+  }
+
+  load_us_ = micros() - start;
+  return true;
+}
+
+JsonObject ConfigStore::get(const String& key) {
+  return doc_[key].as<JsonObject>();
+}
+
+void ConfigStore::put(const String& key, Configurable* configurable) {
+  doc_.remove(key);
+  JsonObject config = doc_.createNestedObject(key);
+  configurable->get_configuration(config);
+  dirty_ = true;
+
+  // Replaced values are not freed in the document's pool
+  if (doc_.memoryUsage() > doc_.capacity() * 3 / 4) doc_.garbageCollect();
+}
+
+bool ConfigStore::save() {
+  if (!dirty_) return true;
+
+  String tmp_path = String(path_) + ".tmp";
+  File file = SPIFFS.open(tmp_path.c_str(), "w");
+  if (!file) return false;
+  size_t written = serializeMsgPack(doc_, file);
+  file.close();
+  if (written == 0) return false;
+
+  // SPIFFS can't rename onto an existing file
+  SPIFFS.remove(path_);
+  if (!SPIFFS.rename(tmp_path.c_str(), path_)) return false;
+  dirty_ = false;
+  writes_++;
+
+  // The migrated settings are safe in the store now
+  for (int i = 0; i < migrated_count_; i++) {
+    remove_config_file(migrated_[i]->config_path_);
+  }
+  migrated_count_ = 0;
+  return true;
+}
+
+void ConfigStore::migrated(Configurable* configurable) {
+  if (migrated_count_ < kMaxMarked) migrated_[migrated_count_++] = configurable;
+}
+
+void ConfigStore::mark(Configurable* configurable) {
+  unsigned long now = millis();
+  portENTER_CRITICAL(&mux_);
+  write_behind_.mark(now);
+  bool found = false;
+  for (int i = 0; i < marked_count_; i++) {
+    if (marked_[i] == configurable) found = true;
+  }
+  if (!found && (marked_count_ < kMaxMarked)) {
+    marked_[marked_count_++] = configurable;
+  }
+  portEXIT_CRITICAL(&mux_);
+}
+
+bool ConfigStore::is_due(unsigned long now) {
+  portENTER_CRITICAL(&mux_);
+  bool due = write_behind_.is_due(now, dirty_);
+  portEXIT_CRITICAL(&mux_);
+  return due;
+}
+
+bool ConfigStore::flush() {
+  Configurable* marked[kMaxMarked];
+  portENTER_CRITICAL(&mux_);
+  int count = marked_count_;
+  for (int i = 0; i < count; i++) marked[i] = marked_[i];
+  marked_count_ = 0;
+  write_behind_.take();
+  portEXIT_CRITICAL(&mux_);
+
+  // A failed save leaves the settings dirty, is_due() retries it
+  for (int i = 0; i < count; i++) put(marked[i]->config_path_, marked[i]);
+  bool saved = save();
+
+  portENTER_CRITICAL(&mux_);
+  write_behind_.written(saved, millis());
+  portEXIT_CRITICAL(&mux_);
+  return saved;
+}
+
+bool StoredConfigurable::load_configuration() {
+  ConfigStore* store = ConfigStore::get_instance();
+  if (store == nullptr) return Configurable::load_configuration();
+
+  JsonObject config = store->get(config_path_);
+  if (!config.isNull()) return set_configuration(config);
+
+  // Not in the store yet, take it over from its own file
+  unsigned long start = micros();
+  bool loaded = Configurable::load_configuration();
+  store->count_file_read(micros() - start);
+  store->put(config_path_, this);
+  if (loaded) store->migrated(this);
+  return loaded;
+}
+
+void StoredConfigurable::save_configuration() {
+  ConfigStore* store = ConfigStore::get_instance();
+  if (store == nullptr) {
+    Configurable::save_configuration();
+    return;
+  }
+  store->mark(this);
+}
@@ -0,0 +1,125 @@
+#ifndef CONFIG_STORE_H_
+#define CONFIG_STORE_H_
+
+#include "sensesp.h"
+#include "sensesp/system/configurable.h"
+#include "write_behind.h"
+
+using namespace sensesp;
+
+/**
+ * @brief All settings of the firmware in a single MessagePack file.
+ *
+ * Each Configurable otherwise reads and writes its own SPIFFS file, so the
+ * boot time grows with every setting. The store reads its file once at boot
+ * and keeps the settings in RAM, keyed by config path. A save rewrites the
+ * whole file under a temporary name and renames it into place; begin()
+ * falls back to the temporary file if a save was interrupted before the
+ * rename.
+ *
+ * Changed settings are only marked, from any task (the web UI runs in the
+ * AsyncTCP task), and written behind by flush() from the main loop once no
+ * setting changed for quiet_ms, or max_ms after the first change. Rapid edits
+ * coalesce into one write. A failed write is retried with a backoff (see
+ * WriteBehind) until it succeeds. The flash cache is disabled during a write, which
+ * defers the GPIO interrupts, so the caller should discard what was measured
+ * across it.
+ *
+ * Only the settings derived from StoredConfigurable live in the store, the
+ * SensESP system settings (WiFi, server) keep their own files.
+ */
+class ConfigStore {
+ public:
+  /**
+   * @param path File of the settings
+   * @param capacity Bytes of RAM for the settings
+   * @param quiet_ms Write once no setting changed for this long
+   * @param max_ms Write at the latest this long after the first change
+   * @param max_retry_ms Longest wait between the retries of a failed write
+   */
+  ConfigStore(const char* path, size_t capacity, unsigned long quiet_ms,
+              unsigned long max_ms, unsigned long max_retry_ms)
+      : path_(path),
+        doc_(capacity),
+        write_behind_(quiet_ms, max_ms, max_retry_ms) {}
+
+  /// Read the file and make this the store of all StoredConfigurables
+  bool begin();
+
+  static ConfigStore* get_instance() { return instance_; }
+
+  /// The stored configuration at key, a null object if there is none
+  JsonObject get(const String& key);
+
+  /// Store the current configuration of a Configurable, in RAM only
+  void put(const String& key, Configurable* configurable);
+
+  /// Write the settings if anything changed since the last save
+  bool save();
+
+  bool is_dirty() { return dirty_; }
+
+  /// Queue a Configurable to be stored and written, safe from any task
+  void mark(Configurable* configurable);
+
+  /// A write of the marked settings, or the retry of a failed one, is due
+  bool is_due(unsigned long now);
+
+  /// Store the marked settings and write them, from the main loop only
+  bool flush();
+
+  /// Delete the own file of a setting once the store holds it on flash
+  void migrated(Configurable* configurable);
+
+  /// Record a setting read from its own file, for the boot time comparison
+  void count_file_read(unsigned long us) {
+    file_reads_++;
+    file_read_us_ += us;
+  }
+
+  int get_file_reads() { return file_reads_; }
+  unsigned long get_file_read_us() { return file_read_us_; }
+  unsigned long get_load_us() { return load_us_; }
+  int get_settings() { return doc_.size(); }
+  uint32_t get_writes() { return writes_; }
+
+ protected:
+  static ConfigStore* instance_;
+
+  const char* path_;
+  DynamicJsonDocument doc_;
+  bool dirty_ = false;
+  unsigned long load_us_ = 0;
+  int file_reads_ = 0;
+  unsigned long file_read_us_ = 0;
+  uint32_t writes_ = 0;
+
+  // More than the settings of the firmware, so a mark is never lost
+  static const int kMaxMarked = 32;
+
+  portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+  Configurable* marked_[kMaxMarked];
+  int marked_count_ = 0;
+  WriteBehind write_behind_;
+
+  // Settings taken over from their own files, until a save succeeds
+  Configurable* migrated_[kMaxMarked];
+  int migrated_count_ = 0;
+};
+
+/**
+ * @brief Configurable kept in the ConfigStore.
+ *
+ * A setting that is not in the store yet is read from its own file once and
+ * then moves into the store with the next save, which deletes the file.
+ */
+class StoredConfigurable : public Configurable {
+ public:
+  StoredConfigurable(String config_path, String description, int sort_order)
+      : Configurable(config_path, description, sort_order) {}
+
+  virtual bool load_configuration() override;
+  virtual void save_configuration() override;
+};
+
+#endif  // CONFIG_STORE_H_
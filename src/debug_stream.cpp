@@ -0,0 +1,36 @@
+#include "debug_stream.h"
+
+#include <string.h>
+
+void DebugStream::add(const DebugFrame& frame) {
+  if (count_ < kMaxFrames) {
+    frames_[count_++] = frame;
+  } else {
+    if (dropped_ < UINT16_MAX) dropped_++;
+    dropped_total_++;
+  }
+}
+
+size_t DebugStream::serialize(uint8_t* buffer) {
+  buffer[0] = kVersion;
+  buffer[1] = count_;
+  buffer[2] = dropped_ & 0xff;
+  buffer[3] = dropped_ >> 8;
+  // The ESP32 is little-endian, so the packed frames are copied as they are
+  memcpy(buffer + kHeaderSize, frames_, count_ * sizeof(DebugFrame));
+  size_t size = message_size();
+  clear();
+  return size;
+}
+
+void DebugStream::clear() {
+  count_ = 0;
+  dropped_ = 0;
+}
+
+void DebugStream::drop_pending() {
+  dropped_total_ += count_;
+  uint32_t dropped = (uint32_t)dropped_ + count_;
+  count_ = 0;
+  dropped_ = (dropped < UINT16_MAX) ? dropped : UINT16_MAX;
+}
@@ -0,0 +1,81 @@
+#ifndef DEBUG_STREAM_H_
+#define DEBUG_STREAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief One processed revolution, as streamed to the debug chart.
+ *
+ * All fields are little-endian, the layout is part of the stream format.
+ */
+struct __attribute__((packed)) DebugFrame {
+  uint32_t speed_pulse;     ///< micros() of the speed pulse
+  uint32_t speed_time;      ///< Revolution period in us, 0 when stalled
+  uint32_t direction_time;  ///< Direction pulse after the speed pulse, us
+  uint16_t phase;           ///< Direction phase, 65536 per turn
+  uint16_t cmps;            ///< Calibrated speed in cm/s
+  uint16_t direction;       ///< Measured direction in degrees
+  uint16_t speed_out;       ///< Speed filter output in cm/s
+  uint16_t dir_out;         ///< Direction filter output in degrees
+  uint8_t stages;           ///< Stages passed, the one at this index rejected it
+  uint8_t flags;            ///< DebugFlags
+};
+
+enum DebugFlags {
+  kIgnoreNext = 1,     ///< The next reading will be ignored
+  kStorm = 2,          ///< An interrupt storm is active
+  kAnalogVaneFlag = 4, ///< The direction is from the analog vane
+  kPassed = 8          ///< No stage rejected the revolution
+};
+
+/**
+ * @brief Collects revolutions for the debug chart between two messages.
+ *
+ * Frames are added from the main loop and serialized once per message,
+ * which all clients then share. At most kMaxFrames are held; the rest are
+ * only counted, so the rate and memory of the stream stay bounded however
+ * fast the rotor turns.
+ *
+ * A message is a 4 byte header (version, frame count, frames dropped since
+ * the previous message as uint16) followed by the frames.
+ */
+class DebugStream {
+ public:
+  static const uint8_t kVersion = 1;
+  static const uint8_t kMaxFrames = 32;
+  static const size_t kHeaderSize = 4;
+  static const size_t kMaxMessageSize =
+      kHeaderSize + kMaxFrames * sizeof(DebugFrame);
+
+  void add(const DebugFrame& frame);
+
+  bool empty() { return (count_ == 0) && (dropped_ == 0); }
+
+  size_t message_size() { return kHeaderSize + count_ * sizeof(DebugFrame); }
+
+  /**
+   * @brief Write the pending frames as one message and start a new one.
+   *
+   * @param buffer At least message_size() bytes
+   * @return Bytes written
+   */
+  size_t serialize(uint8_t* buffer);
+
+  /// Forget the pending frames, e.g. when nobody listens
+  void clear();
+
+  /// Frames not sent since boot, because of the frame limit or slow clients
+  uint32_t get_dropped_total() { return dropped_total_; }
+
+  /// Count the pending frames as dropped, when the clients can not keep up
+  void drop_pending();
+
+ protected:
+  DebugFrame frames_[kMaxFrames];
+  uint8_t count_ = 0;
+  uint16_t dropped_ = 0;
+  uint32_t dropped_total_ = 0;
+};
+
+#endif  // DEBUG_STREAM_H_
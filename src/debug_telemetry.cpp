@@ -0,0 +1,132 @@
+#include "debug_telemetry.h"
+
+#include <string.h>
+
+namespace {
+
+const int32_t kPow10[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+}  // namespace
+
+void DebugTelemetry::begin_record() {
+  length_ = 0;
+  fields_ = 0;
+  overflow_ = false;
+  if (binary_) {
+    // Sync bytes and the field count, filled in by end_record()
+    line_[0] = kSync0;
+    line_[1] = kSync1;
+    line_[2] = 0;
+    length_ = 3;
+  }
+}
+
+void DebugTelemetry::add(const char* key, int32_t value) {
+  add_field(key, value, 0);
+}
+
+void DebugTelemetry::add(const char* key, float value, uint8_t decimals) {
+  if (decimals > 6) decimals = 6;
+  float scaled = value * kPow10[decimals];
+  add_field(key, (int32_t)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f),
+            decimals);
+}
+
+void DebugTelemetry::add_field(const char* key, int32_t scaled,
+                               uint8_t decimals) {
+  if (overflow_) return;
+
+  if (binary_) {
+    if ((fields_ >= kMaxFields) || (length_ + 4 + 1 > kLineSize)) {
+      overflow_ = true;
+      return;
+    }
+    uint32_t bits = (uint32_t)scaled;
+    for (int i = 0; i < 4; i++) line_[length_++] = (bits >> (8 * i)) & 0xff;
+    fields_++;
+    return;
+  }
+
+  append(key);
+  append(": ");
+  uint32_t magnitude = (uint32_t)scaled;
+  if (scaled < 0) {
+    append_char('-');
+    magnitude = 0u - magnitude;
+  }
+  append_int(magnitude / kPow10[decimals], 1);
+  if (decimals > 0) {
+    append_char('.');
+    append_int(magnitude % kPow10[decimals], decimals);
+  }
+  append_char(',');
+  fields_++;
+}
+
+void DebugTelemetry::append(const char* text) {
+  while (*text != '\0') append_char(*text++);
+}
+
+void DebugTelemetry::append_char(char c) {
+  // Keep one byte for the newline
+  if (length_ + 1 >= kLineSize) {
+    overflow_ = true;
+    return;
+  }
+  line_[length_++] = c;
+}
+
+void DebugTelemetry::append_int(uint32_t value, uint8_t min_digits) {
+  char digits[10];
+  uint8_t count = 0;
+  do {
+    digits[count++] = '0' + value % 10;
+    value /= 10;
+  } while (value > 0);
+  while (count < min_digits) digits[count++] = '0';
+  while (count > 0) append_char(digits[--count]);
+}
+
+void DebugTelemetry::end_record() {
+  if (overflow_ || (fields_ == 0)) {
+    dropped_++;
+    return;
+  }
+
+  if (binary_) {
+    line_[2] = fields_;
+    uint8_t sum = 0;
+    for (size_t i = 2; i < length_; i++) sum += line_[i];
+    line_[length_++] = sum;
+  } else {
+    // Replace the separator after the last field
+    line_[length_ - 1] = '\n';
+  }
+
+  if (kQueueSize - (head_ - tail_) < length_) {
+    dropped_++;
+    return;
+  }
+  for (size_t i = 0; i < length_; i++) {
+    queue_[(head_ + i) & (kQueueSize - 1)] = line_[i];
+  }
+  head_ += length_;
+  queued_++;
+}
+
+void DebugTelemetry::pump() {
+  while (head_ != tail_) {
+    int room = port_->availableForWrite();
+    if (room <= 0) return;
+
+    // Up to the end of the queue, the wrapped part goes in the next pass
+    size_t offset = tail_ & (kQueueSize - 1);
+    size_t chunk = head_ - tail_;
+    if (chunk > kQueueSize - offset) chunk = kQueueSize - offset;
+    if (chunk > (size_t)room) chunk = room;
+
+    size_t written = port_->write(&queue_[offset], chunk);
+    if (written == 0) return;
+    tail_ += written;
+  }
+}
@@ -0,0 +1,74 @@
+#ifndef DEBUG_TELEMETRY_H_
+#define DEBUG_TELEMETRY_H_
+
+#include <Arduino.h>
+#include <stdint.h>
+
+/**
+ * @brief Debug records on a serial port, without blocking the main loop.
+ *
+ * A record is formatted once into a preallocated line buffer and then
+ * appended to a transmit queue as a whole, or dropped as a whole if the
+ * queue has no room for it. pump() hands the port only as many bytes as it
+ * can take without waiting, so a slow or disconnected port costs dropped
+ * records rather than main loop time.
+ *
+ * Text records are "key: value," pairs ending in a newline, the format of
+ * the Arduino Serial Plotter. Binary records are compact frames for a
+ * logger on the host:
+ *
+ *   0xA5 0x5A, field count n, n little-endian int32 values, checksum
+ *
+ * where each value is the field times 10^decimals, in the order the fields
+ * were added, and the checksum is the sum of the count and value bytes,
+ * modulo 256. The text mode of the same firmware names the fields;
+ * tools/debug_frames.py decodes and plots the frames on the host.
+ */
+class DebugTelemetry {
+ public:
+  static const size_t kLineSize = 256;
+  static const size_t kQueueSize = 1024;  ///< Bytes, a power of two
+  static const uint8_t kMaxFields = 32;
+  static const uint8_t kSync0 = 0xA5;
+  static const uint8_t kSync1 = 0x5A;
+
+  explicit DebugTelemetry(Print* port) : port_(port) {}
+
+  /// Binary frames instead of text lines, from the next record on
+  void set_binary(bool binary) { binary_ = binary; }
+
+  void begin_record();
+  void add(const char* key, int32_t value);
+  /// A fixed point field, rounded to decimals (at most 6) places
+  void add(const char* key, float value, uint8_t decimals);
+  /// Queue the record, or drop it if the queue has no room
+  void end_record();
+
+  /// Write what the port takes without blocking. Call it often.
+  void pump();
+
+  /// Records dropped because the queue was full
+  uint32_t get_dropped() { return dropped_; }
+  uint32_t get_queued() { return queued_; }
+
+ protected:
+  void add_field(const char* key, int32_t scaled, uint8_t decimals);
+  void append(const char* text);
+  void append_char(char c);
+  void append_int(uint32_t value, uint8_t min_digits);
+
+  Print* port_;
+  bool binary_ = false;
+  bool overflow_ = false;     ///< The record did not fit the line buffer
+  uint8_t fields_ = 0;
+  size_t length_ = 0;
+  uint8_t line_[kLineSize];
+
+  uint8_t queue_[kQueueSize];
+  uint32_t head_ = 0;         ///< Bytes queued since boot
+  uint32_t tail_ = 0;         ///< Bytes written since boot
+  uint32_t dropped_ = 0;
+  uint32_t queued_ = 0;
+};
+
+#endif  // DEBUG_TELEMETRY_H_
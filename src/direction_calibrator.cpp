@@ -0,0 +1,109 @@
+#include "direction_calibrator.h"
+
+#include <math.h>
+
+static const double kDegToRad = 0.0174533;
+// Weight, per sample, of the prior that non-linearity and true wind are 0
+static const double kRidge = 0.01;
+static const uint32_t kMinSamples = 100;
+
+// Order of the unknowns
+enum { kCos, kSin, kSinAmplitude, kCosAmplitude, kTrueX, kTrueY };
+
+void DirectionCalibrator::start() {
+  for (int i = 0; i < kParams; i++) {
+    for (int j = 0; j < kParams; j++) {
+      ata_[i][j] = 0;
+    }
+    atb_[i] = 0;
+  }
+  samples_ = 0;
+}
+
+void DirectionCalibrator::add_row(const double* row, double rhs) {
+  for (int i = 0; i < kParams; i++) {
+    if (row[i] == 0) continue;
+    for (int j = 0; j < kParams; j++) {
+      ata_[i][j] += row[i] * row[j];
+    }
+    atb_[i] += row[i] * rhs;
+  }
+}
+
+void DirectionCalibrator::add(float direction, float sensor_angle,
+                              float speed, float heading, float stw) {
+  double ux = speed * cos(direction * kDegToRad);
+  double uy = speed * sin(direction * kDegToRad);
+  double sin_sensor = sin(sensor_angle * kDegToRad);
+  double cos_sensor = cos(sensor_angle * kDegToRad);
+  double ch = cos(heading);
+  double sh = sin(heading);
+
+  // Boat frame columns (forward, starboard), rotated by the heading below
+  double fx[kParams] = {ux, -uy, -uy * sin_sensor, -uy * cos_sensor, 0, 0};
+  double fy[kParams] = {uy, ux, ux * sin_sensor, ux * cos_sensor, 0, 0};
+  double row_x[kParams];
+  double row_y[kParams];
+  for (int i = 0; i < kParams; i++) {
+    row_x[i] = ch * fx[i] - sh * fy[i];
+    row_y[i] = sh * fx[i] + ch * fy[i];
+  }
+  row_x[kTrueX] = -1;
+  row_y[kTrueY] = -1;
+
+  add_row(row_x, ch * stw);
+  add_row(row_y, sh * stw);
+  samples_++;
+}
+
+bool DirectionCalibrator::solve(DirectionCalibration* result) {
+  if (samples_ < kMinSamples) return false;
+
+  double a[kParams][kParams + 1];
+  for (int i = 0; i < kParams; i++) {
+    for (int j = 0; j < kParams; j++) {
+      a[i][j] = ata_[i][j];
+    }
+    a[i][kParams] = atb_[i];
+  }
+  for (int i = kSinAmplitude; i <= kTrueY; i++) {
+    a[i][i] += kRidge * samples_;
+  }
+
+  // Gaussian elimination with partial pivoting
+  for (int col = 0; col < kParams; col++) {
+    int pivot = col;
+    for (int row = col + 1; row < kParams; row++) {
+      if (fabs(a[row][col]) > fabs(a[pivot][col])) pivot = row;
+    }
+    if (fabs(a[pivot][col]) < 1e-9) return false;
+    if (pivot != col) {
+      for (int j = 0; j <= kParams; j++) {
+        double t = a[col][j];
+        a[col][j] = a[pivot][j];
+        a[pivot][j] = t;
+      }
+    }
+    for (int row = col + 1; row < kParams; row++) {
+      double f = a[row][col] / a[col][col];
+      for (int j = col; j <= kParams; j++) {
+        a[row][j] -= f * a[col][j];
+      }
+    }
+  }
+  double x[kParams];
+  for (int i = kParams - 1; i >= 0; i--) {
+    double sum = a[i][kParams];
+    for (int j = i + 1; j < kParams; j++) {
+      sum -= a[i][j] * x[j];
+    }
+    x[i] = sum / a[i][i];
+  }
+
+  result->offset = atan2(x[kSin], x[kCos]) / kDegToRad;
+  result->speed_scale = sqrt(x[kCos] * x[kCos] + x[kSin] * x[kSin]);
+  result->sin_amplitude = x[kSinAmplitude] / kDegToRad;
+  result->cos_amplitude = x[kCosAmplitude] / kDegToRad;
+  result->true_wind = sqrt(x[kTrueX] * x[kTrueX] + x[kTrueY] * x[kTrueY]);
+  return true;
+}
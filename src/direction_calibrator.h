@@ -0,0 +1,73 @@
+#ifndef DIRECTION_CALIBRATOR_H_
+#define DIRECTION_CALIBRATOR_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Result of a direction calibration.
+ */
+struct DirectionCalibration {
+  float offset;         // Mounting offset, degrees
+  float sin_amplitude;  // Non-linearity, degrees, times sin(sensor angle)
+  float cos_amplitude;  // Non-linearity, degrees, times cos(sensor angle)
+  float speed_scale;    // Apparent wind speed scale error (1.0 = none)
+  float true_wind;      // Residual true wind during the run, m/s
+};
+
+/**
+ * @brief Fits the direction offset and non-linearity from a motoring run.
+ *
+ * Motoring in (near) calm conditions, the apparent wind is the boat's own
+ * motion plus a small, constant true wind. Rotated into the earth frame by
+ * the heading, apparent wind minus boat velocity must then be constant:
+ *
+ *   R(heading) * (R(d_offset) * u + e(sensor angle) * J * u - (stw, 0)) = T
+ *
+ * u being the apparent wind vector with the current correction applied, J a
+ * 90 degree rotation and e the first harmonic of the remaining
+ * non-linearity. With cos/sin of the residual offset as unknowns (their
+ * length is the speed scale) this is linear in all six unknowns, so each
+ * sample just adds to the normal equations (O(1), fixed memory) and solve()
+ * is a 6x6 elimination. The non-linearity and the true wind are weakly
+ * pulled towards zero, which keeps the fit stable on a single heading in a
+ * true calm, where only the offset is observable.
+ */
+class DirectionCalibrator {
+ public:
+  static const int kParams = 6;
+
+  /// Clear all samples and start a new fit
+  void start();
+
+  /**
+   * @brief Add a sample.
+   *
+   * @param direction Apparent wind angle with the current correction
+   *   applied, degrees
+   * @param sensor_angle Sensor angle the current non-linearity correction
+   *   was evaluated at, degrees
+   * @param speed Apparent wind speed, m/s
+   * @param heading Heading, radians
+   * @param stw Speed through water, m/s
+   */
+  void add(float direction, float sensor_angle, float speed, float heading,
+           float stw);
+
+  uint32_t get_samples() { return samples_; }
+
+  /**
+   * @brief Solve for the corrections to apply on top of the current ones.
+   *
+   * @return false if there are too few samples or the fit is singular
+   */
+  bool solve(DirectionCalibration* result);
+
+ protected:
+  void add_row(const double* row, double rhs);
+
+  double ata_[kParams][kParams];
+  double atb_[kParams];
+  uint32_t samples_ = 0;
+};
+
+#endif  // DIRECTION_CALIBRATOR_H_
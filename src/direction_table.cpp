@@ -0,0 +1,46 @@
+#include "direction_table.h"
+
+void DirectionTable::set_points(int points) {
+  points_ = (points == 72) ? 72 : 36;
+  for (int i = 0; i < kMaxPoints; i++) {
+    table_[i] = 0;
+  }
+}
+
+bool DirectionTable::fit(const uint16_t* measured, const uint16_t* reference,
+                         int count) {
+  if (count < 1) return false;
+
+  for (int i = 0; i < points_; i++) {
+    uint16_t phase = (uint16_t)(((uint32_t)i << 16) / points_);
+
+    // Nearest pairs below and above the point, in circular distance
+    int below = 0;
+    int above = 0;
+    uint16_t below_dist = 0xffff;
+    uint16_t above_dist = 0xffff;
+    for (int k = 0; k < count; k++) {
+      uint16_t d_below = phase - measured[k];
+      uint16_t d_above = measured[k] - phase;
+      if (d_below < below_dist) {
+        below_dist = d_below;
+        below = k;
+      }
+      if ((d_above > 0) && (d_above < above_dist)) {
+        above_dist = d_above;
+        above = k;
+      }
+    }
+
+    int16_t c_below = (int16_t)(reference[below] - measured[below]);
+    int16_t c_above = (int16_t)(reference[above] - measured[above]);
+    uint32_t span = (uint32_t)below_dist + above_dist;
+    if ((below_dist == 0) || (span == 0) || (count == 1)) {
+      table_[i] = c_below;
+    } else {
+      table_[i] = c_below + (int16_t)(((int32_t)(c_above - c_below) *
+                                       (int32_t)below_dist) / (int32_t)span);
+    }
+  }
+  return true;
+}
@@ -0,0 +1,73 @@
+#ifndef DIRECTION_TABLE_H_
+#define DIRECTION_TABLE_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Per-sensor direction linearization table.
+ *
+ * Magnet placement errors make the direction reed close slightly early or
+ * late, depending on the vane angle. The table holds the correction at 36
+ * or 72 evenly spaced sensor phases and interpolates between them,
+ * wrapping around at 360 degrees. Phases are in fixed point, 65536 being a
+ * full turn, so a lookup is a multiply, a shift and one interpolation.
+ */
+class DirectionTable {
+ public:
+  static const int kMaxPoints = 72;
+
+  DirectionTable() { set_points(36); }
+
+  /// Set the number of points (36 or 72) and clear the table
+  void set_points(int points);
+  int get_points() { return points_; }
+
+  /// Correction at a point, in phase units (65536 per turn)
+  int16_t get(int i) { return table_[i]; }
+  void set(int i, int16_t correction) { table_[i] = correction; }
+
+  /// Return the corrected phase, 65536 per turn
+  uint16_t correct(uint16_t phase) {
+    uint32_t pos = (uint32_t)phase * points_;  // Point index in the upper 16 bits
+    int i = pos >> 16;
+    int j = (i + 1 == points_) ? 0 : i + 1;
+    int32_t frac = pos & 0xffff;
+    int32_t correction =
+        table_[i] + (((int32_t)(table_[j] - table_[i]) * frac) >> 16);
+    return (uint16_t)(phase + correction);
+  }
+
+  /**
+   * @brief Fill the table from calibration pairs.
+   *
+   * The correction at each point is interpolated (circularly) between the
+   * pairs with the nearest measured phases on either side.
+   *
+   * @param measured Measured phases, 65536 per turn
+   * @param reference True phases, 65536 per turn
+   * @param count Number of pairs, at least 1
+   * @return false if there are no pairs
+   */
+  bool fit(const uint16_t* measured, const uint16_t* reference, int count);
+
+ protected:
+  int points_;
+  int16_t table_[kMaxPoints];
+};
+
+/**
+ * @brief Wind direction in degrees, 0 to 359, of a corrected sensor phase.
+ *
+ * The phase turns counterclockwise when the vane turns clockwise, so the
+ * offset is subtracted and the result reversed.
+ *
+ * @param phase Sensor phase, 65536 per turn
+ * @param offset Offset in degrees between device-north and the bow
+ */
+inline long phase_to_direction(uint16_t phase, int offset) {
+  long direction = (360 - ((long)(((uint32_t)phase * 360) >> 16) - offset)) % 360;
+  if (direction < 0) direction += 360;
+  return direction;
+}
+
+#endif  // DIRECTION_TABLE_H_
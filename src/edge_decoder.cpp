@@ -0,0 +1,72 @@
+#include "edge_decoder.h"
+
+EdgeDecoder::EdgeDecoder(uint8_t debounce_samples, bool active_high) {
+  if (debounce_samples < 1) {
+    debounce_samples = 1;
+  } else if (debounce_samples > 32) {
+    debounce_samples = 32;
+  }
+  debounce_samples_ = debounce_samples;
+  set_active_high(active_high);
+}
+
+void EdgeDecoder::reset(bool level) {
+  level_ = level;
+  prev_word_ = level ? 0xffffffff : 0;
+}
+
+void EdgeDecoder::set_active_high(bool active_high) {
+  active_high_ = active_high;
+  reset(!active_high);  // Idle between the pulses
+}
+
+// Return, for every bit of the upper half of x, the OR over that bit and
+// the span - 1 bits below it. Built up from windows of doubling length, so
+// it needs log2(span) shifts rather than span.
+static inline uint64_t window_or(uint64_t x, uint8_t span) {
+  uint64_t acc = 0;
+  uint64_t run = x;  // OR over windows of length len
+  uint8_t shift = 0;
+  for (uint8_t len = 1; len <= span; len <<= 1) {
+    if (span & len) {
+      acc |= run << shift;
+      shift += len;
+    }
+    run |= run << len;
+  }
+  return acc;
+}
+
+int EdgeDecoder::decode(uint32_t word, uint32_t first_sample, uint32_t* edges,
+                        int max_edges) {
+  if (first_sample != next_sample_) {
+    reset(level_);
+  }
+
+  // The previous word provides the history for runs crossing the boundary
+  uint64_t history = ((uint64_t)word << 32) | prev_word_;
+  uint32_t stable_low =
+      ~(uint32_t)(window_or(history, debounce_samples_) >> 32);
+  uint32_t stable_high =
+      ~(uint32_t)(window_or(~history, debounce_samples_) >> 32);
+
+  int count = 0;
+  uint32_t pending = 0xffffffff;  // Bits not yet passed by the walk
+  for (;;) {
+    uint32_t candidates = (level_ ? stable_low : stable_high) & pending;
+    if (candidates == 0) {
+      break;
+    }
+    int pos = __builtin_ctz(candidates);
+    level_ = !level_;
+    if ((level_ == active_high_) && (count < max_edges)) {
+      // The run completed at pos, it started debounce_samples - 1 earlier
+      edges[count++] = first_sample + pos - (debounce_samples_ - 1);
+    }
+    pending = (pos == 31) ? 0 : (0xffffffff << (pos + 1));
+  }
+
+  prev_word_ = word;
+  next_sample_ = first_sample + 32;
+  return count;
+}
@@ -0,0 +1,59 @@
+#ifndef EDGE_DECODER_H_
+#define EDGE_DECODER_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Extracts the debounced leading edges of the pulses from a
+ * bit-packed sample history.
+ *
+ * Samples are delivered in words of 32, bit 0 being the earliest sample.
+ * An input is considered to have changed level once it has been stable for
+ * debounce_samples consecutive samples. The stable runs of a whole word are
+ * found with a handful of word-parallel shifts, only the (rare) level
+ * changes are then walked one by one, so the cost is O(log debounce) per
+ * word plus O(1) per edge.
+ *
+ * The decoder has no hardware dependencies.
+ */
+class EdgeDecoder {
+ public:
+  /**
+   * @param debounce_samples Number of samples (1 to 32) an input must be
+   *   stable to count as a level change
+   * @param active_high The input is high during a pulse, so the leading
+   *   edges are rising, instead of low and falling
+   */
+  explicit EdgeDecoder(uint8_t debounce_samples, bool active_high = false);
+
+  /**
+   * @brief Decode one word of samples.
+   *
+   * @param word 32 samples of the input, bit 0 is the earliest
+   * @param first_sample Sample index of bit 0. A gap to the previous word
+   *   (dropped words) restarts the debouncing.
+   * @param edges Receives the sample indices of the leading edges, i.e. of
+   *   the first sample of each stable active run
+   * @param max_edges Size of edges
+   * @return Number of leading edges written to edges
+   */
+  int decode(uint32_t word, uint32_t first_sample, uint32_t* edges,
+             int max_edges);
+
+  /// Restart debouncing with the given level as the current debounced level.
+  void reset(bool level);
+
+  /// Change the polarity, restarting the debouncing from the idle level
+  void set_active_high(bool active_high);
+
+  bool get_level() { return level_; }
+
+ protected:
+  uint8_t debounce_samples_;
+  bool active_high_;
+  uint32_t prev_word_;
+  uint32_t next_sample_ = 0;
+  bool level_;
+};
+
+#endif  // EDGE_DECODER_H_
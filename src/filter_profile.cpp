@@ -0,0 +1,32 @@
+#include "filter_profile.h"
+
+#include <string.h>
+
+const FilterProfile kFilterProfiles[kFilterProfileCount] = {
+    // name       dir    attack release deadband interval
+    {"custom", 0.25, 1.0, 1.0, 0, 250},
+    {"racing", 0.5, 1.0, 1.0, 0, 100},
+    {"cruising", 0.2, 0.3, 0.3, 1, 250},
+    {"anchor", 0.05, 1.0, 0.02, 3, 1000},
+};
+
+static int32_t to_q16(float gain) {
+  if (gain < 0) gain = 0;
+  if (gain > 1) gain = 1;
+  return (int32_t)(gain * 65536.0f + 0.5f);
+}
+
+void FilterCoefficients::set(const FilterProfile& profile) {
+  dir_gain = to_q16(profile.dir_gain);
+  speed_attack = to_q16(profile.speed_attack);
+  speed_release = to_q16(profile.speed_release);
+  dir_deadband = profile.dir_deadband;
+  output_interval = profile.output_interval;
+}
+
+int find_filter_profile(const char* name) {
+  for (int i = 0; i < kFilterProfileCount; i++) {
+    if (strcmp(name, kFilterProfiles[i].name) == 0) return i;
+  }
+  return -1;
+}
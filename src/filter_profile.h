@@ -0,0 +1,63 @@
+#ifndef FILTER_PROFILE_H_
+#define FILTER_PROFILE_H_
+
+#include <stdint.h>
+
+/**
+ * @brief A named set of output filter parameters.
+ *
+ * The speed filter rises with speed_attack and falls with speed_release, so
+ * an anchor watch profile can average heavily while still capturing gusts.
+ * Direction changes within dir_deadband degrees of the output are ignored.
+ */
+struct FilterProfile {
+  const char* name;
+  float dir_gain;       ///< Direction filter gain per revolution, 0 to 1
+  float speed_attack;   ///< Speed filter gain while the speed rises, 0 to 1
+  float speed_release;  ///< Speed filter gain while the speed falls, 0 to 1
+  int dir_deadband;     ///< Degrees
+  int output_interval;  ///< Milliseconds between two outputs
+};
+
+enum FilterProfileId {
+  kCustomProfile = 0,  ///< Filter Gain and Update Rate settings, no speed filter
+  kRacingProfile = 1,
+  kCruisingProfile = 2,
+  kAnchorProfile = 3,
+  kFilterProfileCount = 4
+};
+
+/// The built-in profiles, indexed by FilterProfileId. The custom entry only
+/// holds the defaults, its gain and interval come from the settings.
+extern const FilterProfile kFilterProfiles[kFilterProfileCount];
+
+/**
+ * @brief Fixed-point form of a FilterProfile, for the per-revolution path.
+ *
+ * Gains are Q16 (65536 = 1.0).
+ */
+struct FilterCoefficients {
+  int32_t dir_gain;
+  int32_t speed_attack;
+  int32_t speed_release;
+  int dir_deadband;
+  int output_interval;
+
+  void set(const FilterProfile& profile);
+};
+
+/**
+ * @brief A Q16 product rounded to the nearest integer, halves away from zero.
+ *
+ * Adding 0.5 before the arithmetic shift rounds -0.5 up to 0 but +0.5 up to
+ * 1, which would make a filter drift towards higher values.
+ */
+inline int32_t q16_round(int64_t product) {
+  if (product < 0) return -(int32_t)((-product + 32768) >> 16);
+  return (int32_t)((product + 32768) >> 16);
+}
+
+/// Profile id by name, -1 if there is none
+int find_filter_profile(const char* name);
+
+#endif  // FILTER_PROFILE_H_
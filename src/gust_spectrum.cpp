@@ -0,0 +1,79 @@
+#include "gust_spectrum.h"
+
+#include <math.h>
+
+static const float kTwoPi = 6.2831853;
+
+GustSpectrum::GustSpectrum(float rate, uint16_t block_seconds)
+    : block_seconds_(block_seconds) {
+  block_size_ = (uint32_t)(rate * block_seconds + 0.5f);
+  if (block_size_ < 2 * kBins + 2) block_size_ = 2 * kBins + 2;
+
+  for (int k = 0; k < kBins; k++) {
+    coeff_[k] = 2 * cosf(kTwoPi * (k + 1) / block_size_);
+    s1_[k] = s2_[k] = 0;
+  }
+  window_step_cos_ = cosf(kTwoPi / block_size_);
+  window_step_sin_ = sinf(kTwoPi / block_size_);
+}
+
+void GustSpectrum::add(float speed) {
+  if (!started_) {
+    offset_ = speed;
+    started_ = true;
+  }
+  float x = speed - offset_;
+  sum_ += x;
+  sum_sq_ += x * x;
+
+  float windowed = x * (0.5f - 0.5f * window_cos_);
+  for (int k = 0; k < kBins; k++) {
+    float s0 = windowed + coeff_[k] * s1_[k] - s2_[k];
+    s2_[k] = s1_[k];
+    s1_[k] = s0;
+  }
+
+  float c = window_cos_ * window_step_cos_ - window_sin_ * window_step_sin_;
+  window_sin_ = window_sin_ * window_step_cos_ + window_cos_ * window_step_sin_;
+  window_cos_ = c;
+
+  if (++count_ >= block_size_) finish_block();
+}
+
+void GustSpectrum::finish_block() {
+  float n = (float)block_size_;
+  GustStats stats;
+
+  float mean_offset = sum_ / n;
+  float variance = sum_sq_ / n - mean_offset * mean_offset;
+  stats.mean = offset_ + mean_offset;
+  stats.std_dev = (variance > 0) ? sqrtf(variance) : 0;
+  stats.turbulence_intensity = (stats.mean > 0) ? stats.std_dev / stats.mean : 0;
+
+  // One-sided power of each line as its share of the variance (Parseval),
+  // corrected for the mean square of the Hann window (3/8)
+  float scale = 2 / (n * n * 0.375f);
+  float peak_power = -1;
+  int peak_bin = 0;
+  stats.band_energy = 0;
+  for (int k = 0; k < kBins; k++) {
+    float power =
+        (s1_[k] * s1_[k] + s2_[k] * s2_[k] - coeff_[k] * s1_[k] * s2_[k]) *
+        scale;
+    stats.band_energy += power;
+    if (power > peak_power) {
+      peak_power = power;
+      peak_bin = k;
+    }
+    s1_[k] = s2_[k] = 0;
+  }
+  stats.peak_period = block_seconds_ / (peak_bin + 1);
+
+  offset_ = stats.mean;
+  sum_ = sum_sq_ = 0;
+  count_ = 0;
+  window_cos_ = 1;
+  window_sin_ = 0;
+
+  if (output_) output_(stats);
+}
@@ -0,0 +1,70 @@
+#ifndef GUST_SPECTRUM_H_
+#define GUST_SPECTRUM_H_
+
+#include <stdint.h>
+
+#include <functional>
+
+/**
+ * @brief Result of one block of the gust analysis.
+ */
+struct GustStats {
+  float mean;                  // Mean speed, input units
+  float std_dev;               // Standard deviation of the speed
+  float turbulence_intensity;  // std_dev / mean, 0 in a calm
+  float peak_period;           // Period of the strongest gust component, s
+  float band_energy;           // Variance in the analysed gust band
+};
+
+/**
+ * @brief Turbulence and gust spectrum of a uniformly sampled speed series.
+ *
+ * A bank of Goertzel filters evaluates kBins spectral lines at k /
+ * block_seconds Hz (k = 1..kBins) over Hann-windowed blocks. Every sample
+ * costs the same small, constant amount of work, so the analysis is spread
+ * evenly over the incoming samples rather than run as a burst at the end
+ * of a block. Memory use is constant.
+ */
+class GustSpectrum {
+ public:
+  static const int kBins = 32;
+
+  /**
+   * @param rate Sample rate of the series in Hz
+   * @param block_seconds Length of an analysis block in seconds. Sets the
+   *   longest gust period analysed; the shortest is block_seconds / kBins.
+   */
+  GustSpectrum(float rate, uint16_t block_seconds = 128);
+
+  /// Set the function to call with the result of each block
+  void set_output(std::function<void(const GustStats&)> output) {
+    output_ = output;
+  }
+
+  void add(float speed);
+
+ protected:
+  void finish_block();
+
+  uint32_t block_size_;
+  float block_seconds_;
+  std::function<void(const GustStats&)> output_;
+
+  float coeff_[kBins];  // 2 cos(2 pi k / N)
+  float s1_[kBins];
+  float s2_[kBins];
+
+  // Hann window, advanced by rotating (window_cos_, window_sin_)
+  float window_cos_ = 1;
+  float window_sin_ = 0;
+  float window_step_cos_;
+  float window_step_sin_;
+
+  bool started_ = false;
+  uint32_t count_ = 0;
+  float offset_ = 0;  // Mean of the previous block, removed before analysis
+  float sum_ = 0;
+  float sum_sq_ = 0;
+};
+
+#endif  // GUST_SPECTRUM_H_
@@ -26,57 +26,453 @@
 
 #include "Version.h"
 #include "Arduino.h"
+#include "SPIFFS.h"
+#include "WiFi.h"
+#include "ESPAsyncWebServer.h"
 #include "sensesp.h"
 #include "sensesp_app_builder.h"
+#include "sensesp/signalk/signalk_put_request_listener.h"
+#include "sensesp/signalk/signalk_value_listener.h"
+#include "config_store.h"
 #include "ui_configurables.h"
+#include "pulse_counter.h"
+#include "storm_guard.h"
+#include "polled_sampler.h"
+#include "edge_decoder.h"
+#include "driver/gpio.h"
+#include "soc/gpio_struct.h"
+#include "spsc_queue.h"
+#include "resampler.h"
+#include "gust_spectrum.h"
+#include "wind_rose.h"
+#include "wear_monitor.h"
+#include "direction_calibrator.h"
+#include "direction_table.h"
+#include "web_pages.h"
+#include "anemometer_model.h"
+#include "analog_vane.h"
+#include "model_detector.h"
+#include "filter_profile.h"
+#include "wind_stages.h"
+#include "sample_bus.h"
+#include "debug_telemetry.h"
+#include "debug_stream.h"
+#include "trace.h"
+#include "metrics.h"
+#include "wind_snapshot.h"
+#include "overspeed.h"
 
 using namespace sensesp;
 
-#define windSpeedPin 12
-#define windDirPin 14
+// The masthead unit, see anemometer_model.h
+#ifndef ANEMOMETER_MODEL
+#define ANEMOMETER_MODEL PeetBrosPro
+#endif
+typedef ANEMOMETER_MODEL Anemometer;
+
+// Default inputs, see /Settings/Inputs
+const uint8_t DEFAULT_SPEED_PIN = 12;
+const uint8_t DEFAULT_DIR_PIN = 14;
+const uint8_t DEFAULT_VANE_PIN = 34;        // Analog vanes only, must be an ADC1 input
+
+enum InputBias
+{
+    kNoBias = 0,                // External pull resistors
+    kPullUp = 1,
+    kPullDown = 2
+};
 
-const unsigned long DEBOUNCE = 10000ul;      // Minimum switch time in microseconds
 const unsigned long TIMEOUT = 1500000ul;       // Maximum time allowed between speed pulses in microseconds
 
-// Speed is actually stored as cm/s (or "m/s * 100"). Deviations below should match these units.
-const int BAND_0 =  5 * 100;
-const int BAND_1 =  40 * 100;
+// Interrupt storm guard. The edge rates are traits of the model, see anemometer_model.h.
+const unsigned long STORM_WINDOW = 100ul;       // Edge rate check interval in milliseconds
+const unsigned int REARM_WINDOWS = 30;          // Consecutive sane windows before the interrupts are re-armed
+const unsigned int STORM_GATE = 10;             // Windows per speed measurement while the interrupts are masked
+
+// Polled sampling mode
+const unsigned long POLL_PERIOD = 100ul;        // Sampling period in microseconds (10 kHz)
+const uint8_t POLL_DEBOUNCE = 8;                // Samples an input must be stable to count as a new level
+const int POLL_MAX_EDGES = 8;                   // Falling edges decoded per word of 32 samples, at most
+
+// Settings of the firmware, see ConfigStore
+const char* CONFIG_FILE = "/settings.bin";
+const size_t CONFIG_CAPACITY = 8192;               // Bytes of RAM for the settings
+const unsigned long CONFIG_QUIET = 2000ul;          // Write the settings once unchanged for this long (ms)
+const unsigned long CONFIG_MAX_DELAY = 10000ul;     // but at the latest this long after a change (ms)
+const unsigned long CONFIG_MAX_RETRY = 300000ul;    // Longest wait between the retries of a failed write (ms)
+
+// Debug output
+const unsigned long DEBUG_INTERVAL = 200ul;     // Milliseconds between two debug records
+const unsigned long DEBUG_PUMP_INTERVAL = 5ul;  // Milliseconds between two writes to the UART (about 58 bytes at 115200 baud)
+const unsigned long DEBUG_STREAM_INTERVAL = 100ul;  // Milliseconds between two debug stream messages
+const uint16_t DEBUG_STREAM_CLIENTS = 2;        // Debug stream clients, the oldest are closed beyond that
+
+// Metrics for Prometheus, at /metrics
+const size_t METRICS_BUFFER = 6144;             // Bytes of the rendered metrics
+const int MAX_STAGES = 16;                      // Processing stages with a rejection counter
+const uint32_t AGE_BOUNDS[] = {1000, 5000, 20000, 50000, 100000, 250000, 1000000};  // Revolution age buckets, us
+const uint32_t PIPELINE_BOUNDS[] = {5, 10, 20, 50, 100, 200, 500};                  // Processing time buckets, us
+
+// Web server for the wind data (the SensESP configuration UI is on port 80)
+const uint16_t WEB_PORT = 8080;
+const unsigned long WEB_REQUEST_INTERVAL = 50ul;    // Milliseconds between two runs of the queued web requests
+const unsigned long WEB_STATUS_INTERVAL = 1000ul;   // Milliseconds between two status updates for the web server
+
+// Requests of the web server, which runs in the AsyncTCP task, carried out by the main loop
+enum WebRequestType
+{
+    kStartDirCalibration,
+    kFinishDirCalibration,
+    kStartTableCalibration,
+    kTablePoint,
+    kFinishTableCalibration,
+    kStartSpeedCalibration,
+    kFinishSpeedCalibration,
+    kResetWear,
+    kStartDetection
+};
+
+struct WebRequest
+{
+    WebRequestType type;
+    float value;        // Parameter of the request, if any
+};
+
+// Wind rose
+const unsigned long WIND_ROSE_PUBLISH = 60000ul;    // Snapshot interval in milliseconds
+const unsigned long WIND_ROSE_PERSIST = 900000ul;   // Save interval in milliseconds
+const char* WIND_ROSE_FILE = "/windrose.bin";
+const uint32_t WIND_ROSE_MAGIC = 0x31525357ul;      // "WSR1", file format version
 
-const int SPEED_DEV_LIMIT_0 =  5 * 100;     // Deviation from last measurement to be valid. Band_0: 0 to 5 m/s
-const int SPEED_DEV_LIMIT_1 = 10 * 100;     // Deviation from last measurement to be valid. Band_1: 5 to 40 m/s
-const int SPEED_DEV_LIMIT_2 = 30 * 100;     // Deviation from last measurement to be valid. Band_2: 40+ m/s
+// Bearing wear monitor
+const unsigned long WEAR_PUBLISH = 60000ul;         // Wear index interval in milliseconds
+const unsigned long WEAR_PERSIST = 3600000ul;       // Baseline save interval in milliseconds
+const float WEAR_ALERT = 1.5;                       // Wear index raising the alert
+const float WEAR_CLEAR = 1.3;                       // Wear index clearing the alert
+const float WEAR_TREND_DAYS = 30.0;                 // Days of operation to WEAR_ALERT at the current trend, raising the alert
+const char* WEAR_FILE = "/wear.bin";
+const uint32_t WEAR_MAGIC = 0x32525757ul;           // "WWR2", file format version
+const uint32_t WEAR_MAGIC_V1 = 0x31525757ul;        // "WWR1", the baseline only
 
-// Should be larger limits as lower speed, as the direction can change more per speed update
-const int DIR_DEV_LIMIT_0 = 25;     // Deviation from last measurement to be valid. Band_0: 0 to 5 m/s
-const int DIR_DEV_LIMIT_1 = 18;     // Deviation from last measurement to be valid. Band_1: 5 to 40 m/s
-const int DIR_DEV_LIMIT_2 = 10;     // Deviation from last measurement to be valid. Band_2: 40+ m/s
+enum WearAlert
+{
+    kWearOk = 0,
+    kWearRising = 1,    // Expected to reach WEAR_ALERT within WEAR_TREND_DAYS
+    kWearWorn = 2
+};
+
+// Direction calibration
+const float DIR_CAL_MIN_STW = 1.5;                  // Speed through water (m/s) to count as motoring
+const uint32_t DIR_CAL_MAX_SAMPLES = 3000;          // Samples after which the fit is applied automatically
+
+// Direction linearization table calibration
+const int DIR_TABLE_MAX_PAIRS = 72;                 // Calibration marks that can be recorded
+const float DIR_TABLE_SMOOTHING = 0.2;              // Smoothing of the phase while calibrating
+
+// Speed calibration
+const float SPEED_CAL_MIN_SPEED = 1.5;              // Reference speed (m/s) for a pair to be used
+const float SPEED_CAL_TIME_CONSTANT = 10.0;         // Averaging of both speeds in seconds, to ride out the reference latency
+const float SPEED_CAL_STEADY = 0.05;                // Relative deviation of the reference from its average to count as steady
+const float SPEED_CAL_AT_REST = 0.3;                // Speed over ground (m/s) below which the true wind is the apparent wind
+const uint32_t SPEED_CAL_MAX_PAIRS = 5000;          // Pairs after which the fit is applied automatically
+
+enum SpeedReference
+{
+    kGroundReference = 0,       // Motoring in calm air: the apparent wind is the speed over ground
+    kTrueWindReference = 1      // True wind of a reference instrument, used while the boat is at rest
+};
+
+// Sample bus from the calculation to the output sinks
+const uint32_t WIND_BUS_SIZE = 64;              // Records, a few seconds at the highest output rate
+const unsigned long SK_SINK_INTERVAL = 50ul;    // Milliseconds between two drains of the Signal K sink
+const unsigned long SLOW_SINK_INTERVAL = 1000ul;    // The same, for the statistics sinks
+
+// Anemometer detection
+const unsigned long DETECT_TIME = 3000ul;       // Observation time in milliseconds
+
+// Counter sampling mode
+const int16_t PHASE_INTERVAL = 8;               // Revolutions between two direction phase samples
+const unsigned long COUNTER_GATE = 1000ul;      // Speed gate window in milliseconds
+
+enum SamplingMode
+{
+    kInterruptSampling = 0,     // Edge interrupts on both inputs
+    kPolledSampling = 1,        // Timer-driven polling of both inputs
+    kCounterSampling = 2        // Speed from the pulse counter, direction every PHASE_INTERVAL revolutions
+};
 
 volatile unsigned long speedPulse = 0ul;    // Time capture of speed pulse
 volatile unsigned long dirPulse = 0ul;      // Time capture of direction pulse
 volatile unsigned long speedTime = 0ul;     // Time between speed pulses (microseconds)
 volatile unsigned long directionTime = 0ul; // Time between direction pulses (microseconds)
+volatile unsigned long debounce = Anemometer::kDebounce;  // Minimum switch time of the model (microseconds)
+
+volatile boolean dirValid = true;   // False while no direction phase is captured (counter fallback)
+
+volatile unsigned long phaseStart = 0ul;    // Time capture of the speed pulse starting a phase sample
+volatile boolean phaseArmed = false;        // A phase sample revolution is in progress
+volatile boolean phaseDirCaptured = false;  // The direction pulse of the phase sample was seen
+volatile unsigned long counterWraps = 0ul;  // Number of PHASE_INTERVAL revolution blocks counted
+volatile unsigned long wrapTime = 0ul;      // Time capture of the last block
+unsigned long counterBounces = 0ul;         // Counter measurements discarded as switch bounce
 
-volatile int speedOut = 0;    // Wind speed output in cm/s (divide by 100 for m/s)
-volatile int dirOut = 0;      // Direction output in degrees
-volatile boolean ignoreNextReading = false;
-volatile long rps = 0l;
+// Every captured revolution, for the resampler and the wear monitor
+struct Revolution
+{
+    unsigned long speedPulse;
+    unsigned long speedTime;
+    unsigned long directionTime;
+};
+SpscQueue<Revolution, 64> revolutionQueue;
+Resampler resampler;
+int resampleRate = 0;    // Hz, 0 for update_rate snapshots. Applied at boot only.
 
 SKMetadata* speed_meta;
 SKMetadata* dir_meta;
 SKOutputFloat* speed_output;
 SKOutputFloat* dir_output;
 FloatConfig *filter_gain;
-IntConfig *dir_offset;
+IntConfig *filter_profile;
+DirectionConfig *dir_config;
+DirectionTableConfig *dir_table;
+SpeedTableConfig *speed_table;
 CheckboxConfig *debug;
+CheckboxConfig *debug_binary;
+DebugTelemetry debugTelemetry(&Serial);
+CheckboxConfig *debug_stream;
+AsyncWebSocket* debugSocket;
+DebugStream debugStream;
+boolean debugStreaming = false;     // Enabled and someone listens
 IntConfig *update_rate;
+IntConfig *distance_constant;
+IntConfig *sampling_mode;
+IntConfig *resample_rate;
+int samplingMode = kInterruptSampling;    // Applied at boot only
+SKOutputRawJson* storm_notification;
+GustSpectrum* gust_spectrum;
+SKOutputFloat* turbulence_output;
+SKOutputFloat* gust_period_output;
+SKOutputFloat* gust_energy_output;
+unsigned long gustMicros = 0ul;     // Longest gust analysis step, in microseconds
+GustStats gustStats = {};           // Of the last gust window
+
+// Metrics, read by renderMetrics()
+Histogram revolutionAge(AGE_BOUNDS, sizeof(AGE_BOUNDS) / sizeof(AGE_BOUNDS[0]));   // From the speed pulse to the processing
+Histogram pipelineMicros(PIPELINE_BOUNDS, sizeof(PIPELINE_BOUNDS) / sizeof(PIPELINE_BOUNDS[0]));
+uint32_t revolutions = 0;
+uint32_t stageRejections[MAX_STAGES] = {};
+uint32_t timeouts = 0;              // Stalls, counted once per last pulse before the stall
+unsigned long lastProcessedPulse = 0ul;     // Speed pulse of the last revolution counted
+unsigned long lastTimeoutPulse = 0ul;       // Speed pulse of the last stall counted
+uint32_t speedEdgeRate = 0;         // Edges/s in the last storm check window
+uint32_t dirEdgeRate = 0;
+UBaseType_t loopStackFree = 0;      // Lowest free stack of the main loop task, in bytes
+char metricsText[METRICS_BUFFER];
+size_t metricsLength = 0;
+volatile boolean metricsBusy = false;   // A scrape is being sent from metricsText
+
+AsyncWebServer* web_server;
+WindRose windRoseHour(3600);
+WindRose windRoseDay(86400);
+String windRoseJson = "{}";     // Latest snapshot, served by the web server
+SpscQueue<WebRequest, 8> webRequests;
+SemaphoreHandle_t webLock;      // The Strings the loop publishes for the web task, see publishForWeb()
+
+WearMonitor wearMonitor;
+SKOutputFloat* wear_output;
+SKOutputRawJson* wear_notification;
+String wearJson = "{}";     // Published for the web server
+
+DirectionCalibrator dirCalibrator;
+boolean dirCalibrating = false;
+String dirCalibrationResult = "null";   // JSON of the last applied fit
+const char* dirCalibrationOutcome = "none";
+String dirCalibrationJson = "{}";     // Published for the web server
+FloatSKListener* heading_listener;
+FloatSKListener* stw_listener;
+
+SpeedCalibrator speedCalibrator;
+boolean speedCalibrating = false;
+int speedReference = kGroundReference;
+float speedReferenceAvg = 0.0;          // Both in m/s, averaged over SPEED_CAL_TIME_CONSTANT
+float speedMeasuredAvg = 0.0;
+String speedCalibrationResult = "null"; // JSON of the last applied fit
+const char* speedCalibrationOutcome = "none";
+String speedCalibrationJson = "{}";     // Published for the web server
+FloatSKListener* sog_listener;
+FloatSKListener* true_wind_listener;
+
+boolean tableCalibrating = false;
+DirectionTable tableCalibration;
+uint16_t tableMeasured[DIR_TABLE_MAX_PAIRS];
+uint16_t tableReference[DIR_TABLE_MAX_PAIRS];
+int tablePairs = 0;
+const char* tableCalibrationOutcome = "none";
+String tableCalibrationJson = "{}";     // Published for the web server
+float phaseX = 1.0;     // Smoothed (uncorrected) sensor phase as a unit vector
+float phaseY = 0.0;
+
+// The inputs, set from the configuration at boot
+uint8_t windSpeedPin = DEFAULT_SPEED_PIN;
+uint8_t windDirPin = DEFAULT_DIR_PIN;
+uint8_t windVanePin = DEFAULT_VANE_PIN;
+IntConfig* speed_pin;
+IntConfig* dir_pin;
+IntConfig* vane_pin;
+IntConfig* input_bias;
+CheckboxConfig* active_high;
+
+PulseCounter* speedCounter;
+PulseCounter* dirCounter;
+StormGuard stormGuard(Anemometer::kStormRate, Anemometer::kSaneRate, REARM_WINDOWS);
+ISRReaction* speedReaction = nullptr;
+ISRReaction* dirReaction = nullptr;
+
+PolledSampler* polledSampler;
+EdgeDecoder speedDecoder(POLL_DEBOUNCE);
+EdgeDecoder dirDecoder(POLL_DEBOUNCE);
+
+AnalogVane* analogVane;
+boolean analogVaneStarted = false;
+
+typedef void (*RevolutionProcessor)(unsigned long speedPulse_, unsigned long speedTime_, unsigned long directionTime_);
+struct ModelEntry
+{
+    const char* name;
+    ModelSignature signature;
+    unsigned long debounce;
+    unsigned long stormRate;
+    unsigned long saneRate;
+    RevolutionProcessor process;
+};
 
 // initial function declarations
-void IRAM_ATTR readWindSpeed();
-void IRAM_ATTR readWindDir();
-boolean checkSpeedDev(long cmps, int dev);
-boolean checkDirDev(long cmps, int dev);
+template <int Level> void IRAM_ATTR readWindSpeed();
+template <int Level> void IRAM_ATTR readWindDir();
+void IRAM_ATTR captureSpeedPulse(unsigned long now);
+void IRAM_ATTR captureDirPulse(unsigned long now);
+void decodePolledSamples();
+void IRAM_ATTR onSpeedCounterEvent(uint32_t status);
+void IRAM_ATTR readWindDirPhase();
+void gateSpeedCounter();
+void IRAM_ATTR queueRevolution();
+void drainRevolutions();
+unsigned long speedTimeout();
+template <class Model> void processRevolution(unsigned long speedPulse_, unsigned long speedTime_, unsigned long directionTime_);
+void trackPhase(uint16_t phase);
+String tableCalibrationStatus();
+void recordOutput(float speed, float direction, float dt);
+void publishSample(float speed, float direction, float dt);
+void drainSignalKSink();
+void drainRecordSink();
+void drainGustSink();
+void updateWindSnapshot();
+void recordWindRose(float speed, float direction, float dt);
+void publishForWeb(String& published, const char* value);
+String copyPublished(const String& published);
+void postWebRequest(AsyncWebServerRequest* request, WebRequestType type, float value, const String& status);
+void runWebRequests();
+void publishWebStatus();
+void recordTablePoint(float angle);
+boolean finishTableCalibration();
+void feedDirectionCalibration(float speed, float direction);
+boolean finishDirectionCalibration();
+void feedSpeedCalibration(float speed, float dt);
+boolean finishSpeedCalibration();
+String speedCalibrationStatus();
+void publishWindRose();
+void saveWindRose();
+void loadWindRose();
+void publishWear();
+String wearStatus();
+void saveWear();
+void loadWear();
+boolean truePeriods();
 void calcWindSpeedAndDir();
+void checkFilterProfile();
+void flushSettings();
+void beginFlashWrite();
+void endFlashWrite();
+boolean overlapsFlashWrite(unsigned long speedPulse_, unsigned long speedTime_);
+uint8_t checkPin(int pin, uint8_t fallback, int maxPin);
+void setPolarity(boolean activeHigh);
+void selectModel(const ModelEntry* entry);
+void startDetection();
+void sampleDetection();
+void finishDetection();
+String detectionStatus();
+void armInterrupts();
+void disarmInterrupts();
+void checkStorm();
+void notifyStorm(boolean storm);
 void printDebug();
+void streamRevolution(const WindSample& sample, boolean passed, boolean analogVane);
+void flushDebugStream();
+size_t renderMetrics(char* buffer, size_t size);
+
+// The interrupt handlers are specialized on the level of the inputs during a pulse, and
+// selected once by setPolarity(), so that no edge has to test the polarity
+struct InputHandlers
+{
+    int edge;                       // Interrupt mode of the leading edge
+    gpio_int_type_t intrType;       // The same, for direct register writes from an ISR
+    void (*speed)();
+    void (*dir)();
+};
+const InputHandlers ACTIVE_LOW_INPUTS = {FALLING, GPIO_INTR_NEGEDGE, readWindSpeed<LOW>, readWindDir<LOW>};
+const InputHandlers ACTIVE_HIGH_INPUTS = {RISING, GPIO_INTR_POSEDGE, readWindSpeed<HIGH>, readWindDir<HIGH>};
+const InputHandlers* inputs = &ACTIVE_LOW_INPUTS;
+
+// The models that can be detected, each with its own specialization of the processing.
+// A model added to anemometer_model.h must be listed here too.
+#define MODEL_ENTRY(M) {#M, {M::kPulsesPerRevolution, M::kDirection, M::kReedSwitch, M::kVaneDeadZone}, \
+                        M::kDebounce, M::kStormRate, M::kSaneRate, processRevolution<M>}
+const ModelEntry MODELS[] = {
+    MODEL_ENTRY(PeetBrosPro),
+    MODEL_ENTRY(Davis6410),
+    MODEL_ENTRY(InspeedVortex),
+    MODEL_ENTRY(UltrasonicPulse)
+};
+const int MODEL_COUNT = sizeof(MODELS) / sizeof(MODELS[0]);
+const ModelEntry* model = nullptr;      // The active model, the built one until detected
+
+CheckboxConfig* auto_detect;
+ModelDetector modelDetector;
+RepeatReaction* detectReaction = nullptr;
+PulsePattern detectedPattern = {};
+const char* detectResult = "not run";
+String detectionJson = "{}";    // Published for the web server
+
+ConfigStore* config_store;
+
+// Every output sample. calcWindSpeedAndDir() or the resampler is the single writer.
+struct WindRecord
+{
+    unsigned long time;     // micros() of the sample
+    float speed;            // cm/s
+    float direction;        // degrees
+    float dt;               // Seconds the sample stands for
+};
+SampleBus<WindRecord, WIND_BUS_SIZE> windBus;
+SampleBus<WindRecord, WIND_BUS_SIZE>::Reader skReader;
+SampleBus<WindRecord, WIND_BUS_SIZE>::Reader recordReader;
+SampleBus<WindRecord, WIND_BUS_SIZE>::Reader gustReader;
+SampleBus<WindRecord, WIND_BUS_SIZE>::Reader snapshotReader;
+WindSnapshot windSnapshot;              // The latest wind, served at /wind
+uint32_t snapshotServed = 0;            // /wind requests answered with the snapshot
+uint32_t snapshotNotModified = 0;       // and with 304, as the client had it already
+uint32_t bootNonce = 0;                 // Random per boot, in the /wind ETag as the version restarts at 0
+
+int activeProfile = -1;
+float customGain = 0.0;                 // Settings the custom profile was computed from
+int customRate = 0;
+RepeatReaction* outputReaction = nullptr;
+SKOutputString* profile_output;
+StringSKPutRequestListener* profile_listener;
+unsigned long flashWriteStart = 0ul;        // micros() of the last flash writes, see beginFlashWrite()
+unsigned long flashWriteEnd = 0ul;
+volatile boolean flashWriting = false;      // Inside a settings write, see flushSettings()
+volatile uint32_t flashWriteCaptures = 0;   // Speed pulses the interrupt captured inside the writes
 
 ReactESP app;
 
@@ -87,6 +483,7 @@ void setup()
     #endif
 
     Serial.printf("SensESP-PeetBrosWind version v%s, built %s\n",VERSION,BUILD_TIMESTAMP);
+    bootNonce = esp_random();
 
     SensESPAppBuilder builder;
     sensesp_app = (&builder)
@@ -99,8 +496,16 @@ void setup()
                   ->enable_system_info_sensors()
                   ->get_app();
 
+    // Before the first setting is created
+    config_store = new ConfigStore(CONFIG_FILE, CONFIG_CAPACITY, CONFIG_QUIET, CONFIG_MAX_DELAY, CONFIG_MAX_RETRY);
+    config_store->begin();
+
     debug = new CheckboxConfig(false, "debug", "/Settings/Debug Output on Serial", "Enable debug output to USB Serial (115200 8N1)", 700);
-    update_rate = new IntConfig(250, "/Settings/Update Rate", "Send data to SignalK server every n milliseconds", 400);
+    debug_binary = new CheckboxConfig(false, "binary", "/Settings/Debug Output Binary", "Send the debug output as compact binary frames for a logger, instead of text for the Arduino Serial Plotter", 710);
+    debug_stream = new CheckboxConfig(false, "stream", "/Settings/Debug Stream", "Stream every revolution to the chart at http://<device>:8080/debug/plot", 720);
+    update_rate = new IntConfig(250, "/Settings/Update Rate", "Send data to SignalK server every n milliseconds, with the custom filter profile", 400);
+    resample_rate = new IntConfig(0, "/Settings/Resample Rate", "Send data to SignalK server at a fixed rate of n Hz (1, 2, 4 or 10), low-pass filtered from all revolutions so that faster gusts do not alias, which delays it by about 3 intervals. 0 sends snapshots at the Update Rate instead. Takes effect after a restart.", 450);
+    resampleRate = resample_rate->get_value();
 
     const char* speed_path = "environment.wind.speedApparent";
     const char* dir_path = "environment.wind.angleApparent";
@@ -112,188 +517,1388 @@ void setup()
     dir_output = new SKOutputFloat(dir_path, dir_meta);
 
     filter_gain = new FloatConfig(0.25, "/Settings/Filter Gain", "Filter gain on direction output filter. Range: 0.0 to 1.0, where 1.0 means no filtering. A smaller number increases the filtering.", 600);
-    dir_offset = new IntConfig(0, "/Settings/Direction Offset", "Offset (in degrees) between device-north and direction in which boat is pointing", 500);
+    filter_profile = new IntConfig(kCustomProfile, "/Settings/Filter Profile", "0: custom (Filter Gain and Update Rate above), 1: racing (fast response), 2: cruising (smooth readings), 3: anchor watch (heavy averaging, gusts still captured). Can also be set by a Signal K PUT of racing, cruising, anchor or custom to sensors.wind.filterProfile.", 590);
+    profile_output = new SKOutputString("sensors.wind.filterProfile", "");
+    profile_listener = new StringSKPutRequestListener("sensors.wind.filterProfile");
+    // Only stored here, the main loop applies it with checkFilterProfile()
+    profile_listener->connect_to(new LambdaConsumer<String>([](String name) {
+        int profile = find_filter_profile(name.c_str());
+        if (profile >= 0) filter_profile->set_value(profile);
+    }));
+    dir_table = new DirectionTableConfig("/Settings/Direction Table", "Direction linearization table of this sensor. Calibrate it at http://<device>:8080/calibration/table/ui", 510);
+    dir_config = new DirectionConfig(0, "/Settings/Direction Offset", "Offset (in degrees) between device-north and direction in which boat is pointing, and the sensor's non-linearity. Can be calibrated automatically while motoring in calm conditions.", 500);
+    sampling_mode = new IntConfig(kInterruptSampling, "/Settings/Sampling Mode", "How the anemometer inputs are read. 0: edge interrupts, 1: polled at 10 kHz with deterministic debouncing (lower CPU load with noisy inputs), 2: hardware pulse counter with the direction sampled every 8th revolution (constant CPU load, for sustained high wind speeds, with bounce-free hall or optical sensors only). Takes effect after a restart.", 800);
+    samplingMode = sampling_mode->get_value();
+    speed_table = new SpeedTableConfig("/Settings/Speed Table", "Speed calibration of this sensor, relative to the factory curve. Can be calibrated against the speed over ground while motoring in calm air, or against a reference instrument.", 660);
+    distance_constant = new IntConfig(0, "/Settings/Distance Constant", "Distance constant (in cm) of the cup rotor, used to compensate overspeeding in gusty conditions. 0 disables the compensation, which needs the period of every revolution and so is not applied in the counter sampling mode.", 650);
+
+    storm_notification = new SKOutputRawJson("notifications.environment.wind.sensorFault", "");
 
-    pinMode(windSpeedPin, INPUT_PULLUP);
-    app.onInterrupt(windSpeedPin, FALLING, []() {readWindSpeed();});
+    // GPIO 34 to 39 are inputs only and have no internal pull resistors. The polled mode
+    // reads GPIO 0 to 31 only.
+    speed_pin = new IntConfig(DEFAULT_SPEED_PIN, "/Settings/Inputs/Speed Pin", "GPIO of the speed input. Takes effect after a restart.", 900);
+    dir_pin = new IntConfig(DEFAULT_DIR_PIN, "/Settings/Inputs/Direction Pin", "GPIO of the direction pulse input. Takes effect after a restart.", 910);
+    vane_pin = new IntConfig(DEFAULT_VANE_PIN, "/Settings/Inputs/Vane Pin", "GPIO of an analog wind vane, 32 to 39. Takes effect after a restart.", 920);
+    input_bias = new IntConfig(kPullUp, "/Settings/Inputs/Bias", "Internal resistors on the speed and direction inputs. 0: none, 1: pull-up, 2: pull-down. Takes effect after a restart.", 930);
+    active_high = new CheckboxConfig(false, "value", "/Settings/Inputs/Active High", "The inputs are high during a pulse, instead of low. Overridden by the anemometer detection. Takes effect after a restart.", 940);
 
-    pinMode(windDirPin, INPUT_PULLUP);
-    app.onInterrupt(windDirPin, FALLING, []() {readWindDir();});
+    int maxPin = (samplingMode == kPolledSampling) ? 31 : 39;
+    windSpeedPin = checkPin(speed_pin->get_value(), DEFAULT_SPEED_PIN, maxPin);
+    windDirPin = checkPin(dir_pin->get_value(), DEFAULT_DIR_PIN, maxPin);
+    windVanePin = checkPin(vane_pin->get_value(), DEFAULT_VANE_PIN, 39);
 
-    app.onRepeat(update_rate->get_value(), []() {calcWindSpeedAndDir();});
-    app.onRepeat(200, []() {if (debug->get_value()) {printDebug();}});
+    const uint8_t inputModes[] = {INPUT, INPUT_PULLUP, INPUT_PULLDOWN};
+    uint8_t inputMode = inputModes[constrain(input_bias->get_value(), kNoBias, kPullDown)];
+    pinMode(windSpeedPin, inputMode);
+    pinMode(windDirPin, inputMode);
+
+    speedCounter = new PulseCounter(windSpeedPin, PCNT_UNIT_0);
+    dirCounter = new PulseCounter(windDirPin, PCNT_UNIT_1);
+    polledSampler = new PolledSampler(windSpeedPin, windDirPin, POLL_PERIOD);
+    analogVane = new AnalogVane(windVanePin, Anemometer::kVaneDeadZone);
+    setPolarity(active_high->get_value());
+
+    if (samplingMode == kPolledSampling)
+    {
+        polledSampler->begin();
+        app.onRepeat(10, []() {decodePolledSamples();});
+    }
+    else if (samplingMode != kCounterSampling)
+    {
+        armInterrupts();
+    }
+
+    // The pulse counters run all the time, they cost no CPU per edge and keep
+    // measuring while the interrupts are masked
+    if (samplingMode == kCounterSampling)
+    {
+        // Interrupt every PHASE_INTERVAL revolutions, and one revolution later,
+        // to time the revolution in which the direction phase is sampled
+        speedCounter->set_event_handler(onSpeedCounterEvent);
+        speedCounter->begin(PHASE_INTERVAL);
+        speedCounter->enable_threshold(1);
+
+        // The direction interrupt stays disabled except during a phase sample
+        dirReaction = app.onInterrupt(windDirPin, inputs->edge, []() {readWindDirPhase();});
+        GPIO.pin[windDirPin].int_type = GPIO_INTR_DISABLE;
+
+        app.onRepeat(COUNTER_GATE, []() {gateSpeedCounter();});
+    }
+    else
+    {
+        speedCounter->begin();
+    }
+    dirCounter->begin();
+
+    for (int i = 0; i < MODEL_COUNT; i++)
+    {
+        if (MODELS[i].process == processRevolution<Anemometer>) selectModel(&MODELS[i]);
+    }
+    auto_detect = new CheckboxConfig(false, "value", "/Settings/Detect Anemometer", "Detect the anemometer model from its pulses for a few seconds after boot. Without wind, or if no model or several models match, the model the firmware was built for is used. The result is at http://<device>:8080/detect.", 850);
+    if (auto_detect->get_value()) startDetection();
+
+    if (resampleRate > 0)
+    {
+        resampler.set_rate(resampleRate);
+        resampler.set_output([](const ResampledWind& wind) {
+            publishSample(wind.speed, wind.direction, 1.0/resampleRate);
+        });
+
+        // The gust analysis needs the uniform series, so it only runs with the resampler
+        turbulence_output = new SKOutputFloat("environment.wind.turbulenceIntensity",
+            new SKMetadata("ratio", "Turbulence Intensity", "Standard deviation over mean of the apparent wind speed", "TI", 1.0));
+        gust_period_output = new SKOutputFloat("environment.wind.gustPeriod",
+            new SKMetadata("s", "Gust Period", "Period of the strongest gust component", "Gust T", 1.0));
+        gust_energy_output = new SKOutputFloat("environment.wind.gustEnergy",
+            new SKMetadata("m2/s2", "Gust Energy", "Variance of the apparent wind speed in the 4 to 128 s gust band", "Gust E", 1.0));
+
+        gust_spectrum = new GustSpectrum(resampleRate);
+        gust_spectrum->set_output([](const GustStats& stats) {
+            gustStats = stats;
+            turbulence_output->set_input(stats.turbulence_intensity);
+            gust_period_output->set_input(stats.peak_period);
+            gust_energy_output->set_input((stats.band_energy/10000.0));
+        });
+        windBus.subscribe(&gustReader);
+        app.onRepeat(SLOW_SINK_INTERVAL, []() {drainGustSink();});
+    }
+    checkFilterProfile();
+    app.onRepeat(1000, []() {checkFilterProfile();});
+    windBus.subscribe(&skReader);
+    windBus.subscribe(&recordReader);
+    app.onRepeat(SK_SINK_INTERVAL, []() {drainSignalKSink();});
+    app.onRepeat(SLOW_SINK_INTERVAL, []() {drainRecordSink();});
+    windBus.subscribe(&snapshotReader);
+    app.onRepeat(SK_SINK_INTERVAL, []() {updateWindSnapshot();});
+    app.onRepeat(50, []() {drainRevolutions();});
+    app.onRepeat(STORM_WINDOW, []() {checkStorm();});
+
+    loadWindRose();
+    webLock = xSemaphoreCreateMutex();
+    publishWindRose();
+    app.onRepeat(WIND_ROSE_PUBLISH, []() {publishWindRose();});
+    app.onRepeat(WIND_ROSE_PERSIST, []() {saveWindRose();});
+
+    heading_listener = new FloatSKListener("navigation.headingMagnetic");
+    stw_listener = new FloatSKListener("navigation.speedThroughWater");
+    sog_listener = new FloatSKListener("navigation.speedOverGround");
+    true_wind_listener = new FloatSKListener("environment.wind.speedTrue");
+
+    wear_output = new SKOutputFloat("sensors.wind.wearIndex",
+        new SKMetadata("ratio", "Anemometer Wear Index", "Revolution jitter and stall speed relative to the sensor as new, 1.0 is as new", "Wear", 1.0));
+    wear_notification = new SKOutputRawJson("notifications.sensors.wind.bearingWear", "");
+    loadWear();
+    app.onRepeat(WEAR_PUBLISH, []() {publishWear();});
+    app.onRepeat(WEAR_PERSIST, []() {saveWear();});
+
+    // The web server runs in the AsyncTCP task. Its requests that change the state are queued
+    // for the loop and answered with 202 and the status before the request, which shows the
+    // outcome shortly after.
+    app.onRepeat(WEB_REQUEST_INTERVAL, []() {runWebRequests();});
+    app.onRepeat(WEB_STATUS_INTERVAL, []() {publishWebStatus();});
+    publishWebStatus();
+    web_server = new AsyncWebServer(WEB_PORT);
+    web_server->on("/windrose", HTTP_GET, [](AsyncWebServerRequest* request) {
+        request->send(200, "application/json", copyPublished(windRoseJson));
+    });
+    web_server->on("/wear", HTTP_GET, [](AsyncWebServerRequest* request) {
+        request->send(200, "application/json", copyPublished(wearJson));
+    });
+    // Start learning a new wear baseline, e.g. after replacing the bearings
+    web_server->on("/wear/reset", HTTP_POST, [](AsyncWebServerRequest* request) {
+        postWebRequest(request, kResetWear, 0.0, wearJson);
+    });
+    // Direction calibration: start, motor in calm conditions (ideally on several
+    // headings), then finish to apply the fit
+    web_server->on("/calibration/direction/start", HTTP_POST, [](AsyncWebServerRequest* request) {
+        postWebRequest(request, kStartDirCalibration, 0.0, dirCalibrationJson);
+    });
+    web_server->on("/calibration/direction/finish", HTTP_POST, [](AsyncWebServerRequest* request) {
+        postWebRequest(request, kFinishDirCalibration, 0.0, dirCalibrationJson);
+    });
+    web_server->on("/calibration/direction", HTTP_GET, [](AsyncWebServerRequest* request) {
+        request->send(200, "application/json", copyPublished(dirCalibrationJson));
+    });
+    // Speed calibration: start with reference=ground and motor at several steady speeds in
+    // calm air, or with reference=true_wind at rest next to a reference instrument (whose
+    // true wind must not be derived from this sensor), then finish to apply the fit
+    web_server->on("/calibration/speed/start", HTTP_POST, [](AsyncWebServerRequest* request) {
+        int reference = kGroundReference;
+        if (request->hasParam("reference") && (request->getParam("reference")->value() == "true_wind"))
+        {
+            reference = kTrueWindReference;
+        }
+        postWebRequest(request, kStartSpeedCalibration, reference, speedCalibrationJson);
+    });
+    web_server->on("/calibration/speed/finish", HTTP_POST, [](AsyncWebServerRequest* request) {
+        postWebRequest(request, kFinishSpeedCalibration, 0.0, speedCalibrationJson);
+    });
+    web_server->on("/calibration/speed", HTTP_GET, [](AsyncWebServerRequest* request) {
+        request->send(200, "application/json", copyPublished(speedCalibrationJson));
+    });
+    // Direction table calibration, see kDirectionTablePage
+    web_server->on("/calibration/table/ui", HTTP_GET, [](AsyncWebServerRequest* request) {
+        request->send_P(200, "text/html", kDirectionTablePage);
+    });
+    web_server->on("/calibration/table/start", HTTP_POST, [](AsyncWebServerRequest* request) {
+        int points = request->hasParam("points") ? request->getParam("points")->value().toInt() : 36;
+        postWebRequest(request, kStartTableCalibration, points, tableCalibrationJson);
+    });
+    web_server->on("/calibration/table/point", HTTP_POST, [](AsyncWebServerRequest* request) {
+        if (!request->hasParam("angle"))
+        {
+            request->send(400, "application/json", copyPublished(tableCalibrationJson));
+            return;
+        }
+        postWebRequest(request, kTablePoint, request->getParam("angle")->value().toFloat(), tableCalibrationJson);
+    });
+    web_server->on("/calibration/table/finish", HTTP_POST, [](AsyncWebServerRequest* request) {
+        postWebRequest(request, kFinishTableCalibration, 0.0, tableCalibrationJson);
+    });
+    web_server->on("/calibration/table", HTTP_GET, [](AsyncWebServerRequest* request) {
+        request->send(200, "application/json", copyPublished(tableCalibrationJson));
+    });
+    // Anemometer detection on demand, e.g. after swapping the masthead unit
+    web_server->on("/detect", HTTP_POST, [](AsyncWebServerRequest* request) {
+        postWebRequest(request, kStartDetection, 0.0, detectionJson);
+    });
+    web_server->on("/detect", HTTP_GET, [](AsyncWebServerRequest* request) {
+        request->send(200, "application/json", copyPublished(detectionJson));
+    });
+    // Live debug chart, fed by flushDebugStream()
+    debugSocket = new AsyncWebSocket("/debug/ws");
+    web_server->addHandler(debugSocket);
+    web_server->on("/debug/plot", HTTP_GET, [](AsyncWebServerRequest* request) {
+        AsyncWebServerResponse* response = request->beginResponse_P(200, "text/html", kDebugPlotPageGz, sizeof(kDebugPlotPageGz));
+        response->addHeader("Content-Encoding", "gzip");
+        request->send(response);
+    });
+    // The latest wind, for clients that only poll it. The ETag is the snapshot version, so
+    // a client sending it back in If-None-Match gets a 304 until the wind changed. The boot
+    // nonce keeps an ETag from before a restart from matching the restarted version count.
+    web_server->on("/wind", HTTP_GET, [](AsyncWebServerRequest* request) {
+        char json[WindSnapshot::kSize];
+        uint32_t version;
+        size_t length = windSnapshot.read(json, &version);
+        if (length == 0)
+        {
+            request->send(503);
+            return;
+        }
+        json[length] = '\0';
+        char etag[24];
+        snprintf(etag, sizeof(etag), "\"%08x-%u\"", (unsigned)bootNonce, (unsigned)version);
+
+        AsyncWebServerResponse* response;
+        if (request->hasHeader("If-None-Match") && (request->getHeader("If-None-Match")->value() == etag))
+        {
+            snapshotNotModified++;
+            response = request->beginResponse(304, "application/json", "");
+        }
+        else
+        {
+            snapshotServed++;
+            response = request->beginResponse(200, "application/json", json);
+        }
+        response->addHeader("ETag", etag);
+        response->addHeader("Cache-Control", "no-cache");
+        request->send(response);
+    });
+    // Prometheus text format, rendered into metricsText and sent from there. One scrape
+    // at a time, a concurrent one gets a 503.
+    web_server->on("/metrics", HTTP_GET, [](AsyncWebServerRequest* request) {
+        if (metricsBusy)
+        {
+            request->send(503);
+            return;
+        }
+        metricsBusy = true;
+        metricsLength = renderMetrics(metricsText, METRICS_BUFFER);
+        request->onDisconnect([]() {metricsBusy = false;});
+        request->send(request->beginChunkedResponse("text/plain; version=0.0.4", [](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+            size_t chunk = min(maxLen, metricsLength - index);
+            memcpy(buffer, metricsText + index, chunk);
+            return chunk;
+        }));
+    });
+    app.onRepeat(1000, []() {loopStackFree = uxTaskGetStackHighWaterMark(NULL);});
+#ifdef TRACE_ENABLED
+    // Chrome trace_event JSON of the last TRACE_EVENTS events, for ui.perfetto.dev.
+    // The recording pauses while the dump is sent.
+    web_server->on("/trace", HTTP_GET, [](AsyncWebServerRequest* request) {
+        if (!Tracer::start_dump())
+        {
+            request->send(409, "application/json", "{}");
+            return;
+        }
+        request->onDisconnect([]() {Tracer::end_dump();});
+        request->send(request->beginChunkedResponse("application/json", [](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+            return Tracer::read_dump(buffer, maxLen);
+        }));
+    });
+    WiFi.onEvent([](WiFiEvent_t event, WiFiEventInfo_t info) {TRACE_INSTANT("WiFi event", event);});
+#endif
+    web_server->begin();
+    app.onRepeat(DEBUG_INTERVAL, []() {if (debug->get_value()) {printDebug();}});
+    app.onRepeat(DEBUG_PUMP_INTERVAL, []() {debugTelemetry.pump();});
+    app.onRepeat(DEBUG_STREAM_INTERVAL, []() {flushDebugStream();});
+
+    // Settings that were still read from their own files move into the store
+    beginFlashWrite();
+    config_store->flush();
+    endFlashWrite();
+    Serial.printf("Settings: %d read from the store in %lu us, %d from their own files in %lu us\n",
+                  config_store->get_settings() - config_store->get_file_reads(), config_store->get_load_us(),
+                  config_store->get_file_reads(), config_store->get_file_read_us());
+    app.onRepeat(100, []() {flushSettings();});
 
     sensesp_app->start();
 }
 
+template <int Level>
 void IRAM_ATTR readWindSpeed()
 {
-    // Despite the interrupt being set to FALLING edge, double check the pin is now LOW
-    if (((micros() - speedPulse) > DEBOUNCE) && (digitalRead(windSpeedPin) == LOW))
+    TRACE_SCOPE("readWindSpeed");
+    // Despite the interrupt being set to the leading edge, double check the pin is now active
+    if (((micros() - speedPulse) > debounce) && (digitalRead(windSpeedPin) == Level))
     {
-        // Work out time difference between last pulse and now
-        speedTime = micros() - speedPulse;
-        // Direction pulse should have occured after the last speed pulse
-        if (dirPulse - speedPulse >= 0) directionTime = dirPulse - speedPulse;
-
-        speedPulse = micros();    // Capture time of the new speed pulse
+        captureSpeedPulse(micros());
     }
 }
 
+template <int Level>
 void IRAM_ATTR readWindDir()
 {
-    if (((micros() - dirPulse) > DEBOUNCE) && (digitalRead(windDirPin) == LOW))
+    TRACE_SCOPE("readWindDir");
+    if (((micros() - dirPulse) > debounce) && (digitalRead(windDirPin) == Level))
     {
-      dirPulse = micros();        // Capture time of direction pulse
+      captureDirPulse(micros());
     }
 }
 
-boolean checkSpeedDev(long cmps, int dev)
+void IRAM_ATTR captureSpeedPulse(unsigned long now)
+{
+    // Work out time difference between last pulse and now
+    speedTime = now - speedPulse;
+    // Direction pulse should have occured after the last speed pulse
+    if (dirPulse - speedPulse >= 0) directionTime = dirPulse - speedPulse;
+
+    speedPulse = now;    // Capture time of the new speed pulse
+    if (flashWriting) flashWriteCaptures++;
+    queueRevolution();
+}
+
+void IRAM_ATTR captureDirPulse(unsigned long now)
 {
-    if (cmps < BAND_0)
+    dirPulse = now;        // Capture time of direction pulse
+}
+
+// Drain the sample history of the polled mode and replay the decoded edges, in time
+// order, into the same capture as the interrupt path
+void decodePolledSamples()
+{
+    uint32_t speedWord, dirWord, firstSample;
+    uint32_t speedEdges[POLL_MAX_EDGES];
+    uint32_t dirEdges[POLL_MAX_EDGES];
+
+    while (polledSampler->read(&speedWord, &dirWord, &firstSample))
     {
-        if (abs(dev) < SPEED_DEV_LIMIT_0) return true;
+        int ns = speedDecoder.decode(speedWord, firstSample, speedEdges, POLL_MAX_EDGES);
+        int nd = dirDecoder.decode(dirWord, firstSample, dirEdges, POLL_MAX_EDGES);
+
+        int i = 0, j = 0;
+        while ((i < ns) || (j < nd))
+        {
+            if ((j < nd) && ((i >= ns) || ((int32_t)(dirEdges[j] - speedEdges[i]) <= 0)))
+            {
+                captureDirPulse(polledSampler->sample_time(dirEdges[j++]));
+            }
+            else
+            {
+                captureSpeedPulse(polledSampler->sample_time(speedEdges[i++]));
+            }
+        }
+    }
+}
+
+void armInterrupts()
+{
+    if (samplingMode != kInterruptSampling) return;
+    speedReaction = app.onInterrupt(windSpeedPin, inputs->edge, inputs->speed);
+    dirReaction = app.onInterrupt(windDirPin, inputs->edge, inputs->dir);
+}
+
+void disarmInterrupts()
+{
+    if (samplingMode != kInterruptSampling) return;
+    if (speedReaction != nullptr) speedReaction->remove();
+    if (dirReaction != nullptr) dirReaction->remove();
+    speedReaction = nullptr;
+    dirReaction = nullptr;
+}
+
+// Watch the edge rate on both inputs. During a storm the GPIO interrupts are masked
+// and the speed is measured from the (glitch filtered) pulse counter instead, while
+// the direction is held, as there is no phase information without the interrupts.
+// Polled sampling is immune to storms (the CPU load does not depend on the edge rate
+// and the debouncing rejects the oscillation), so there the storm is only notified.
+void checkStorm()
+{
+    static unsigned int gateWindows = 0;
+    static unsigned long gateCount = 0ul;
+
+    uint32_t speedEdges = speedCounter->read_delta();
+    uint32_t dirEdges = dirCounter->read_delta();
+    speedEdgeRate = speedEdges * 1000ul / STORM_WINDOW;
+    dirEdgeRate = dirEdges * 1000ul / STORM_WINDOW;
+
+    if (stormGuard.update(max(speedEdges, dirEdges), STORM_WINDOW))
+    {
+        if (stormGuard.in_storm())
+        {
+            disarmInterrupts();
+            dirValid = (samplingMode != kInterruptSampling);
+            gateWindows = 0;
+            gateCount = 0ul;
+        }
+        else
+        {
+            armInterrupts();
+            dirValid = true;
+        }
+        notifyStorm(stormGuard.in_storm());
+        return;
+    }
+
+    if (!stormGuard.in_storm() || (samplingMode != kInterruptSampling)) return;
+
+    gateCount += speedEdges;
+    if (++gateWindows < STORM_GATE) return;
+
+    // Only use the count if it is plausible, otherwise let the speed time out to zero.
+    // The interrupts are masked, so the capture variables can be written directly.
+    if ((gateCount > 0ul) && (gateCount * 1000ul <= model->saneRate * STORM_WINDOW * STORM_GATE))
+    {
+        speedTime = (STORM_WINDOW * STORM_GATE * 1000ul) / gateCount;
+        speedPulse = micros();
+        queueRevolution();
+    }
+    gateWindows = 0;
+    gateCount = 0ul;
+}
+
+// PCNT interrupt of the counter mode, PHASE_INTERVAL revolutions are complete
+// (H_LIM) or the first revolution after that is complete (THRES_0)
+void IRAM_ATTR onSpeedCounterEvent(uint32_t status)
+{
+    unsigned long now = micros();
+
+    if (status & PCNT_EVT_H_LIM)
+    {
+        counterWraps++;
+        wrapTime = now;
+
+        phaseStart = now;
+        phaseDirCaptured = false;
+        phaseArmed = true;
+        GPIO.pin[windDirPin].int_type = inputs->intrType;
+    }
+    else if ((status & PCNT_EVT_THRES_0) && phaseArmed)
+    {
+        GPIO.pin[windDirPin].int_type = GPIO_INTR_DISABLE;
+        phaseArmed = false;
+        // Without a direction pulse, keep the previous phase
+        if (phaseDirCaptured) directionTime = dirPulse - phaseStart;
+    }
+}
+
+void IRAM_ATTR readWindDirPhase()
+{
+    // One capture per phase sample, any further edge is bounce
+    GPIO.pin[windDirPin].int_type = GPIO_INTR_DISABLE;
+    captureDirPulse(micros());
+    phaseDirCaptured = true;
+}
+
+// Reciprocal counting: the speed is the time between the first and the last block of
+// PHASE_INTERVAL revolutions seen in the gate window, divided by the revolutions in
+// between. The gate simply extends when no block completed within it.
+// The glitch filter of the counter (12.8 us at most) passes the bounce of a reed switch,
+// so a period below the debounce time of the model is bounce counted as revolutions and
+// is discarded. Bounce on only some of the pulses still goes unnoticed, so the counter
+// mode is meant for bounce-free (hall or optical) sensors.
+void gateSpeedCounter()
+{
+    static unsigned long prevWraps = 0ul;
+    static unsigned long prevWrapTime = 0ul;
+
+    noInterrupts();
+    unsigned long wraps = counterWraps;
+    unsigned long time = wrapTime;
+    interrupts();
+
+    if (wraps == prevWraps) return;
+
+    if (prevWraps > 0ul)
+    {
+        unsigned long revolutions = (wraps - prevWraps) * PHASE_INTERVAL;
+        unsigned long period = (time - prevWrapTime) / revolutions;
+        if (period < model->debounce)
+        {
+            counterBounces++;
+        }
+        else
+        {
+            noInterrupts();
+            speedTime = period;
+            speedPulse = time;
+            queueRevolution();
+            interrupts();
+        }
     }
-    else if (cmps < BAND_1)
+    prevWraps = wraps;
+    prevWrapTime = time;
+}
+
+void notifyStorm(boolean storm)
+{
+    if (storm)
     {
-        if (abs(dev) < SPEED_DEV_LIMIT_1) return true;
+        storm_notification->set_input(R"({"state":"alarm","method":["visual"],"message":"Interrupt storm on the wind sensor inputs, check the masthead cable"})");
     }
     else
     {
-        if (abs(dev) < SPEED_DEV_LIMIT_2) return true;
+        storm_notification->set_input(R"({"state":"normal","method":[],"message":"Wind sensor inputs back to normal"})");
     }
-    return false;
 }
 
-boolean checkDirDev(long cmps, int dev)
+// The counter mode and the storm fallback measure the mean period of several revolutions
+boolean truePeriods()
+{
+    return (samplingMode != kCounterSampling) && !stormGuard.in_storm();
+}
+
+// Queue the revolution just captured for drainRevolutions()
+void IRAM_ATTR queueRevolution()
+{
+    Revolution rev = {speedPulse, speedTime, directionTime};
+    revolutionQueue.push(rev);
+}
+
+// Consume every captured revolution. The wear monitor needs the true revolution
+// periods, which the counter mode and the storm fallback do not capture. In resampling
+// mode every revolution is processed, rather than update_rate snapshots.
+void drainRevolutions()
 {
-    if (cmps < BAND_0)
+    static unsigned long lastSpeedPulse = 0ul;
+    static unsigned long lastSpeedTime = 0ul;
+    static boolean turning = false;
+    boolean measured = truePeriods();
+    // Before draining, so every revolution up to now is processed before the timeouts
+    unsigned long now = micros();
+    Revolution rev;
+
+    while (revolutionQueue.pop(&rev))
     {
-        if ((abs(dev) < DIR_DEV_LIMIT_0) || (abs(dev) > 360 - DIR_DEV_LIMIT_0)) return true;
+        // A period measured across a settings write is distorted, drop it
+        boolean distorted = overlapsFlashWrite(rev.speedPulse, rev.speedTime);
+        if (measured && !distorted) wearMonitor.add_period(rev.speedTime);
+        if ((resampleRate > 0) && !distorted)
+        {
+            model->process(rev.speedPulse, rev.speedTime, rev.directionTime);
+            resampler.add(rev.speedPulse, wind_context.speed_out, wind_context.dir_out);
+        }
+        lastSpeedPulse = rev.speedPulse;
+        lastSpeedTime = rev.speedTime;
+        turning = true;
     }
-    else if (cmps < BAND_1)
+
+    // A revolution captured while draining can be later than now
+    if ((long)(now - lastSpeedPulse) > (long)speedTimeout())
     {
-        if ((abs(dev) < DIR_DEV_LIMIT_1) || (abs(dev) > 360 - DIR_DEV_LIMIT_1)) return true;
+        if (turning && measured) wearMonitor.add_stall(lastSpeedTime);
+        turning = false;
+        if (resampleRate > 0) model->process(lastSpeedPulse, 0ul, 0ul);
+    }
+    if (resampleRate > 0) resampler.advance(now, speedTimeout());
+}
+
+// Maximum time allowed between two captures, as the counter mode only captures
+// every PHASE_INTERVAL revolutions
+unsigned long speedTimeout()
+{
+    return (samplingMode == kCounterSampling) ? TIMEOUT * PHASE_INTERVAL : TIMEOUT;
+}
+
+// Fall back to the default pin if the configured one is not a usable input
+uint8_t checkPin(int pin, uint8_t fallback, int maxPin)
+{
+    // GPIO 6 to 11 are taken by the flash
+    if ((pin >= 0) && (pin <= maxPin) && ((pin < 6) || (pin > 11))) return pin;
+    Serial.printf("GPIO %d can not be used as input, using %d\n", pin, fallback);
+    return fallback;
+}
+
+// Select the interrupt handlers of the polarity, before the interrupts are armed, and
+// count and decode the leading edges in the other sampling modes
+void setPolarity(boolean activeHigh)
+{
+    inputs = activeHigh ? &ACTIVE_HIGH_INPUTS : &ACTIVE_LOW_INPUTS;
+    speedCounter->set_active_high(activeHigh);
+    dirCounter->set_active_high(activeHigh);
+    speedDecoder.set_active_high(activeHigh);
+    dirDecoder.set_active_high(activeHigh);
+}
+
+// Switch the processing to another model, and start the vane sampling if it has an analog vane
+void selectModel(const ModelEntry* entry)
+{
+    model = entry;
+    debounce = model->debounce;
+    stormGuard.set_rates(model->stormRate, model->saneRate);
+    if (model->signature.direction != kAnalogVane) return;
+
+    analogVane->set_dead_zone(model->signature.vane_dead_zone);
+    if (analogVaneStarted) return;
+
+    // The vane is sampled continuously by DMA, 10 ms batches are 200 samples
+    analogVaneStarted = analogVane->begin();
+    if (analogVaneStarted)
+    {
+        app.onRepeat(10, []() {analogVane->update();});
     }
     else
     {
-        if ((abs(dev) < DIR_DEV_LIMIT_2) || (abs(dev) > 360 - DIR_DEV_LIMIT_2)) return true;
+        Serial.printf("Analog vane: pin %d is not an ADC1 input or the ADC failed to start\n", windVanePin);
+    }
+}
+
+// Observe the inputs for DETECT_TIME, sampling the speed input level every millisecond
+// and the vane input every 10 ms. The pulse counters count in every sampling mode.
+void startDetection()
+{
+    if (detectReaction != nullptr) return;
+    modelDetector.start(speedCounter->get_total(), dirCounter->get_total());
+    detectReaction = app.onRepeat(1, []() {sampleDetection();});
+    app.onDelay(DETECT_TIME, []() {finishDetection();});
+}
+
+void sampleDetection()
+{
+    static uint8_t ticks = 0;
+    modelDetector.sample(digitalRead(windSpeedPin) == HIGH);
+    if (++ticks < 10) return;
+    ticks = 0;
+    // Once the vane is sampled by DMA, the ADC can not be read directly
+    modelDetector.sample_vane(analogVaneStarted ? analogVane->get_raw() : analogRead(windVanePin));
+}
+
+// Keep the active model if it matches the pattern, else take the only model that does,
+// see ModelDetector::select(). If several other models match, nothing changes.
+void finishDetection()
+{
+    detectReaction->remove();
+    detectReaction = nullptr;
+
+    detectedPattern = modelDetector.finish(speedCounter->get_total(), dirCounter->get_total());
+    ModelDetector::Selection selection = ModelDetector::select(detectedPattern, MODELS, MODEL_COUNT, (int)(model - MODELS));
+    detectResult = selection.result;
+    if (selection.index < 0)
+    {
+        Serial.printf("Anemometer detection: %s (%u speed, %u direction pulses, bounce %s, dead zone %s), keeping %s\n",
+                      detectResult, (unsigned int)detectedPattern.speed_pulses, (unsigned int)detectedPattern.dir_pulses,
+                      detectedPattern.bounce_known ? (detectedPattern.bounce ? "yes" : "no") : "unknown",
+                      detectedPattern.dead_zone_known ? (detectedPattern.dead_zone ? "yes" : "no") : "unknown",
+                      model->name);
+        return;
+    }
+    selectModel(&MODELS[selection.index]);
+
+    // Re-arm the interrupts on the other edge, unless they are masked by the storm guard.
+    // The pulse counters and the polled decoders switch edges too.
+    boolean activeHigh = detectedPattern.active_high;
+    if (activeHigh != (inputs == &ACTIVE_HIGH_INPUTS))
+    {
+        boolean armed = (speedReaction != nullptr);
+        disarmInterrupts();
+        setPolarity(activeHigh);
+        if (armed) armInterrupts();
+    }
+    Serial.printf("Anemometer detection: %s %s, active %s\n", detectResult, model->name, detectedPattern.active_high ? "high" : "low");
+}
+
+String detectionStatus()
+{
+    String json = String("{\"active\":") + (detectReaction != nullptr ? "true" : "false")
+        + ",\"result\":\"" + detectResult + "\""
+        + ",\"model\":\"" + model->name + "\""
+        + ",\"valid\":" + (detectedPattern.valid ? "true" : "false")
+        + ",\"speed_pulses\":" + String((int)detectedPattern.speed_pulses)
+        + ",\"dir_pulses\":" + String((int)detectedPattern.dir_pulses)
+        + ",\"analog_vane\":" + (detectedPattern.analog_vane ? "true" : "false")
+        + ",\"pulses_per_revolution\":" + String(detectedPattern.pulses_per_revolution)
+        + ",\"bounce\":" + (detectedPattern.bounce_known ? (detectedPattern.bounce ? "true" : "false") : "null")
+        + ",\"dead_zone\":" + (detectedPattern.dead_zone_known ? (detectedPattern.dead_zone ? "true" : "false") : "null")
+        + ",\"active_high\":" + (detectedPattern.active_high ? "true" : "false") + "}";
+    return json;
+}
+
+// Write the changed settings behind, from the main loop
+void flushSettings()
+{
+    if (!config_store->is_due(millis())) return;
+
+    // The pulse counter keeps counting while the flash cache is off, the interrupt does not:
+    // the edges it missed are the difference, logged with each write as the measured cost
+    uint32_t edges = speedCounter->get_total();
+    uint32_t captures = flashWriteCaptures;
+    unsigned long start = micros();
+    beginFlashWrite();
+    boolean written = config_store->flush();
+    endFlashWrite();
+    edges = speedCounter->get_total() - edges;
+    captures = flashWriteCaptures - captures;
+
+    Serial.printf("Settings %s in %lu us, %u speed edges counted, %u captured by the interrupt\n",
+                  written ? "written" : "NOT written", micros() - start, (unsigned int)edges,
+                  (unsigned int)captures);
+}
+
+// Every flash write runs in the main loop between these two. The flash cache is off during
+// the write, so the GPIO interrupts are deferred until it ends (the pulse counters keep
+// counting, flushSettings() logs how many edges the interrupt missed), and any period
+// spanning the write is discarded by overlapsFlashWrite(). Writes closer together than the
+// longest period are merged, so that a period spanning several of them is caught as well.
+void beginFlashWrite()
+{
+    unsigned long now = micros();
+    if ((long)(now - flashWriteEnd) > (long)TIMEOUT) flashWriteStart = now;
+    flashWriting = true;
+}
+
+void endFlashWrite()
+{
+    flashWriteEnd = micros();
+    flashWriting = false;
+}
+
+// The period from speedPulse_ - speedTime_ to speedPulse_ overlaps the last flash writes
+boolean overlapsFlashWrite(unsigned long speedPulse_, unsigned long speedTime_)
+{
+    if (flashWriteEnd == flashWriteStart) return false;
+    return ((long)(flashWriteEnd - (speedPulse_ - speedTime_)) >= 0) && ((long)(speedPulse_ - flashWriteStart) >= 0);
+}
+
+// Precompute the coefficients when the profile, or a setting of the custom profile, changed
+void checkFilterProfile()
+{
+    int profile = constrain(filter_profile->get_value(), 0, kFilterProfileCount - 1);
+    float gain = filter_gain->get_value();
+    int rate = update_rate->get_value();
+    if ((profile == activeProfile) && ((profile != kCustomProfile) || ((gain == customGain) && (rate == customRate)))) return;
+
+    FilterProfile settings = kFilterProfiles[profile];
+    if (profile == kCustomProfile)
+    {
+        settings.dir_gain = gain;
+        settings.output_interval = rate;
+    }
+    int previousInterval = (outputReaction != nullptr) ? wind_context.filter.output_interval : 0;
+    wind_context.filter.set(settings);
+    activeProfile = profile;
+    customGain = gain;
+    customRate = rate;
+    profile_output->set_input(settings.name);
+
+    // The snapshots are taken at the interval of the profile, the resampler keeps its own rate
+    if ((resampleRate == 0) && (wind_context.filter.output_interval != previousInterval))
+    {
+        if (outputReaction != nullptr) outputReaction->remove();
+        outputReaction = app.onRepeat(wind_context.filter.output_interval, []() {calcWindSpeedAndDir();});
     }
-    return false;
 }
 
 void calcWindSpeedAndDir()
 {
-    unsigned long dirPulse_, speedPulse_;
+    unsigned long speedPulse_;
     unsigned long speedTime_;
     unsigned long directionTime_;
-    long windDirection = 0l, cmps = 0l;
-
-    static int prevSpeed = 0;
-    static int prevDir = 0;
-    int dev = 0;
 
     // Get snapshot of data into local variables. Note: an interrupt could trigger here
     noInterrupts();
-    dirPulse_ = dirPulse;
     speedPulse_ = speedPulse;
     speedTime_ = speedTime;
     directionTime_ = directionTime;
     interrupts();
 
-    // Make speed zero, if the pulse delay is too long
-    if (micros() - speedPulse_ > TIMEOUT) speedTime_ = 0ul;
+    // Hold the previous values if the period was measured across a settings write
+    if (!overlapsFlashWrite(speedPulse_, speedTime_)) model->process(speedPulse_, speedTime_, directionTime_);
+
+    publishSample(wind_context.speed_out, wind_context.dir_out, wind_context.filter.output_interval/1000.0);
+}
 
-    // The following converts revolutions per 100 seconds (rps) to cm/s 
-    // (cm/s simply for precision and speed, divide by 100 later to get m/s)
-    // This calculation follows the Peet Bros. piecemeal calibration data
-    if (speedTime_ > 0)
+template <class Model>
+void processRevolution(unsigned long speedPulse_, unsigned long speedTime_, unsigned long directionTime_)
+{
+    static_assert((Model::kDirection != kPhasePulse) || (Model::kPulsesPerRevolution == 1),
+                  "The direction phase needs one speed pulse per revolution");
+
+    // The inputs of the stages, see WindContext
+    wind_context.timeout = speedTimeout();
+    wind_context.speed_table = &speed_table->get_table();
+    wind_context.dir_table = &dir_table->get_table();
+    wind_context.dir_offset = dir_config->get_offset();
+    wind_context.dir_sin = dir_config->get_sin();
+    wind_context.dir_cos = dir_config->get_cos();
+    wind_context.overspeed.set_distance_constant(distance_constant->get_value());
+    wind_context.true_periods = truePeriods();
+    wind_context.dir_valid = dirValid;
+    if (Model::kDirection == kAnalogVane)
     {
-        rps = 100000000/speedTime_;                  //revolutions per 100s
+        wind_context.vane_ready = analogVane->ready();
+        wind_context.vane_phase = analogVane->get_phase();
+    }
+    wind_context.on_phase = tableCalibrating ? trackPhase : nullptr;
 
-        if (rps < 323)
-        {
-          cmps = (rps * rps * -11)/22369 + (293 * rps)/223 - 12;
-        }
-        else if (rps < 5436)
-        {
-          cmps = (rps * rps / 2)/22369 + (220 * rps)/223 + 96;
-        }
-        else
-        {
-          cmps = (rps * rps * 11)/22369 - (957 * rps)/223 + 28664;
-        }
+    WindSample sample = {speedPulse_, speedTime_, directionTime_, 0l, 0l, 0, 0l, 0};
+    unsigned long start = micros();
+    wind_context.now = start;
+    boolean passed = WindPipeline<Model>::run(sample);
+    unsigned long end = micros();
+
+    pipelineMicros.observe(end - start);
+    // The snapshot mode processes the same revolution at every update and the stall
+    // check repeats the last pulse, so only count what was not counted before
+    if (sample.speed_time == 0ul)
+    {
+        if (speedPulse_ != lastTimeoutPulse) timeouts++;
+        lastTimeoutPulse = speedPulse_;
+    }
+    else if (speedPulse_ != lastProcessedPulse)
+    {
+        revolutionAge.observe(end - speedPulse_);
+        revolutions++;
+        if (!passed && (sample.stages < MAX_STAGES)) stageRejections[sample.stages]++;
+    }
+    lastProcessedPulse = speedPulse_;
+    if (debugStreaming) streamRevolution(sample, passed, Model::kDirection == kAnalogVane);
+}
+
+void trackPhase(uint16_t phase)
+{
+    float angle = phase * (6.2831853 / 65536.0);
+    phaseX += DIR_TABLE_SMOOTHING * (cos(angle) - phaseX);
+    phaseY += DIR_TABLE_SMOOTHING * (sin(angle) - phaseY);
+}
+
+String tableCalibrationStatus()
+{
+    String json = String("{\"active\":") + (tableCalibrating ? "true" : "false")
+        + ",\"points\":" + String(tableCalibrating ? tableCalibration.get_points() : dir_table->get_table().get_points())
+        + ",\"marks\":" + String(tablePairs)
+        + ",\"outcome\":\"" + tableCalibrationOutcome + "\""
+        + ",\"phase\":" + String((int)round(atan2(phaseY, phaseX) * 360.0 / 6.2831853)) + "}";
+    return json;
+}
+
+// Pair the smoothed sensor phase with the angle the vane is pointed at
+void recordTablePoint(float angle)
+{
+    if (!tableCalibrating || (tablePairs >= DIR_TABLE_MAX_PAIRS))
+    {
+        tableCalibrationOutcome = "point rejected";
+        return;
+    }
+    // The direction is the reversed phase, so a vane at +angle has a phase of -angle
+    tableMeasured[tablePairs] = (uint16_t)(long)round(atan2(phaseY, phaseX) * 65536.0 / 6.2831853);
+    tableReference[tablePairs] = (uint16_t)(long)round(-angle * 65536.0 / 360.0);
+    tablePairs++;
+    tableCalibrationOutcome = "point recorded";
+}
+
+boolean finishTableCalibration()
+{
+    if (!tableCalibrating || !tableCalibration.fit(tableMeasured, tableReference, tablePairs))
+    {
+        tableCalibrationOutcome = "no fit";
+        return false;
+    }
+    tableCalibrating = false;
+    dir_table->set(tableCalibration);
+    tableCalibrationOutcome = "applied";
+    return true;
+}
+
+// Every output sample, speed in cm/s and direction in degrees, standing for dt seconds.
+// The sinks each drain the bus at their own pace, reading the records in place.
+void publishSample(float speed, float direction, float dt)
+{
+    WindRecord record = {micros(), speed, direction, dt};
+    windBus.publish(record);
+}
+
+void drainSignalKSink()
+{
+    TRACE_SCOPE("SK emit");
+    const WindRecord* record;
+    while ((record = windBus.read(&skReader)) != nullptr)
+    {
+        speed_output->set_input((record->speed/100.0));
+        dir_output->set_input((record->direction*0.0174533));
+    }
+}
+
+void drainRecordSink()
+{
+    const WindRecord* record;
+    while ((record = windBus.read(&recordReader)) != nullptr)
+    {
+        recordOutput(record->speed, record->direction, record->dt);
+    }
+}
 
-        if (cmps < 0l) cmps = 0l;  // Remove the possibility of negative speed
-        // Find deviation from previous value
-        dev = (int)cmps - prevSpeed;
+void drainGustSink()
+{
+    const WindRecord* record;
+    while ((record = windBus.read(&gustReader)) != nullptr)
+    {
+        unsigned long start = micros();
+        gust_spectrum->add(record->speed);
+        unsigned long elapsed = micros() - start;
+        if (elapsed > gustMicros) gustMicros = elapsed;
+    }
+}
+
+// Serialize the latest sample for /wind, in Signal K units. Only a change of the speed
+// or angle makes a new version, millis is the time of the sample that changed them.
+void updateWindSnapshot()
+{
+    const WindRecord* record;
+    const WindRecord* latest = nullptr;
+    while ((record = windBus.read(&snapshotReader)) != nullptr) latest = record;
+    if (latest == nullptr) return;
 
-        // Only update output if in deviation limit
-        if (checkSpeedDev(cmps, dev))
+    char* json = windSnapshot.begin_update();
+    int compared = snprintf(json, WindSnapshot::kSize, "{\"speedApparent\":%.2f,\"angleApparent\":%.4f,",
+        latest->speed / 100.0, latest->direction * 0.0174533);
+    if ((compared <= 0) || (compared >= (int)WindSnapshot::kSize)) return;
+    int length = snprintf(json + compared, WindSnapshot::kSize - compared, "\"millis\":%lu}", latest->time / 1000ul);
+    if (length > 0) windSnapshot.commit(compared + length, compared);
+}
+
+// Replace a String the web task copies with copyPublished()
+void publishForWeb(String& published, const char* value)
+{
+    xSemaphoreTake(webLock, portMAX_DELAY);
+    published = value;
+    xSemaphoreGive(webLock);
+}
+
+String copyPublished(const String& published)
+{
+    xSemaphoreTake(webLock, portMAX_DELAY);
+    String copy = published;
+    xSemaphoreGive(webLock);
+    return copy;
+}
+
+// Queue a request for the loop, from a web server handler
+void postWebRequest(AsyncWebServerRequest* request, WebRequestType type, float value, const String& status)
+{
+    boolean queued = webRequests.push({type, value});
+    request->send(queued ? 202 : 503, "application/json", copyPublished(status));
+}
+
+void runWebRequests()
+{
+    WebRequest webRequest;
+    boolean ran = false;
+    while (webRequests.pop(&webRequest))
+    {
+        switch (webRequest.type)
         {
-          speedOut = cmps;
-
-          // If speed data is ok, then continue with direction data
-          if (directionTime_ > speedTime_)
-          {
-              windDirection = 999;    // For debugging only (not output to speed)
-          }
-          else
-          {
-            // Calculate direction from captured pulse times
-            windDirection = (((directionTime_ * 360) / speedTime_) - dir_offset->get_value()) % 360;
-            // resulting direction was reversed, rotating the wind vane clockwise gave counterclockwise readings, this corrects it:
-            windDirection = 360 - windDirection;
-
-            // Find deviation from previous value
-            dev = (int)windDirection - prevDir;
-
-            // Check deviation is in range
-            if (checkDirDev(cmps, dev))
-            {
-              int delta = ((int)windDirection - dirOut);
-              if (delta < -180)
-              {
-                delta = delta + 360;    // Take the shortest path when filtering
-              }
-              else if (delta > +180)
-              {
-                delta = delta - 360;
-              }
-              // Perform filtering to smooth the direction output
-              dirOut = (dirOut + (int)(round(filter_gain->get_value() * delta))) % 360;
-              if (dirOut < 0) dirOut = dirOut + 360;
-            }
-            prevDir = windDirection;
-          }
+        case kStartDirCalibration:
+            dirCalibrator.start();
+            dirCalibrating = true;
+            dirCalibrationOutcome = "none";
+            break;
+        case kFinishDirCalibration:
+            finishDirectionCalibration();
+            break;
+        case kStartTableCalibration:
+            tableCalibration.set_points((int)webRequest.value);
+            tablePairs = 0;
+            tableCalibrating = true;
+            tableCalibrationOutcome = "none";
+            break;
+        case kTablePoint:
+            recordTablePoint(webRequest.value);
+            break;
+        case kFinishTableCalibration:
+            finishTableCalibration();
+            break;
+        case kStartSpeedCalibration:
+            speedReference = (int)webRequest.value;
+            speedCalibrator.start();
+            speedReferenceAvg = 0.0;
+            speedMeasuredAvg = 0.0;
+            speedCalibrating = true;
+            speedCalibrationOutcome = "none";
+            break;
+        case kFinishSpeedCalibration:
+            finishSpeedCalibration();
+            break;
+        case kResetWear:
+            wearMonitor.reset_baseline();
+            saveWear();
+            break;
+        case kStartDetection:
+            startDetection();
+            break;
         }
-        else
+        ran = true;
+    }
+    if (ran) publishWebStatus();
+}
+
+// The status of the calibrations, the wear monitor and the detection, for the web server
+void publishWebStatus()
+{
+    String json = String("{\"active\":") + (dirCalibrating ? "true" : "false")
+        + ",\"samples\":" + String((int)dirCalibrator.get_samples())
+        + ",\"outcome\":\"" + dirCalibrationOutcome + "\""
+        + ",\"result\":" + dirCalibrationResult + "}";
+    publishForWeb(dirCalibrationJson, json.c_str());
+    publishForWeb(tableCalibrationJson, tableCalibrationStatus().c_str());
+    publishForWeb(speedCalibrationJson, speedCalibrationStatus().c_str());
+    publishForWeb(wearJson, wearStatus().c_str());
+    publishForWeb(detectionJson, detectionStatus().c_str());
+}
+
+void recordOutput(float speed, float direction, float dt)
+{
+    recordWindRose(speed, direction, dt);
+    if (dirCalibrating) feedDirectionCalibration(speed, direction);
+    if (speedCalibrating) feedSpeedCalibration(speed, dt);
+}
+
+void feedDirectionCalibration(float speed, float direction)
+{
+    float stw = stw_listener->get();
+    if ((stw < DIR_CAL_MIN_STW) || (speed <= 0.0)) return;
+
+    dirCalibrator.add(direction, direction - dir_config->get_offset(), speed/100.0, heading_listener->get(), stw);
+    if (dirCalibrator.get_samples() >= DIR_CAL_MAX_SAMPLES) finishDirectionCalibration();
+}
+
+// Apply the fit on top of the current correction, all values in one configuration write
+boolean finishDirectionCalibration()
+{
+    DirectionCalibration cal;
+    dirCalibrating = false;
+    if (!dirCalibrator.solve(&cal))
+    {
+        dirCalibrationOutcome = "no fit";
+        return false;
+    }
+
+    dir_config->set(dir_config->get_offset() + (int)round(cal.offset),
+                    dir_config->get_sin() + cal.sin_amplitude,
+                    dir_config->get_cos() + cal.cos_amplitude);
+
+    char buf[160];
+    snprintf(buf, sizeof(buf), "{\"offset\":%.1f,\"sin\":%.2f,\"cos\":%.2f,\"speed_scale\":%.3f,\"true_wind\":%.2f,\"samples\":%u}",
+             cal.offset, cal.sin_amplitude, cal.cos_amplitude, cal.speed_scale, cal.true_wind, (unsigned int)dirCalibrator.get_samples());
+    dirCalibrationResult = buf;
+    dirCalibrationOutcome = "applied";
+    return true;
+}
+
+// Pair the averaged speeds while the reference is steady, the rotor rate selects the table point
+void feedSpeedCalibration(float speed, float dt)
+{
+    float reference;
+    if (speedReference == kTrueWindReference)
+    {
+        if (sog_listener->get() > SPEED_CAL_AT_REST) return;
+        reference = true_wind_listener->get();
+    }
+    else
+    {
+        reference = sog_listener->get();
+    }
+
+    float measured = speed/100.0;
+    if (speedReferenceAvg <= 0.0)
+    {
+        speedReferenceAvg = reference;
+        speedMeasuredAvg = measured;
+    }
+    float gain = dt / SPEED_CAL_TIME_CONSTANT;
+    if (gain > 1.0) gain = 1.0;
+    speedReferenceAvg += gain * (reference - speedReferenceAvg);
+    speedMeasuredAvg += gain * (measured - speedMeasuredAvg);
+
+    if ((speedReferenceAvg < SPEED_CAL_MIN_SPEED) ||
+        (fabs(reference - speedReferenceAvg) > SPEED_CAL_STEADY * speedReferenceAvg)) return;
+
+    speedCalibrator.add(speedMeasuredAvg, speedReferenceAvg, wind_context.rps);
+    if (speedCalibrator.get_pairs() >= SPEED_CAL_MAX_PAIRS) finishSpeedCalibration();
+}
+
+// Refine the current table by the fit, in one configuration write
+boolean finishSpeedCalibration()
+{
+    speedCalibrating = false;
+    SpeedTable table = speed_table->get_table();
+    if (!speedCalibrator.fit(&table))
+    {
+        speedCalibrationOutcome = "no fit";
+        return false;
+    }
+    speed_table->set(table);
+
+    String json = "[";
+    for (int i = 0; i < SpeedTable::kPoints; i++)
+    {
+        if (i > 0) json += ",";
+        json += String(table.get(i) * 100.0 / 1024.0, 1);
+    }
+    speedCalibrationResult = json + "]";
+    speedCalibrationOutcome = "applied";
+    return true;
+}
+
+String speedCalibrationStatus()
+{
+    String json = String("{\"active\":") + (speedCalibrating ? "true" : "false")
+        + ",\"reference\":\"" + (speedReference == kTrueWindReference ? "true_wind" : "ground") + "\""
+        + ",\"pairs\":" + String((int)speedCalibrator.get_pairs())
+        + ",\"outcome\":\"" + speedCalibrationOutcome + "\""
+        + ",\"result\":" + speedCalibrationResult + "}";
+    return json;
+}
+
+void recordWindRose(float speed, float direction, float dt)
+{
+    windRoseHour.add(speed, direction, dt);
+    windRoseDay.add(speed, direction, dt);
+}
+
+// Serialize the wind rose once per WIND_ROSE_PUBLISH, rather than per request. Cells
+// hold the (exponentially decayed) seconds per direction sector and speed bin.
+void publishWindRose()
+{
+    static char buf[4096];
+    size_t len = snprintf(buf, sizeof(buf), "{\"sectors\":%d,\"speed_bins\":[", WindRose::kSectors);
+    for (int b = 0; b < WindRose::kSpeedBins; b++)
+    {
+        len += snprintf(buf + len, sizeof(buf) - len, "%s%.0f", (b > 0) ? "," : "", WindRose::kSpeedBinEdges[b]/100.0);
+    }
+    len += snprintf(buf + len, sizeof(buf) - len, "],\"hour\":");
+    len += windRoseHour.to_json(buf + len, sizeof(buf) - len);
+    len += snprintf(buf + len, sizeof(buf) - len, ",\"day\":");
+    len += windRoseDay.to_json(buf + len, sizeof(buf) - len);
+    snprintf(buf + len, sizeof(buf) - len, "}");
+    publishForWeb(windRoseJson, buf);
+}
+
+void saveWindRose()
+{
+    static float cells[WindRose::kSectors * WindRose::kSpeedBins];
+    beginFlashWrite();
+    File file = SPIFFS.open(WIND_ROSE_FILE, "w");
+    if (file)
+    {
+        file.write((const uint8_t*)&WIND_ROSE_MAGIC, sizeof(WIND_ROSE_MAGIC));
+        windRoseHour.export_cells(cells);
+        file.write((const uint8_t*)cells, sizeof(cells));
+        windRoseDay.export_cells(cells);
+        file.write((const uint8_t*)cells, sizeof(cells));
+        file.close();
+    }
+    endFlashWrite();
+}
+
+void loadWindRose()
+{
+    static float cells[WindRose::kSectors * WindRose::kSpeedBins];
+    uint32_t magic = 0ul;
+    if (!SPIFFS.exists(WIND_ROSE_FILE)) return;
+    File file = SPIFFS.open(WIND_ROSE_FILE, "r");
+    if (!file) return;
+    if ((file.read((uint8_t*)&magic, sizeof(magic)) == sizeof(magic)) && (magic == WIND_ROSE_MAGIC))
+    {
+        if (file.read((uint8_t*)cells, sizeof(cells)) == sizeof(cells)) windRoseHour.import_cells(cells);
+        if (file.read((uint8_t*)cells, sizeof(cells)) == sizeof(cells)) windRoseDay.import_cells(cells);
+    }
+    file.close();
+}
+
+// Warn when the index is over the limit, or rising fast enough to get there within
+// WEAR_TREND_DAYS of operation
+void publishWear()
+{
+    static int alert = kWearOk;
+    wearMonitor.add_time(WEAR_PUBLISH / 1000ul);
+    float index = wearMonitor.get_wear_index();
+    float days = wearMonitor.days_until(WEAR_ALERT);
+
+    wear_output->set_input(index);
+
+    int level = alert;
+    if (index > WEAR_ALERT)
+    {
+        level = kWearWorn;
+    }
+    else if ((days >= 0.0) && (days < WEAR_TREND_DAYS))
+    {
+        level = max(alert, (int)kWearRising);
+    }
+    else if ((index < WEAR_CLEAR) && ((days < 0.0) || (days > 2.0 * WEAR_TREND_DAYS)))
+    {
+        level = kWearOk;
+    }
+    if (level == alert) return;
+
+    alert = level;
+    if (level == kWearWorn)
+    {
+        wear_notification->set_input(R"({"state":"warn","method":["visual"],"message":"Anemometer bearings worn, the sensor may under-read"})");
+    }
+    else if (level == kWearRising)
+    {
+        wear_notification->set_input(R"({"state":"warn","method":["visual"],"message":"Anemometer bearing wear rising, service due within a month of use"})");
+    }
+    else
+    {
+        wear_notification->set_input(R"({"state":"normal","method":[],"message":"Anemometer bearings ok"})");
+    }
+}
+
+String wearStatus()
+{
+    const WearBaseline& baseline = wearMonitor.get_baseline();
+    String json = String("{\"index\":") + String(wearMonitor.get_wear_index(), 3)
+        + ",\"trend_per_day\":" + String(wearMonitor.get_trend(), 5)
+        + ",\"baseline_windows\":" + String((int)baseline.windows)
+        + ",\"baseline_stalls\":" + String((int)baseline.stalls)
+        + ",\"days\":" + String((int)wearMonitor.get_history().days) + "}";
+    return json;
+}
+
+// The baseline and the current values, so that the index is valid right after a restart
+void saveWear()
+{
+    WearBaseline baseline = wearMonitor.get_baseline();
+    WearHistory history = wearMonitor.get_history();
+    beginFlashWrite();
+    File file = SPIFFS.open(WEAR_FILE, "w");
+    if (file)
+    {
+        file.write((const uint8_t*)&WEAR_MAGIC, sizeof(WEAR_MAGIC));
+        file.write((const uint8_t*)&baseline, sizeof(baseline));
+        file.write((const uint8_t*)&history, sizeof(history));
+        file.close();
+    }
+    endFlashWrite();
+}
+
+// A file of the first version has the baseline only, the current values are then relearned
+void loadWear()
+{
+    WearBaseline baseline;
+    WearHistory history;
+    uint32_t magic = 0ul;
+    if (!SPIFFS.exists(WEAR_FILE)) return;
+    File file = SPIFFS.open(WEAR_FILE, "r");
+    if (!file) return;
+    if ((file.read((uint8_t*)&magic, sizeof(magic)) == sizeof(magic)) && ((magic == WEAR_MAGIC) || (magic == WEAR_MAGIC_V1))
+        && (file.read((uint8_t*)&baseline, sizeof(baseline)) == sizeof(baseline)))
+    {
+        wearMonitor.set_baseline(baseline);
+        if ((magic == WEAR_MAGIC) && (file.read((uint8_t*)&history, sizeof(history)) == sizeof(history)))
         {
-          ignoreNextReading = true;
+            wearMonitor.set_history(history);
         }
+    }
+    file.close();
+}
 
-        prevSpeed = cmps;    // Update, even if outside deviation limit, cause it might be valid!?
+size_t renderMetrics(char* buffer, size_t size)
+{
+    MetricsWriter metrics(buffer, size);
+
+    metrics.gauge("wind_speed_apparent_mps", "Apparent wind speed, filtered", wind_context.speed_out / 100.0f);
+    metrics.gauge("wind_angle_apparent_rad", "Apparent wind angle, filtered", wind_context.dir_out * 0.0174533f);
+    metrics.gauge("wind_rotor_revolutions_per_100s", "Rotor speed of the last revolution", (float)wind_context.rps);
+    if (gust_spectrum != nullptr)
+    {
+        metrics.gauge("wind_gust_mean_mps", "Mean apparent wind speed of the gust window", gustStats.mean / 100.0f);
+        metrics.gauge("wind_gust_stddev_mps", "Standard deviation of the apparent wind speed in the gust window", gustStats.std_dev / 100.0f);
+        metrics.gauge("wind_turbulence_intensity", "Standard deviation over mean of the apparent wind speed", gustStats.turbulence_intensity);
+        metrics.gauge("wind_gust_period_seconds", "Period of the strongest gust component", gustStats.peak_period);
+        metrics.gauge("wind_gust_energy_m2s2", "Variance of the apparent wind speed in the gust band", gustStats.band_energy / 10000.0f);
     }
-    else
+
+    metrics.counter("wind_revolutions_total", "Revolutions processed", revolutions);
+    metrics.family("wind_rejections_total", "counter", "Revolutions rejected, by the processing stage that rejected them");
+    char labels[48];
+    for (int i = 0; (i < WindPipeline<Anemometer>::kStages) && (i < MAX_STAGES); i++)
+    {
+        snprintf(labels, sizeof(labels), "stage=\"%s\"", WindPipeline<Anemometer>::stage_name(i));
+        metrics.sample("wind_rejections_total", labels, stageRejections[i]);
+    }
+    metrics.counter("wind_timeouts_total", "Stalls, no speed pulse within the timeout", timeouts);
+    metrics.histogram("wind_revolution_age_microseconds", "Time from the speed pulse to the processing of the revolution", revolutionAge);
+    metrics.histogram("wind_pipeline_microseconds", "Processing time of a revolution", pipelineMicros);
+
+    metrics.family("wind_input_edge_rate", "gauge", "Edges per second on the inputs");
+    metrics.sample("wind_input_edge_rate", "input=\"speed\"", speedEdgeRate);
+    metrics.sample("wind_input_edge_rate", "input=\"direction\"", dirEdgeRate);
+    metrics.counter("wind_interrupt_storms_total", "Interrupt storms detected", stormGuard.get_storm_count());
+    metrics.counter("wind_counter_bounce_total", "Pulse counter measurements discarded as switch bounce", counterBounces);
+    metrics.family("wind_sample_bus_overruns_total", "counter", "Samples a sink missed because it fell behind");
+    metrics.sample("wind_sample_bus_overruns_total", "sink=\"signalk\"", skReader.get_overruns());
+    metrics.sample("wind_sample_bus_overruns_total", "sink=\"recorder\"", recordReader.get_overruns());
+    metrics.sample("wind_sample_bus_overruns_total", "sink=\"gust\"", gustReader.get_overruns());
+    metrics.sample("wind_sample_bus_overruns_total", "sink=\"snapshot\"", snapshotReader.get_overruns());
+    metrics.family("wind_snapshot_requests_total", "counter", "Requests of /wind, by response code");
+    metrics.sample("wind_snapshot_requests_total", "code=\"200\"", snapshotServed);
+    metrics.sample("wind_snapshot_requests_total", "code=\"304\"", snapshotNotModified);
+
+    metrics.gauge("esp_heap_free_bytes", "Free heap", ESP.getFreeHeap());
+    metrics.gauge("esp_heap_min_free_bytes", "Lowest free heap since boot", ESP.getMinFreeHeap());
+    metrics.gauge("esp_heap_max_alloc_bytes", "Largest allocatable heap block", ESP.getMaxAllocHeap());
+    metrics.gauge("esp_loop_stack_min_free_bytes", "Lowest free stack of the main loop task", (uint32_t)loopStackFree);
+    metrics.gauge("esp_uptime_seconds", "Time since boot", (uint32_t)(millis() / 1000ul));
+
+    if (metrics.overflow()) Serial.printf("Metrics truncated, METRICS_BUFFER is too small\n");
+    return metrics.length();
+}
+
+// Queue the revolution for the debug chart
+void streamRevolution(const WindSample& sample, boolean passed, boolean analogVane)
+{
+    DebugFrame frame;
+    frame.speed_pulse = sample.speed_pulse;
+    frame.speed_time = sample.speed_time;
+    frame.direction_time = sample.direction_time;
+    frame.phase = sample.phase;
+    frame.cmps = constrain(sample.cmps, 0l, 65535l);
+    frame.direction = constrain(sample.direction, 0l, 65535l);
+    frame.speed_out = constrain(wind_context.speed_out, 0, 65535);
+    frame.dir_out = wind_context.dir_out;
+    frame.stages = sample.stages;
+    frame.flags = (wind_context.ignore_next ? kIgnoreNext : 0) | (stormGuard.in_storm() ? kStorm : 0)
+        | (analogVane ? kAnalogVaneFlag : 0) | (passed ? kPassed : 0);
+    debugStream.add(frame);
+}
+
+// Send the revolutions since the last call as one message, serialized once for all
+// clients. If a client can not keep up, the message is dropped rather than queued.
+void flushDebugStream()
+{
+    debugSocket->cleanupClients(DEBUG_STREAM_CLIENTS);
+    debugStreaming = debug_stream->get_value() && (debugSocket->count() > 0);
+    if (!debugStreaming)
+    {
+        debugStream.clear();
+        return;
+    }
+    if (debugStream.empty()) return;
+    if (!debugSocket->availableForWriteAll())
     {
-        speedOut = 0;
-        prevSpeed = 0;
+        debugStream.drop_pending();
+        return;
     }
 
-    speed_output->set_input((speedOut/100.0));
-    dir_output->set_input((dirOut*0.0174533));
+    AsyncWebSocketMessageBuffer* buffer = debugSocket->makeBuffer(debugStream.message_size());
+    if (buffer == nullptr) return;
+    debugStream.serialize(buffer->get());
+    debugSocket->binaryAll(buffer);
 }
 
+// Format the record once and queue it, debugTelemetry.pump() writes it out as the UART
+// takes it. A record that does not fit the queue is dropped, the main loop never waits.
 void printDebug()
 {
-//  Serial.printf("millis: %lu,", millis()); // -- breaks Arduino Serial Plotter output
-  Serial.printf("f_g: %f,", filter_gain->get_value());
-  Serial.printf("d_o: %i,", dir_offset->get_value());
-  Serial.printf("dir_raw: %i,", dirOut);
-  Serial.printf("dir_adj: %f,", (dirOut*0.0174533));
-  Serial.printf("spd_raw: %i,", speedOut);
-  Serial.printf("spd_adj: %f,", (speedOut/100.0));
-  Serial.printf("rps: %d\n", rps);
+  debugTelemetry.set_binary(debug_binary->get_value());
+  debugTelemetry.begin_record();
+//  debugTelemetry.add("millis", (int32_t)millis()); // -- breaks Arduino Serial Plotter output
+  debugTelemetry.add("f_g", filter_gain->get_value(), 3);
+  debugTelemetry.add("d_o", (int32_t)dir_config->get_offset());
+  debugTelemetry.add("dir_raw", (int32_t)wind_context.dir_out);
+  debugTelemetry.add("dir_adj", (float)(wind_context.dir_out*0.0174533), 4);
+  debugTelemetry.add("spd_raw", (int32_t)wind_context.speed_out);
+  debugTelemetry.add("spd_adj", (float)(wind_context.speed_out/100.0), 2);
+  debugTelemetry.add("gust_us", (int32_t)gustMicros);
+  debugTelemetry.add("bus_ovr_sk", (int32_t)skReader.get_overruns());
+  debugTelemetry.add("bus_ovr_rec", (int32_t)recordReader.get_overruns());
+  debugTelemetry.add("bus_ovr_gust", (int32_t)gustReader.get_overruns());
+  debugTelemetry.add("dbg_drop", (int32_t)debugTelemetry.get_dropped());
+  debugTelemetry.add("rps", (int32_t)wind_context.rps);
+  debugTelemetry.end_record();
 }
 
 void loop()
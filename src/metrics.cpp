@@ -0,0 +1,84 @@
+#include "metrics.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+void Histogram::observe(uint32_t value) {
+  uint8_t i = 0;
+  while ((i < buckets_) && (value > bounds_[i])) i++;
+  counts_[i]++;
+  total_++;
+  sum_ += value;
+}
+
+void MetricsWriter::append(const char* format, ...) {
+  if (overflow_) return;
+
+  va_list args;
+  va_start(args, format);
+  int written = vsnprintf(buffer_ + length_, size_ - length_, format, args);
+  va_end(args);
+
+  if ((written < 0) || ((size_t)written >= size_ - length_)) {
+    // Cut back to the last complete line
+    while ((length_ > 0) && (buffer_[length_ - 1] != '\n')) length_--;
+    buffer_[length_] = '\0';
+    overflow_ = true;
+    return;
+  }
+  length_ += written;
+}
+
+void MetricsWriter::family(const char* name, const char* type,
+                           const char* help) {
+  append("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void MetricsWriter::sample(const char* name, const char* labels,
+                           float value) {
+  if (labels != nullptr) {
+    append("%s{%s} %g\n", name, labels, value);
+  } else {
+    append("%s %g\n", name, value);
+  }
+}
+
+void MetricsWriter::sample(const char* name, const char* labels,
+                           uint32_t value) {
+  if (labels != nullptr) {
+    append("%s{%s} %u\n", name, labels, (unsigned)value);
+  } else {
+    append("%s %u\n", name, (unsigned)value);
+  }
+}
+
+void MetricsWriter::gauge(const char* name, const char* help, float value) {
+  family(name, "gauge", help);
+  sample(name, nullptr, value);
+}
+
+void MetricsWriter::gauge(const char* name, const char* help,
+                          uint32_t value) {
+  family(name, "gauge", help);
+  sample(name, nullptr, value);
+}
+
+void MetricsWriter::counter(const char* name, const char* help,
+                            uint32_t value) {
+  family(name, "counter", help);
+  sample(name, nullptr, value);
+}
+
+void MetricsWriter::histogram(const char* name, const char* help,
+                              const Histogram& histogram) {
+  family(name, "histogram", help);
+  uint32_t cumulative = 0;
+  for (uint8_t i = 0; i < histogram.get_buckets(); i++) {
+    cumulative += histogram.get_count(i);
+    append("%s_bucket{le=\"%u\"} %u\n", name,
+           (unsigned)histogram.get_bounds()[i], (unsigned)cumulative);
+  }
+  append("%s_bucket{le=\"+Inf\"} %u\n", name, (unsigned)histogram.get_total());
+  append("%s_sum %llu\n", name, (unsigned long long)histogram.get_sum());
+  append("%s_count %u\n", name, (unsigned)histogram.get_total());
+}
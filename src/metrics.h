@@ -0,0 +1,78 @@
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Distribution of a time or size in fixed buckets.
+ *
+ * Counts in the bucket of each observation only, the cumulative counts of
+ * the Prometheus format are formed when rendering.
+ */
+class Histogram {
+ public:
+  static const uint8_t kMaxBuckets = 8;
+
+  /**
+   * @param bounds Ascending upper bounds of the buckets, not copied
+   * @param buckets Number of bounds, at most kMaxBuckets
+   */
+  Histogram(const uint32_t* bounds, uint8_t buckets)
+      : bounds_(bounds), buckets_(buckets) {}
+
+  void observe(uint32_t value);
+
+  const uint32_t* get_bounds() const { return bounds_; }
+  uint8_t get_buckets() const { return buckets_; }
+  /// Observations in bucket i, the one above the last bound at buckets
+  uint32_t get_count(uint8_t i) const { return counts_[i]; }
+  uint32_t get_total() const { return total_; }
+  uint64_t get_sum() const { return sum_; }
+
+ protected:
+  const uint32_t* bounds_;
+  uint8_t buckets_;
+  uint32_t counts_[kMaxBuckets + 1] = {};
+  uint32_t total_ = 0;
+  uint64_t sum_ = 0;
+};
+
+/**
+ * @brief Renders metrics in the Prometheus text format into a fixed buffer.
+ *
+ * Nothing is allocated. If the buffer is too small, the output stops at the
+ * last complete line and overflow() is set.
+ */
+class MetricsWriter {
+ public:
+  MetricsWriter(char* buffer, size_t size) : buffer_(buffer), size_(size) {
+    buffer_[0] = '\0';
+  }
+
+  /// The HELP and TYPE lines of a metric with several labelled samples
+  void family(const char* name, const char* type, const char* help);
+  /// A sample of the family, labels like "stage=\"FilterSpeed\"" or nullptr
+  void sample(const char* name, const char* labels, float value);
+  void sample(const char* name, const char* labels, uint32_t value);
+
+  void gauge(const char* name, const char* help, float value);
+  void gauge(const char* name, const char* help, uint32_t value);
+  void counter(const char* name, const char* help, uint32_t value);
+  void histogram(const char* name, const char* help,
+                 const Histogram& histogram);
+
+  size_t length() { return length_; }
+  bool overflow() { return overflow_; }
+
+ protected:
+  void append(const char* format, ...)
+      __attribute__((format(printf, 2, 3)));
+
+  char* buffer_;
+  size_t size_;
+  size_t length_ = 0;
+  bool overflow_ = false;
+};
+
+#endif  // METRICS_H_
@@ -0,0 +1,101 @@
+#include "model_detector.h"
+
+void ModelDetector::start(uint32_t speed_total, uint32_t dir_total) {
+  speed_start_ = speed_total;
+  dir_start_ = dir_total;
+  samples_ = 0;
+  high_samples_ = 0;
+  transitions_ = 0;
+  vane_samples_ = 0;
+  vane_rail_samples_ = 0;
+  vane_jitter_ = 0;
+  vane_has_reading_ = false;
+  vane_at_rail_ = false;
+  vane_wraps_ = 0;
+  vane_dead_zone_passes_ = 0;
+}
+
+void ModelDetector::sample_vane(uint16_t raw) {
+  if (vane_samples_ > 0) {
+    vane_jitter_ += (raw > vane_last_) ? raw - vane_last_ : vane_last_ - raw;
+  }
+  vane_last_ = raw;
+  vane_samples_++;
+  if ((raw < kRailLow) || (raw > kRailHigh)) {
+    vane_rail_samples_++;
+    vane_at_rail_ = true;
+    return;
+  }
+
+  // A jump across the range passes north, through a dead zone if the
+  // readings in between were at a rail
+  if (vane_has_reading_) {
+    uint16_t change =
+        (raw > vane_reading_) ? raw - vane_reading_ : vane_reading_ - raw;
+    if (change >= kVaneWrap) {
+      if (vane_at_rail_) {
+        vane_dead_zone_passes_++;
+      } else {
+        vane_wraps_++;
+      }
+    }
+  }
+  vane_reading_ = raw;
+  vane_has_reading_ = true;
+  vane_at_rail_ = false;
+}
+
+PulsePattern ModelDetector::finish(uint32_t speed_total, uint32_t dir_total) {
+  PulsePattern pattern = {};
+  pattern.speed_pulses = speed_total - speed_start_;
+  pattern.dir_pulses = dir_total - dir_start_;
+  pattern.valid = (pattern.speed_pulses >= kMinPulses) && (samples_ > 0);
+  if (!pattern.valid) return pattern;
+
+  // A direction pulse comes at least every few speed pulses, anything much
+  // rarer is noise on an unused input
+  pattern.direction_pulse = pattern.dir_pulses * 8 >= pattern.speed_pulses;
+  pattern.pulses_per_revolution = 1;
+  if (pattern.direction_pulse) {
+    pattern.pulses_per_revolution =
+        (pattern.speed_pulses + pattern.dir_pulses / 2) / pattern.dir_pulses;
+  }
+  pattern.analog_vane = !pattern.direction_pulse &&
+                        (vane_samples_ >= kMinVaneSamples) &&
+                        (vane_rail_samples_ * 2 < vane_samples_) &&
+                        (vane_jitter_ < kMaxVaneJitter * (vane_samples_ - 1));
+  pattern.active_high = high_samples_ * 2 < samples_;
+
+  // Counted pulses against the pulses the samples saw, a quarter more is
+  // beyond the pulses cut at the ends of the window
+  uint32_t sampled_pulses = transitions_ / 2;
+  pattern.bounce_known = (sampled_pulses > 0) &&
+                         (sampled_pulses * kMinBounceSamples <= samples_);
+  pattern.bounce = pattern.bounce_known &&
+                   (pattern.speed_pulses * 4 >= sampled_pulses * 5);
+
+  pattern.dead_zone_known =
+      pattern.analog_vane && (vane_wraps_ + vane_dead_zone_passes_ > 0);
+  pattern.dead_zone =
+      pattern.dead_zone_known && (vane_dead_zone_passes_ > vane_wraps_);
+  return pattern;
+}
+
+bool ModelDetector::matches(const PulsePattern& pattern,
+                            const ModelSignature& signature) {
+  DirectionEncoding direction =
+      pattern.direction_pulse ? kPhasePulse : kAnalogVane;
+  if ((signature.direction != direction) ||
+      (signature.pulses_per_revolution != pattern.pulses_per_revolution)) {
+    return false;
+  }
+  if ((direction == kPhasePulse) && pattern.bounce_known &&
+      (signature.reed_switch != pattern.bounce)) {
+    return false;
+  }
+  if ((direction == kAnalogVane) && pattern.dead_zone_known &&
+      ((signature.vane_dead_zone > 0) != pattern.dead_zone)) {
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,157 @@
+#ifndef MODEL_DETECTOR_H_
+#define MODEL_DETECTOR_H_
+
+#include <stdint.h>
+
+#include "anemometer_model.h"
+
+/**
+ * @brief Pulse pattern of the connected anemometer.
+ */
+struct PulsePattern {
+  bool valid;                 ///< Enough pulses were seen to classify
+  bool direction_pulse;       ///< The direction input pulses with the rotor
+  bool analog_vane;           ///< The vane input reads like a connected vane
+  int pulses_per_revolution;  ///< Speed pulses per direction pulse
+  bool active_high;           ///< The speed input idles low
+  bool bounce_known;          ///< The pulses were slow enough to judge bounce
+  bool bounce;                ///< The speed input bounces like a reed switch
+  bool dead_zone_known;       ///< The vane was seen passing north
+  bool dead_zone;             ///< It passed north through a dead zone
+  uint32_t speed_pulses;
+  uint32_t dir_pulses;
+};
+
+/**
+ * @brief What the detector can tell apart of a model.
+ */
+struct ModelSignature {
+  int pulses_per_revolution;
+  DirectionEncoding direction;
+  bool reed_switch;    ///< The speed pulses come from a bouncing reed switch
+  int vane_dead_zone;  ///< Degrees, 0 if the vane has none
+};
+
+/**
+ * @brief Classifies the pulse pattern on the speed and direction inputs.
+ *
+ * Fed with the pulse counter totals at the start and end of an observation
+ * window, and with level samples of the speed input in between. The pulse
+ * ratio of the two inputs gives the pulses per revolution and whether the
+ * direction is a pulse at all (analog vanes leave the input idle); the
+ * level the speed input rests at most of the time is its idle level.
+ *
+ * A silent direction input may as well be a dead reed switch, so an analog
+ * vane is only reported on a positive signature of the vane input: raw ADC
+ * readings mostly off the rails (an open or shorted input) that change
+ * little from one reading to the next (a floating input jumps around).
+ *
+ * Models with the same pulses and direction encoding are told apart by two
+ * more signatures. A reed switch bounces: the pulse counter's glitch filter
+ * passes the bounces, while the level samples, 1 ms apart, mostly see one
+ * pulse, so the counter counts clearly more pulses than the samples show. A
+ * push-pull output counts the same in both, as long as its pulses are long
+ * against the sampling (about half the period). And a potentiometer vane
+ * passes north through a dead zone where the wiper is open and the input
+ * reads at a rail, while a hall vane jumps straight from one end of its range
+ * to the other. Each signature is only known if the window showed it, the
+ * bounce at pulse rates well below the sampling rate, the dead zone when the
+ * vane passed north.
+ *
+ * Without enough pulses, e.g. in a calm, the pattern is not valid and the
+ * caller should keep its current model.
+ */
+class ModelDetector {
+ public:
+  static const uint32_t kMinPulses = 8;
+  static const uint32_t kMinVaneSamples = 50;
+  static const uint16_t kRailLow = 8;     ///< Raw 12-bit readings
+  static const uint16_t kRailHigh = 4087;
+  /// Mean change between vane readings, a vane swinging at 90 deg/s changes
+  /// by about 11 per 10 ms
+  static const uint16_t kMaxVaneJitter = 64;
+  /// Change between two vane readings that is a pass through north
+  static const uint16_t kVaneWrap = 2048;
+  /// Level samples per pulse period needed to judge bounce
+  static const uint32_t kMinBounceSamples = 8;
+
+  /// The outcome of select()
+  struct Selection {
+    int index;           ///< The model to use, -1 to keep the current one
+    const char* result;  ///< What the detection found, for the status
+  };
+
+  void start(uint32_t speed_total, uint32_t dir_total);
+
+  /// Level sample of the speed input, true is high, every millisecond
+  void sample(bool speed_level) {
+    if ((samples_ > 0) && (speed_level != last_level_)) transitions_++;
+    last_level_ = speed_level;
+    samples_++;
+    if (speed_level) high_samples_++;
+  }
+
+  /// Raw 12-bit reading of the vane input, every 10 ms or so
+  void sample_vane(uint16_t raw);
+
+  PulsePattern finish(uint32_t speed_total, uint32_t dir_total);
+
+  /// The pattern could come from a model with this signature
+  static bool matches(const PulsePattern& pattern,
+                      const ModelSignature& signature);
+
+  /**
+   * @brief Pick the model of a pattern.
+   *
+   * Keeps the current model if it matches, else takes the only model that
+   * does. If several other models match, the pattern is ambiguous and the
+   * current model is kept.
+   *
+   * @param models Models with a member signature
+   * @param current Index of the current model
+   */
+  template <class Model>
+  static Selection select(const PulsePattern& pattern, const Model* models,
+                          int count, int current) {
+    if (!pattern.valid) return {-1, "too few pulses"};
+    // A silent direction input without a vane signal is a dead reed or an
+    // open cable
+    if (!pattern.direction_pulse && !pattern.analog_vane) {
+      return {-1, "no direction"};
+    }
+    if (matches(pattern, models[current].signature)) {
+      return {current, "confirmed"};
+    }
+
+    int match = -1;
+    int matched = 0;
+    for (int i = 0; i < count; i++) {
+      if (matches(pattern, models[i].signature)) {
+        match = i;
+        matched++;
+      }
+    }
+    if (matched == 0) return {-1, "no match"};
+    if (matched > 1) return {-1, "ambiguous"};
+    return {match, "selected"};
+  }
+
+ protected:
+  uint32_t speed_start_ = 0;
+  uint32_t dir_start_ = 0;
+  uint32_t samples_ = 0;
+  uint32_t high_samples_ = 0;
+  uint32_t transitions_ = 0;  // Level changes between the samples
+  bool last_level_ = false;
+  uint32_t vane_samples_ = 0;
+  uint32_t vane_rail_samples_ = 0;
+  uint32_t vane_jitter_ = 0;  // Sum of the changes between readings
+  uint16_t vane_last_ = 0;
+  uint16_t vane_reading_ = 0;  // Last reading off the rails
+  bool vane_has_reading_ = false;
+  bool vane_at_rail_ = false;  // At a rail since vane_reading_
+  uint32_t vane_wraps_ = 0;    // Passes through north without a dead zone
+  uint32_t vane_dead_zone_passes_ = 0;
+};
+
+#endif  // MODEL_DETECTOR_H_
@@ -0,0 +1,66 @@
+#include "overspeed.h"
+
+namespace {
+
+// Integer square root, rounded down, by the digit-by-digit method
+uint32_t isqrt(uint64_t value) {
+  uint64_t root = 0;
+  uint64_t bit = 1ull << 62;
+  while (bit > value) bit >>= 2;
+  while (bit != 0) {
+    if (value >= root + bit) {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)root;
+}
+
+}  // namespace
+
+int32_t OverspeedCompensator::compensate(int32_t cmps, uint32_t speed_pulse,
+                                         uint32_t speed_time) {
+  if (speed_pulse != last_pulse_) {
+    correction_ = 0;
+    if ((distance_constant_ > 0) && (last_cmps_ > 0) && (cmps > 0) &&
+        (speed_time > 0)) {
+      // The rotor acceleration in cm/s^2, and u solved from
+      // u^2 - u_r * u - L * du_r/dt = 0
+      int64_t accel = (int64_t)(cmps - last_cmps_) * 1000000ll / speed_time;
+      int64_t disc = (int64_t)cmps * cmps + 4 * distance_constant_ * accel;
+      if (disc < 0) disc = 0;
+      correction_ = (int32_t)((cmps + isqrt((uint64_t)disc)) / 2) - cmps;
+    }
+    last_pulse_ = speed_pulse;
+    last_cmps_ = cmps;
+  }
+
+  if (distance_constant_ <= 0) return cmps;
+
+  // The inverse filter amplifies noise, never let it more than double the
+  // reading (the root is at least half of it)
+  int32_t correction = correction_;
+  if (correction > cmps) correction = cmps;
+
+  return cmps + correction;
+}
+
+void DistanceConstantEstimator::add(int32_t reference_cmps, int32_t cmps,
+                                    int32_t last_cmps, uint32_t speed_time) {
+  if ((cmps <= 0) || (last_cmps <= 0) || (speed_time == 0)) return;
+
+  // du_r/dt in cm/s^2, against u * (u - u_r) in cm^2/s^2
+  double x = (double)(cmps - last_cmps) * 1e6 / speed_time;
+  double y = (double)reference_cmps * (reference_cmps - cmps);
+  sum_xy_ += x * y;
+  sum_xx_ += x * x;
+  count_++;
+}
+
+float DistanceConstantEstimator::get_distance_constant() const {
+  if (sum_xx_ <= 0.0) return 0.0f;
+  return sum_xy_ / sum_xx_;
+}
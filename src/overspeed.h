@@ -0,0 +1,81 @@
+#ifndef OVERSPEED_H_
+#define OVERSPEED_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Compensates the overspeeding of a cup rotor in gusty wind.
+ *
+ * Cup rotors spin up faster than they spin down (the response time is L/u,
+ * so it is shorter in a gust than in a lull), which makes the rotor
+ * overestimate the mean speed. The rotor model du_r/dt = (u / L) * (u - u_r)
+ * is solved for the wind u once per revolution, using the distance constant
+ * L and the change of rotor speed over the last revolution. The exact root is
+ * needed: replacing u by u_r in the response time gives a correction that is
+ * a derivative of log(u_r), whose time average, and so its effect on the
+ * mean speed, is zero.
+ *
+ * The derivative needs the true period of each revolution. A period averaged
+ * over several revolutions (the pulse counter) hides the speed changes, so
+ * those are passed with reset() and left uncompensated.
+ */
+class OverspeedCompensator {
+ public:
+  /// Distance constant in cm, 0 disables the compensation
+  void set_distance_constant(int32_t cm) { distance_constant_ = cm; }
+
+  /**
+   * @brief The speed of a revolution, compensated.
+   *
+   * Snapshots of the same revolution (same speed pulse) reuse its
+   * correction.
+   *
+   * @param cmps Rotor speed of the revolution, cm/s
+   * @param speed_pulse Time of the speed pulse ending it, us
+   * @param speed_time Period of the revolution, us
+   */
+  int32_t compensate(int32_t cmps, uint32_t speed_pulse, uint32_t speed_time);
+
+  /// Forget the last revolution, so the next one has no predecessor
+  void reset() {
+    last_cmps_ = 0;
+    correction_ = 0;
+  }
+
+ protected:
+  int32_t distance_constant_ = 0;
+  uint32_t last_pulse_ = 0;
+  int32_t last_cmps_ = 0;
+  int32_t correction_ = 0;
+};
+
+/**
+ * @brief Least squares estimate of the distance constant.
+ *
+ * Fed the rotor speeds of consecutive revolutions together with a reference
+ * speed over the second one (e.g. a sonic anemometer, or a wind tunnel step),
+ * it fits u * (u - u_r) = L * du_r/dt.
+ */
+class DistanceConstantEstimator {
+ public:
+  /**
+   * @param reference_cmps True wind speed over the revolution, cm/s
+   * @param cmps Rotor speed of the revolution, cm/s
+   * @param last_cmps Rotor speed of the revolution before, cm/s
+   * @param speed_time Period of the revolution, us
+   */
+  void add(int32_t reference_cmps, int32_t cmps, int32_t last_cmps,
+           uint32_t speed_time);
+
+  /// The estimate in cm, 0 before any revolution with a speed change
+  float get_distance_constant() const;
+
+  uint32_t get_count() const { return count_; }
+
+ protected:
+  double sum_xy_ = 0.0;
+  double sum_xx_ = 0.0;
+  uint32_t count_ = 0;
+};
+
+#endif  // OVERSPEED_H_
@@ -0,0 +1,64 @@
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+
+#include <stdint.h>
+
+#include "trace.h"
+
+/**
+ * @brief A revolution on its way through the stages of a Pipeline.
+ */
+struct WindSample {
+  unsigned long speed_pulse;     ///< micros() of the speed pulse
+  unsigned long speed_time;      ///< Revolution period in us, 0 when stalled
+  unsigned long direction_time;  ///< Direction pulse after the speed pulse, us
+  long rps;                      ///< Revolutions per 100 s
+  long cmps;                     ///< Speed in cm/s
+  uint16_t phase;                ///< Direction phase, 65536 per turn
+  long direction;                ///< Direction in degrees
+  uint8_t stages;                ///< Stages passed, the one at this index ended it
+};
+
+/**
+ * @brief Processing stages composed at compile time.
+ *
+ * Each stage is a type with a static `bool run(WindSample&)` and a kName
+ * for the trace. The stages run
+ * in the order given, and a stage returning false ends the pass, e.g. a
+ * rejected speed skips the direction stages. The recursion is inlined, so a
+ * pipeline compiles into a single function without indirect calls; adding,
+ * removing or reordering stages only changes the template arguments.
+ */
+template <class... Stages>
+struct Pipeline;
+
+template <>
+struct Pipeline<> {
+  static const uint8_t kStages = 0;
+  static inline bool run(WindSample&) { return true; }
+  static const char* stage_name(uint8_t) { return ""; }
+};
+
+template <class First, class... Rest>
+struct Pipeline<First, Rest...> {
+  static const uint8_t kStages = 1 + Pipeline<Rest...>::kStages;
+
+  static inline __attribute__((always_inline)) bool run(WindSample& sample) {
+    bool passed;
+    {
+      TRACE_SCOPE(First::kName);
+      passed = First::run(sample);
+    }
+    if (!passed) return false;
+    sample.stages++;
+    return Pipeline<Rest...>::run(sample);
+  }
+
+  /// Name of the stage at index, e.g. of WindSample::stages
+  static const char* stage_name(uint8_t index) {
+    if (index == 0) return First::kName;
+    return Pipeline<Rest...>::stage_name(index - 1);
+  }
+};
+
+#endif  // PIPELINE_H_
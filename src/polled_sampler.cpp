@@ -0,0 +1,56 @@
+#include "polled_sampler.h"
+
+#include "soc/gpio_reg.h"
+
+PolledSampler* PolledSampler::instance_ = nullptr;
+
+void PolledSampler::begin() {
+  instance_ = this;
+  start_us_ = micros();
+  // 80 MHz APB clock / 80 = 1 MHz timer tick
+  timer_ = timerBegin(timer_num_, 80, true);
+  // Level interrupt, arduino-esp32 2.x does not support edge timer interrupts
+  timerAttachInterrupt(timer_, &PolledSampler::on_timer, false);
+  timerAlarmWrite(timer_, period_us_, true);
+  timerAlarmEnable(timer_);
+}
+
+void IRAM_ATTR PolledSampler::on_timer() {
+  PolledSampler* self = instance_;
+  uint32_t in = REG_READ(GPIO_IN_REG);
+  uint32_t bit = 1ul << self->bit_;
+
+  if (in & self->speed_mask_) self->speed_acc_ |= bit;
+  if (in & self->dir_mask_) self->dir_acc_ |= bit;
+
+  if (++self->bit_ < 32) return;
+
+  uint32_t head = self->head_;
+  if (head - self->tail_ < kHistoryWords) {
+    uint32_t slot = head & (kHistoryWords - 1);
+    self->speed_history_[slot] = self->speed_acc_;
+    self->dir_history_[slot] = self->dir_acc_;
+    self->first_sample_history_[slot] = self->words_ * 32;
+    // Publish the slot only after it has been filled
+    self->head_ = head + 1;
+  } else {
+    self->overruns_++;
+  }
+  self->words_++;
+  self->speed_acc_ = 0;
+  self->dir_acc_ = 0;
+  self->bit_ = 0;
+}
+
+bool PolledSampler::read(uint32_t* speed_word, uint32_t* dir_word,
+                         uint32_t* first_sample) {
+  uint32_t tail = tail_;
+  if (tail == head_) return false;
+
+  uint32_t slot = tail & (kHistoryWords - 1);
+  *speed_word = speed_history_[slot];
+  *dir_word = dir_history_[slot];
+  *first_sample = first_sample_history_[slot];
+  tail_ = tail + 1;
+  return true;
+}
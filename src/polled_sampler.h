@@ -0,0 +1,81 @@
+#ifndef POLLED_SAMPLER_H_
+#define POLLED_SAMPLER_H_
+
+#include "Arduino.h"
+
+/**
+ * @brief Samples the speed and direction inputs at a fixed rate from a
+ * hardware timer.
+ *
+ * Each timer interrupt reads both inputs with a single GPIO register read
+ * and packs them into 32-bit words, one bit per sample. Completed words go
+ * into a circular history that is drained from the main loop, e.g. by an
+ * EdgeDecoder. The CPU load only depends on the sampling rate, not on the
+ * edge rate of the inputs.
+ *
+ * Only one instance can exist, as the timer ISR is static.
+ */
+class PolledSampler {
+ public:
+  /**
+   * @param speed_pin GPIO of the speed input (0 to 31)
+   * @param dir_pin GPIO of the direction input (0 to 31)
+   * @param period_us Sampling period in microseconds
+   * @param timer_num Hardware timer to use
+   */
+  PolledSampler(uint8_t speed_pin, uint8_t dir_pin, uint32_t period_us,
+                uint8_t timer_num = 0)
+      : speed_mask_(1ul << speed_pin),
+        dir_mask_(1ul << dir_pin),
+        period_us_(period_us),
+        timer_num_(timer_num) {}
+
+  void begin();
+
+  /**
+   * @brief Fetch the oldest word of samples from the history.
+   *
+   * @param speed_word Samples of the speed input, bit 0 is the earliest
+   * @param dir_word Samples of the direction input
+   * @param first_sample Sample index of bit 0
+   * @return false if no complete word is available
+   */
+  bool read(uint32_t* speed_word, uint32_t* dir_word, uint32_t* first_sample);
+
+  /// Convert a sample index into micros() time
+  unsigned long sample_time(uint32_t sample) {
+    return start_us_ + sample * period_us_;
+  }
+
+  /// Number of words dropped because the history was full
+  uint32_t get_overruns() { return overruns_; }
+
+ protected:
+  static void IRAM_ATTR on_timer();
+  static PolledSampler* instance_;
+
+  // Must be a power of two. 64 words is 204.8 ms of history at 10 kHz.
+  static const uint32_t kHistoryWords = 64;
+
+  uint32_t speed_mask_;
+  uint32_t dir_mask_;
+  uint32_t period_us_;
+  uint8_t timer_num_;
+  hw_timer_t* timer_ = nullptr;
+  unsigned long start_us_ = 0;
+
+  // Written by the timer ISR only
+  uint32_t speed_acc_ = 0;
+  uint32_t dir_acc_ = 0;
+  uint8_t bit_ = 0;
+  uint32_t words_ = 0;  // Words completed, including dropped ones
+  volatile uint32_t overruns_ = 0;
+
+  uint32_t speed_history_[kHistoryWords];
+  uint32_t dir_history_[kHistoryWords];
+  uint32_t first_sample_history_[kHistoryWords];
+  volatile uint32_t head_ = 0;  // Written by the timer ISR
+  volatile uint32_t tail_ = 0;  // Written by read()
+};
+
+#endif  // POLLED_SAMPLER_H_
@@ -0,0 +1,91 @@
+#include "pulse_counter.h"
+
+bool PulseCounter::isr_service_installed_ = false;
+
+// Count the leading edges only
+static pcnt_count_mode_t rising_mode(bool active_high) {
+  return active_high ? PCNT_COUNT_INC : PCNT_COUNT_DIS;
+}
+
+static pcnt_count_mode_t falling_mode(bool active_high) {
+  return active_high ? PCNT_COUNT_DIS : PCNT_COUNT_INC;
+}
+
+void PulseCounter::begin(int16_t wrap) {
+  wrap_ = wrap;
+
+  pcnt_config_t config = {};
+  config.pulse_gpio_num = pin_;
+  config.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+  config.channel = PCNT_CHANNEL_0;
+  config.unit = unit_;
+  config.pos_mode = rising_mode(active_high_);
+  config.neg_mode = falling_mode(active_high_);
+  config.lctrl_mode = PCNT_MODE_KEEP;
+  config.hctrl_mode = PCNT_MODE_KEEP;
+  config.counter_h_lim = wrap_;
+  config.counter_l_lim = INT16_MIN;
+  pcnt_unit_config(&config);
+
+  if (filter_cycles_ > 0) {
+    pcnt_set_filter_value(unit_, filter_cycles_);
+    pcnt_filter_enable(unit_);
+  }
+
+  pcnt_counter_pause(unit_);
+  pcnt_counter_clear(unit_);
+
+  if (!isr_service_installed_) {
+    pcnt_isr_service_install(0);
+    isr_service_installed_ = true;
+  }
+  pcnt_isr_handler_add(unit_, &PulseCounter::on_event, this);
+  pcnt_event_enable(unit_, PCNT_EVT_H_LIM);
+
+  pcnt_counter_resume(unit_);
+  started_ = true;
+}
+
+void PulseCounter::set_active_high(bool active_high) {
+  active_high_ = active_high;
+  if (!started_) return;
+  pcnt_set_mode(unit_, PCNT_CHANNEL_0, rising_mode(active_high_),
+                falling_mode(active_high_), PCNT_MODE_KEEP, PCNT_MODE_KEEP);
+}
+
+void PulseCounter::enable_threshold(int16_t value) {
+  pcnt_set_event_value(unit_, PCNT_EVT_THRES_0, value);
+  pcnt_event_enable(unit_, PCNT_EVT_THRES_0);
+}
+
+void IRAM_ATTR PulseCounter::on_event(void* arg) {
+  PulseCounter* self = (PulseCounter*)arg;
+  uint32_t status = 0;
+  pcnt_get_event_status(self->unit_, &status);
+  if (status & PCNT_EVT_H_LIM) {
+    self->wraps_++;
+  }
+  if (self->handler_ != nullptr) {
+    self->handler_(status);
+  }
+}
+
+uint32_t PulseCounter::get_total() {
+  uint32_t wraps;
+  int16_t count = 0;
+  do {
+    wraps = wraps_;
+    pcnt_get_counter_value(unit_, &count);
+  } while (wraps != wraps_);
+  return wraps * wrap_ + count;
+}
+
+uint32_t PulseCounter::read_delta() {
+  uint32_t total = get_total();
+  // Right after a restart of the hardware counter, but before the interrupt
+  // has counted the wrap, the total briefly goes backwards
+  if ((int32_t)(total - last_total_) < 0) return 0;
+  uint32_t delta = total - last_total_;
+  last_total_ = total;
+  return delta;
+}
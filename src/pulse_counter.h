@@ -0,0 +1,83 @@
+#ifndef PULSE_COUNTER_H_
+#define PULSE_COUNTER_H_
+
+#include "Arduino.h"
+#include "driver/pcnt.h"
+
+/**
+ * @brief Counts the leading edges of the pulses on a GPIO with one of the
+ * ESP32 pulse counter (PCNT) units.
+ *
+ * The counting is done entirely in hardware, so it costs no CPU time per
+ * edge. Pulses shorter than the glitch filter are ignored. The 16 bit
+ * hardware counter restarts from 0 every `wrap` edges; the wraps are
+ * counted in the PCNT interrupt to extend the count to 32 bits.
+ */
+class PulseCounter {
+ public:
+  /**
+   * @param pin GPIO to count the pulses on
+   * @param unit PCNT unit to use, each instance needs its own
+   * @param filter_cycles Glitch filter length in APB clock cycles
+   *   (80 MHz, max. 1023 = 12.8 us), 0 disables the filter
+   * @param active_high Count rising edges (pulses are high) instead of
+   *   falling edges
+   */
+  PulseCounter(uint8_t pin, pcnt_unit_t unit, uint16_t filter_cycles = 1023,
+               bool active_high = false)
+      : pin_(pin),
+        unit_(unit),
+        filter_cycles_(filter_cycles),
+        active_high_(active_high) {}
+
+  /**
+   * @param wrap Number of edges after which the hardware counter restarts
+   *   and the event handler is called. Small values cost one interrupt
+   *   every `wrap` edges.
+   */
+  void begin(int16_t wrap = INT16_MAX);
+
+  /**
+   * @brief Additionally call the event handler when the counter reaches
+   * value (after a restart). Call after begin().
+   */
+  void enable_threshold(int16_t value);
+
+  /**
+   * @brief Count rising instead of falling edges. Can be changed while
+   * counting, the total is kept.
+   */
+  void set_active_high(bool active_high);
+
+  /**
+   * @brief Set a function to call from the PCNT interrupt, with the
+   * pcnt_evt_type_t status bits of the event. Must be in IRAM.
+   */
+  void set_event_handler(void (*handler)(uint32_t status)) {
+    handler_ = handler;
+  }
+
+  /// Total number of edges counted since begin()
+  uint32_t get_total();
+
+  /// Number of edges since the last call
+  uint32_t read_delta();
+
+  pcnt_unit_t get_unit() { return unit_; }
+
+ protected:
+  static void IRAM_ATTR on_event(void* arg);
+  static bool isr_service_installed_;
+
+  uint8_t pin_;
+  pcnt_unit_t unit_;
+  uint16_t filter_cycles_;
+  bool active_high_;
+  bool started_ = false;
+  int16_t wrap_ = INT16_MAX;
+  volatile uint32_t wraps_ = 0;
+  uint32_t last_total_ = 0;
+  void (*handler_)(uint32_t status) = nullptr;
+};
+
+#endif  // PULSE_COUNTER_H_
@@ -0,0 +1,139 @@
+#include "resampler.h"
+
+#include <math.h>
+
+static const float kDegToRad = 0.0174533;
+
+// First half of the symmetric low-pass, a Hamming windowed sinc cut off at a
+// quarter of the output rate, at 8 sub-intervals per output interval. The
+// taps sum to 1.
+static const float kLowPass[] = {
+    -0.00110455f, -0.00116622f, -0.00128848f, -0.00143226f,
+    -0.00152966f, -0.00148699f, -0.00119093f, -0.00051738f,
+    0.00065755f, 0.00244550f, 0.00493360f, 0.00817329f,
+    0.01217112f, 0.01688269f, 0.02221018f, 0.02800411f,
+    0.03406927f, 0.04017456f, 0.04606614f, 0.05148292f,
+    0.05617323f, 0.05991143f, 0.06251311f, 0.06384776f,
+};
+
+void Resampler::set_rate(uint8_t rate) {
+  if (rate < 1) {
+    rate = 1;
+  } else if (rate > 10) {
+    rate = 10;
+  }
+  period_ = 1000000 / (rate * kDecimation);
+  started_ = false;
+}
+
+void Resampler::add(uint32_t time, float speed, float direction) {
+  float x = cosf(direction * kDegToRad);
+  float y = sinf(direction * kDegToRad);
+
+  if (!started_) {
+    started_ = true;
+    interval_start_ = time;
+    speed_sum_ = x_sum_ = y_sum_ = 0;
+    head_ = filled_ = phase_ = 0;
+  } else if ((int32_t)(time - last_time_) < 0) {
+    return;
+  } else if (time != last_time_) {
+    integrate(last_time_, time, last_speed_, speed, last_x_, x, last_y_, y);
+  }
+
+  last_time_ = time;
+  last_speed_ = speed;
+  last_direction_ = direction;
+  last_x_ = x;
+  last_y_ = y;
+}
+
+void Resampler::advance(uint32_t now, uint32_t timeout) {
+  if (!started_) return;
+  // now may precede the last revolution, if it ended while being added
+  while ((int32_t)(now - last_time_) > (int32_t)timeout) {
+    add(last_time_ + timeout, 0, last_direction_);
+  }
+}
+
+// Integrate the straight line from (from, *0) to (to, *1), splitting it at
+// the sub-interval boundaries. The mean of a line over a piece is its value in
+// the middle of the piece.
+void Resampler::integrate(uint32_t from, uint32_t to, float speed0,
+                          float speed1, float x0, float x1, float y0,
+                          float y1) {
+  float span = (float)(to - from);
+  uint32_t t = from;
+
+  while (t != to) {
+    uint32_t interval_end = interval_start_ + period_;
+    uint32_t piece_end =
+        ((int32_t)(interval_end - to) < 0) ? interval_end : to;
+    float dt = (float)(piece_end - t);
+    float mid = ((float)(t - from) + 0.5f * dt) / span;
+
+    speed_sum_ += (speed0 + (speed1 - speed0) * mid) * dt;
+    x_sum_ += (x0 + (x1 - x0) * mid) * dt;
+    y_sum_ += (y0 + (y1 - y0) * mid) * dt;
+
+    t = piece_end;
+    if (t == interval_end) {
+      filter();
+      interval_start_ = interval_end;
+    }
+  }
+}
+
+// Add the mean of the sub-interval to the filter, and emit every
+// kDecimation-th
+void Resampler::filter() {
+  float speed = speed_sum_ / period_;
+  float x = x_sum_ / period_;
+  float y = y_sum_ / period_;
+  speed_sum_ = x_sum_ = y_sum_ = 0;
+
+  if (filled_ == 0) {
+    for (int i = 0; i < kTaps; i++) {
+      speed_history_[i] = speed;
+      x_history_[i] = x;
+      y_history_[i] = y;
+    }
+    filled_ = kTaps;
+  }
+  speed_history_[head_] = speed;
+  x_history_[head_] = x;
+  y_history_[head_] = y;
+  head_ = (head_ + 1) % kTaps;
+
+  if (++phase_ < kDecimation) return;
+  phase_ = 0;
+  emit();
+}
+
+void Resampler::emit() {
+  float speed = 0;
+  float x = 0;
+  float y = 0;
+  int index = head_;  // The oldest
+  for (int i = 0; i < kTaps; i++) {
+    float tap = kLowPass[(i < kTaps / 2) ? i : kTaps - 1 - i];
+    speed += tap * speed_history_[index];
+    x += tap * x_history_[index];
+    y += tap * y_history_[index];
+    index = (index + 1) % kTaps;
+  }
+
+  ResampledWind sample;
+  sample.time = interval_start_ + period_;
+  // The negative side lobes can undershoot a calm
+  sample.speed = (speed > 0) ? speed : 0;
+  // A zero vector (exactly opposite directions) keeps the last direction
+  if ((x == 0) && (y == 0)) {
+    sample.direction = last_direction_;
+  } else {
+    sample.direction = atan2f(y, x) / kDegToRad;
+    if (sample.direction < 0) sample.direction += 360;
+  }
+
+  if (output_) output_(sample);
+}
@@ -0,0 +1,106 @@
+#ifndef RESAMPLER_H_
+#define RESAMPLER_H_
+
+#include <stdint.h>
+
+#include <functional>
+
+/**
+ * @brief One sample of the uniform-rate wind series.
+ */
+struct ResampledWind {
+  uint32_t time;    // End of the last sub-interval filtered in, micros() time
+  float speed;      // cm/s
+  float direction;  // degrees, 0 to 360
+};
+
+/**
+ * @brief Resamples the irregular per-revolution wind samples to a fixed
+ * rate.
+ *
+ * The samples are connected by straight lines, direction as a unit vector,
+ * so that a slow rotor spanning several output intervals is interpolated
+ * and the vane does not take the long way round at 0/360 degrees. That
+ * signal is averaged exactly over kDecimation sub-intervals per output
+ * interval (integrate and dump), and the sub-interval means are low-passed
+ * by a windowed-sinc FIR filter before every kDecimation-th is kept. The
+ * boxcar of the averaging alone passes half the output rate at -4 dB and
+ * lets the rest alias through sidelobes of -13 dB and below; with the FIR,
+ * everything from half the output rate up is down by 35 dB or more, while
+ * a tenth of the output rate passes at -0.8 dB and a quarter at -6 dB. The
+ * filter delays the series by about 3 output intervals, on top of the up to
+ * one revolution until the interval ends. Until the filter has filled, it
+ * holds the first sub-interval mean as the history.
+ *
+ * Memory use is constant.
+ */
+class Resampler {
+ public:
+  /**
+   * @param rate Output rate in Hz, 1 to 10
+   */
+  explicit Resampler(uint8_t rate = 1) { set_rate(rate); }
+
+  /// Change the output rate and restart the series
+  void set_rate(uint8_t rate);
+
+  /// Set the function to call with each output sample
+  void set_output(std::function<void(const ResampledWind&)> output) {
+    output_ = output;
+  }
+
+  /**
+   * @brief Add the sample of a revolution.
+   *
+   * A sample older than the last one is dropped, the series never goes back.
+   *
+   * @param time micros() time at the end of the revolution
+   * @param speed Speed in cm/s
+   * @param direction Direction in degrees
+   */
+  void add(uint32_t time, float speed, float direction);
+
+  /**
+   * @brief Let the series continue through calm periods.
+   *
+   * Adds a zero speed sample (holding the direction) for every timeout
+   * without a revolution, so the output keeps coming. Call regularly, and
+   * only after adding every revolution that ended before now, as a later
+   * revolution older than the zero samples would be dropped.
+   */
+  void advance(uint32_t now, uint32_t timeout);
+
+ protected:
+  static const int kDecimation = 8;  ///< Sub-intervals per output interval
+  static const int kTaps = 48;
+
+  void integrate(uint32_t from, uint32_t to, float speed0, float speed1,
+                 float x0, float x1, float y0, float y1);
+  void filter();
+  void emit();
+
+  uint32_t period_ = 1000000 / kDecimation;  // of a sub-interval
+  std::function<void(const ResampledWind&)> output_;
+
+  bool started_ = false;
+  uint32_t last_time_ = 0;
+  float last_speed_ = 0;
+  float last_direction_ = 0;
+  float last_x_ = 1;
+  float last_y_ = 0;
+
+  uint32_t interval_start_ = 0;
+  float speed_sum_ = 0;  // cm/s * us
+  float x_sum_ = 0;
+  float y_sum_ = 0;
+
+  // The sub-interval means, newest at head_ - 1
+  float speed_history_[kTaps];
+  float x_history_[kTaps];
+  float y_history_[kTaps];
+  int head_ = 0;
+  int filled_ = 0;
+  int phase_ = 0;  // Sub-intervals since the last output
+};
+
+#endif  // RESAMPLER_H_
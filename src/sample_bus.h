@@ -0,0 +1,76 @@
+#ifndef SAMPLE_BUS_H_
+#define SAMPLE_BUS_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Lock-free single-writer multi-reader ring of records.
+ *
+ * The writer publishes each record once. Every reader has its own cursor
+ * and reads the records in place, at its own pace, without locks or copies.
+ * The writer never waits for a reader. A reader that falls more than N
+ * records behind skips to the oldest record still in the ring, and the
+ * skipped records are counted as its overruns.
+ *
+ * A record returned by read() stays valid until the writer wraps around to
+ * its slot. Readers in the writer's task can use it directly; a reader in
+ * another task must copy it and then check still_valid().
+ *
+ * @tparam T Record type
+ * @tparam N Capacity, must be a power of two
+ */
+template <typename T, uint32_t N>
+class SampleBus {
+  static_assert((N & (N - 1)) == 0, "N must be a power of two");
+
+ public:
+  class Reader {
+   public:
+    /// Records this reader missed because it fell behind
+    uint32_t get_overruns() { return overruns_; }
+
+   protected:
+    friend class SampleBus;
+    uint32_t cursor_ = 0;
+    uint32_t overruns_ = 0;
+  };
+
+  void publish(const T& record) {
+    uint32_t head = head_;
+    records_[head & (N - 1)] = record;
+    // Publish the record only after it has been written
+    __sync_synchronize();
+    head_ = head + 1;
+  }
+
+  /// Start reading with the next record published
+  void subscribe(Reader* reader) {
+    reader->cursor_ = head_;
+    reader->overruns_ = 0;
+  }
+
+  /// The reader's next record, nullptr if it has read all
+  const T* read(Reader* reader) {
+    uint32_t head = head_;
+    if (reader->cursor_ == head) return nullptr;
+    if (head - reader->cursor_ > N - 1) {
+      reader->overruns_ += head - reader->cursor_ - (N - 1);
+      reader->cursor_ = head - (N - 1);
+    }
+    return &records_[reader->cursor_++ & (N - 1)];
+  }
+
+  /// The record last returned by read() has not been overwritten since
+  bool still_valid(const Reader& reader) {
+    return head_ - (reader.cursor_ - 1) < N;
+  }
+
+  /// Records published since boot
+  uint32_t get_published() { return head_; }
+
+ protected:
+  T records_[N];
+  volatile uint32_t head_ = 0;
+};
+
+#endif  // SAMPLE_BUS_H_
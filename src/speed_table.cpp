@@ -0,0 +1,62 @@
+#include "speed_table.h"
+
+#include <math.h>
+
+const int32_t SpeedTable::kRates[kPoints] = {50,  100,  200,  400,
+                                             800, 1600, 3200, 6400};
+
+void SpeedTable::clear() {
+  for (int i = 0; i < kPoints; i++) {
+    scale_[i] = 1024;
+  }
+}
+
+void SpeedCalibrator::start() {
+  for (int i = 0; i < SpeedTable::kPoints; i++) {
+    ref_meas_[i] = 0;
+    meas_sq_[i] = 0;
+    pairs_[i] = 0;
+  }
+  total_pairs_ = 0;
+}
+
+void SpeedCalibrator::add(float measured, float reference, long rps) {
+  if ((measured <= 0) || (rps <= 0)) return;
+
+  // Nearest point on the octave scale
+  int nearest = 0;
+  float best = 1e9;
+  for (int i = 0; i < SpeedTable::kPoints; i++) {
+    float distance = fabsf(log2f((float)rps / SpeedTable::kRates[i]));
+    if (distance < best) {
+      best = distance;
+      nearest = i;
+    }
+  }
+
+  ref_meas_[nearest] += reference * measured;
+  meas_sq_[nearest] += measured * measured;
+  pairs_[nearest]++;
+  total_pairs_++;
+}
+
+bool SpeedCalibrator::fit(SpeedTable* table) {
+  if (total_pairs_ < kMinPairs) return false;
+
+  float all_ref_meas = 0;
+  float all_meas_sq = 0;
+  for (int i = 0; i < SpeedTable::kPoints; i++) {
+    all_ref_meas += ref_meas_[i];
+    all_meas_sq += meas_sq_[i];
+  }
+  float overall = all_ref_meas / all_meas_sq;
+
+  for (int i = 0; i < SpeedTable::kPoints; i++) {
+    float ratio = (pairs_[i] >= kMinPairs) ? ref_meas_[i] / meas_sq_[i] : overall;
+    float scale = table->get(i) * ratio;
+    if (scale < 1) scale = 1;
+    if (scale > 65535) scale = 65535;
+    table->set(i, (uint16_t)(scale + 0.5f));
+  }
+  return true;
+}
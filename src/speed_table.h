@@ -0,0 +1,91 @@
+#ifndef SPEED_TABLE_H_
+#define SPEED_TABLE_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Per-sensor speed calibration table.
+ *
+ * Individual rotors deviate by a few percent from the factory calibration
+ * curve. The table holds a scale factor (1024 = 1.0) at kPoints rotor
+ * rates, spaced by octaves, and interpolates linearly between them. Below
+ * the first and above the last point the scale is held.
+ */
+class SpeedTable {
+ public:
+  static const int kPoints = 8;
+
+  /// Rotor rates of the points, in revolutions per 100 s
+  static const int32_t kRates[kPoints];
+
+  SpeedTable() { clear(); }
+
+  /// Reset all scales to 1.0
+  void clear();
+
+  /// Scale at a point, 1024 = 1.0
+  uint16_t get(int i) { return scale_[i]; }
+  void set(int i, uint16_t scale) { scale_[i] = scale; }
+
+  /**
+   * @param cmps Speed from the factory curve, cm/s
+   * @param rps Rotor rate, revolutions per 100 s
+   * @return Calibrated speed, cm/s
+   */
+  long correct(long cmps, long rps) {
+    int32_t scale;
+    if (rps <= kRates[0]) {
+      scale = scale_[0];
+    } else if (rps >= kRates[kPoints - 1]) {
+      scale = scale_[kPoints - 1];
+    } else {
+      int i = 0;
+      while (rps >= kRates[i + 1]) i++;
+      scale = scale_[i] + ((int32_t)(scale_[i + 1] - scale_[i]) *
+                           (rps - kRates[i])) / (kRates[i + 1] - kRates[i]);
+    }
+    return (cmps * scale) >> 10;
+  }
+
+ protected:
+  uint16_t scale_[kPoints];
+};
+
+/**
+ * @brief Accumulates (rotor rate, reference speed) pairs and fits a
+ * SpeedTable.
+ *
+ * Each pair goes to the nearest point, which keeps the least squares
+ * scale sums ref * meas and meas^2 (O(1) per pair, fixed memory). Points
+ * with too few pairs get the scale fitted over all pairs.
+ */
+class SpeedCalibrator {
+ public:
+  static const uint32_t kMinPairs = 50;
+
+  void start();
+
+  /**
+   * @param measured Speed with the current calibration applied
+   * @param reference Reference speed, same unit as measured
+   * @param rps Rotor rate, revolutions per 100 s
+   */
+  void add(float measured, float reference, long rps);
+
+  uint32_t get_pairs() { return total_pairs_; }
+
+  /**
+   * @brief Refine table by the fitted scales.
+   *
+   * @return false if there are fewer than kMinPairs pairs
+   */
+  bool fit(SpeedTable* table);
+
+ protected:
+  float ref_meas_[SpeedTable::kPoints];
+  float meas_sq_[SpeedTable::kPoints];
+  uint32_t pairs_[SpeedTable::kPoints];
+  uint32_t total_pairs_ = 0;
+};
+
+#endif  // SPEED_TABLE_H_
@@ -0,0 +1,51 @@
+#ifndef SPSC_QUEUE_H_
+#define SPSC_QUEUE_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Lock-free single-producer single-consumer queue.
+ *
+ * Meant to hand items from an ISR to the main loop: push() may only be
+ * called from one context and pop() from one other context. When the
+ * queue is full, new items are dropped and counted.
+ *
+ * @tparam T Item type, copied by value
+ * @tparam N Capacity, must be a power of two
+ */
+template <typename T, uint32_t N>
+class SpscQueue {
+  static_assert((N & (N - 1)) == 0, "N must be a power of two");
+
+ public:
+  bool push(const T& item) {
+    uint32_t head = head_;
+    if (head - tail_ >= N) {
+      dropped_++;
+      return false;
+    }
+    items_[head & (N - 1)] = item;
+    // Publish the item only after it has been written
+    head_ = head + 1;
+    return true;
+  }
+
+  bool pop(T* item) {
+    uint32_t tail = tail_;
+    if (tail == head_) return false;
+    *item = items_[tail & (N - 1)];
+    tail_ = tail + 1;
+    return true;
+  }
+
+  /// Number of items dropped because the queue was full
+  uint32_t get_dropped() { return dropped_; }
+
+ protected:
+  T items_[N];
+  volatile uint32_t head_ = 0;
+  volatile uint32_t tail_ = 0;
+  volatile uint32_t dropped_ = 0;
+};
+
+#endif  // SPSC_QUEUE_H_
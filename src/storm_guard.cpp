@@ -0,0 +1,26 @@
+#include "storm_guard.h"
+
+bool StormGuard::update(uint32_t edges, uint32_t window_ms) {
+  // Compare edges * 1000 against rate * window to stay in integers
+  uint64_t scaled = (uint64_t)edges * 1000;
+
+  if (!in_storm_) {
+    if (scaled > (uint64_t)storm_rate_ * window_ms) {
+      in_storm_ = true;
+      sane_windows_ = 0;
+      storm_count_++;
+      return true;
+    }
+    return false;
+  }
+
+  if (scaled <= (uint64_t)sane_rate_ * window_ms) {
+    if (++sane_windows_ >= rearm_windows_) {
+      in_storm_ = false;
+      return true;
+    }
+  } else {
+    sane_windows_ = 0;
+  }
+  return false;
+}
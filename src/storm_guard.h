@@ -0,0 +1,55 @@
+#ifndef STORM_GUARD_H_
+#define STORM_GUARD_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Detects interrupt storms on the reed inputs.
+ *
+ * A chafed or wet masthead cable can make an input oscillate at kHz rates.
+ * StormGuard is fed the number of edges seen in each sampling window and
+ * reports a storm as soon as the edge rate exceeds storm_rate. The storm
+ * is only considered over once the rate has stayed at or below sane_rate
+ * for rearm_windows consecutive windows.
+ */
+class StormGuard {
+ public:
+  /**
+   * @param storm_rate Edge rate (edges/s) above which a storm is declared
+   * @param sane_rate Edge rate (edges/s) considered plausible again
+   * @param rearm_windows Number of consecutive sane windows before the
+   *   storm is over
+   */
+  StormGuard(uint32_t storm_rate, uint32_t sane_rate, uint16_t rearm_windows)
+      : storm_rate_(storm_rate),
+        sane_rate_(sane_rate),
+        rearm_windows_(rearm_windows) {}
+
+  /**
+   * @brief Feed the edge count of one sampling window.
+   *
+   * @return true if the storm state changed
+   */
+  bool update(uint32_t edges, uint32_t window_ms);
+
+  /// Change the rates, e.g. for another sensor, keeping the storm state
+  void set_rates(uint32_t storm_rate, uint32_t sane_rate) {
+    storm_rate_ = storm_rate;
+    sane_rate_ = sane_rate;
+  }
+
+  bool in_storm() { return in_storm_; }
+
+  /// Number of storms detected since boot
+  uint32_t get_storm_count() { return storm_count_; }
+
+ protected:
+  uint32_t storm_rate_;
+  uint32_t sane_rate_;
+  uint16_t rearm_windows_;
+  uint16_t sane_windows_ = 0;
+  bool in_storm_ = false;
+  uint32_t storm_count_ = 0;
+};
+
+#endif  // STORM_GUARD_H_
@@ -0,0 +1,119 @@
+#include "trace.h"
+
+#ifdef TRACE_ENABLED
+
+#include <stdio.h>
+#include <string.h>
+
+TraceEvent Tracer::events_[Tracer::kEvents];
+volatile uint32_t Tracer::head_ = 0;
+volatile bool Tracer::paused_ = false;
+bool Tracer::dumping_ = false;
+uint32_t Tracer::next_ = 0;
+uint32_t Tracer::end_ = 0;
+uint8_t Tracer::part_ = 0;
+uint64_t Tracer::elapsed_[2];
+uint32_t Tracer::last_cycles_[2];
+bool Tracer::first_[2];
+
+namespace {
+
+enum DumpPart { kDumpHeader, kDumpEvents, kDumpFooter, kDumpDone };
+
+// The rendered piece that did not fit the caller's buffer yet
+char line[192];
+size_t line_length = 0;
+size_t line_position = 0;
+bool first_event = true;
+
+}  // namespace
+
+bool Tracer::start_dump() {
+  if (dumping_) return false;
+  dumping_ = true;
+  paused_ = true;
+  // Let an event being recorded on the other core complete
+  delayMicroseconds(10);
+
+  end_ = head_;
+  next_ = (end_ > kEvents) ? end_ - kEvents : 0;
+  part_ = kDumpHeader;
+  for (int core = 0; core < 2; core++) {
+    elapsed_[core] = 0;
+    first_[core] = true;
+  }
+  line_length = 0;
+  line_position = 0;
+  first_event = true;
+  return true;
+}
+
+size_t Tracer::read_dump(uint8_t* buffer, size_t max_len) {
+  size_t written = 0;
+  uint32_t mhz = getCpuFrequencyMhz();
+
+  while (written < max_len) {
+    if (line_position == line_length) {
+      // Render the next piece
+      line_position = 0;
+      line_length = 0;
+      if (part_ == kDumpHeader) {
+        line_length = snprintf(line, sizeof(line),
+                               "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+        part_ = kDumpEvents;
+      } else if (part_ == kDumpEvents) {
+        if (next_ == end_) {
+          part_ = kDumpFooter;
+          continue;
+        }
+        const TraceEvent& event = events_[next_ & (kEvents - 1)];
+        uint8_t core = event.core & 1;
+        if (first_[core]) {
+          first_[core] = false;
+        } else {
+          elapsed_[core] += (uint32_t)(event.cycles - last_cycles_[core]);
+        }
+        last_cycles_[core] = event.cycles;
+        uint64_t ns = elapsed_[core] * 1000 / mhz;
+
+        line_length = snprintf(
+            line, sizeof(line),
+            "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lu.%03u,\"pid\":1,"
+            "\"tid\":%u",
+            first_event ? "" : ",",
+            event.name, event.phase, (unsigned long)(ns / 1000),
+            (unsigned)(ns % 1000), core);
+        if (event.phase == 'i') {
+          line_length += snprintf(line + line_length,
+                                  sizeof(line) - line_length,
+                                  ",\"s\":\"t\",\"args\":{\"arg\":%u}",
+                                  event.arg);
+        }
+        line_length +=
+            snprintf(line + line_length, sizeof(line) - line_length, "}");
+        first_event = false;
+        next_++;
+      } else if (part_ == kDumpFooter) {
+        line_length = snprintf(line, sizeof(line), "]}");
+        part_ = kDumpDone;
+      } else {
+        end_dump();
+        break;
+      }
+    }
+
+    size_t chunk = line_length - line_position;
+    if (chunk > max_len - written) chunk = max_len - written;
+    memcpy(buffer + written, line + line_position, chunk);
+    line_position += chunk;
+    written += chunk;
+  }
+  return written;
+}
+
+void Tracer::end_dump() {
+  dumping_ = false;
+  paused_ = false;
+}
+
+#endif  // TRACE_ENABLED
@@ -0,0 +1,113 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+/**
+ * @file trace.h
+ * @brief Event tracing in the Chrome trace_event format.
+ *
+ * Build with -D TRACE_ENABLED (see platformio.ini) to record timestamped
+ * begin, end and instant events into a RAM ring, dumped at /trace as JSON
+ * that opens in Perfetto (ui.perfetto.dev) or chrome://tracing. Without the
+ * flag the TRACE_ macros compile to nothing.
+ *
+ * Recording an event takes a few dozen cycles: a relaxed atomic increment,
+ * the cycle counter and three stores, no locks, so it is safe in ISRs.
+ * Names must be string literals, only their address is stored. The
+ * timestamps are the cycle counter of the recording core, so compare times
+ * within a core's track only; everything traced here runs on the app core.
+ */
+
+#ifdef TRACE_ENABLED
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef TRACE_EVENTS
+#define TRACE_EVENTS 1024
+#endif
+
+struct TraceEvent {
+  uint32_t cycles;   ///< Cycle counter of the core
+  const char* name;
+  uint16_t arg;      ///< Shown for instant events
+  char phase;        ///< 'B'egin, 'E'nd or 'i'nstant
+  uint8_t core;
+};
+
+class Tracer {
+ public:
+  static const uint32_t kEvents = TRACE_EVENTS;
+  static_assert((kEvents & (kEvents - 1)) == 0,
+                "TRACE_EVENTS must be a power of two");
+
+  static inline __attribute__((always_inline)) void record(const char* name,
+                                                           char phase,
+                                                           uint16_t arg = 0) {
+    if (paused_) return;
+    uint32_t i = __atomic_fetch_add(&head_, 1, __ATOMIC_RELAXED);
+    TraceEvent& event = events_[i & (kEvents - 1)];
+    event.cycles = ESP.getCycleCount();
+    event.name = name;
+    event.arg = arg;
+    event.phase = phase;
+    event.core = xPortGetCoreID();
+  }
+
+  /**
+   * @brief Pause the recording and start rendering the ring.
+   *
+   * @return false if another dump is in progress
+   */
+  static bool start_dump();
+
+  /**
+   * @brief Render the next part of the dump into buffer.
+   *
+   * @return Bytes written, 0 at the end of the dump, which resumes recording
+   */
+  static size_t read_dump(uint8_t* buffer, size_t max_len);
+
+  /// Abandon the dump, e.g. when the client disconnects, and resume recording
+  static void end_dump();
+
+ protected:
+  static TraceEvent events_[kEvents];
+  static volatile uint32_t head_;
+  static volatile bool paused_;
+  // Dump state
+  static bool dumping_;
+  static uint32_t next_;         ///< Next event to render
+  static uint32_t end_;
+  static uint8_t part_;          ///< Header, events, footer
+  static uint64_t elapsed_[2];   ///< Unwrapped cycles per core
+  static uint32_t last_cycles_[2];
+  static bool first_[2];
+};
+
+/// Begin and end event around the enclosing scope
+class TraceScope {
+ public:
+  explicit inline __attribute__((always_inline)) TraceScope(const char* name)
+      : name_(name) {
+    Tracer::record(name_, 'B');
+  }
+  inline __attribute__((always_inline)) ~TraceScope() {
+    Tracer::record(name_, 'E');
+  }
+
+ protected:
+  const char* name_;
+};
+
+#define TRACE_SCOPE(name) TraceScope trace_scope_(name)
+#define TRACE_INSTANT(name, arg) Tracer::record(name, 'i', arg)
+
+#else
+
+#define TRACE_SCOPE(name)
+#define TRACE_INSTANT(name, arg)
+
+#endif  // TRACE_ENABLED
+
+#endif  // TRACE_H_
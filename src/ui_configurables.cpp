@@ -98,4 +98,127 @@ bool StringConfig::set_configuration(const JsonObject& config) {
   }
 
   return true;
-}
\ No newline at end of file
+}
+
+static const char kDirectionConfigSchema[] = R"({
+    "type": "object",
+    "properties": {
+        "value": { "title": "Offset in degrees", "type": "integer" },
+        "sin": { "title": "Non-linearity, sine amplitude in degrees", "type": "number" },
+        "cos": { "title": "Non-linearity, cosine amplitude in degrees", "type": "number" }
+    }
+  })";
+
+String DirectionConfig::get_config_schema() { return kDirectionConfigSchema; }
+
+void DirectionConfig::get_configuration(JsonObject& root) {
+  root["value"] = offset_;
+  root["sin"] = sin_;
+  root["cos"] = cos_;
+}
+
+bool DirectionConfig::set_configuration(const JsonObject& config) {
+  if (!config.containsKey("value")) {
+    return false;
+  } else {
+    offset_ = config["value"];
+  }
+  // Not present in configurations saved before the calibration existed
+  if (config.containsKey("sin")) {
+    sin_ = config["sin"];
+  }
+  if (config.containsKey("cos")) {
+    cos_ = config["cos"];
+  }
+
+  return true;
+}
+
+void DirectionConfig::set(int offset, float sin_amplitude,
+                          float cos_amplitude) {
+  offset_ = offset;
+  sin_ = sin_amplitude;
+  cos_ = cos_amplitude;
+  save_configuration();
+}
+
+static const char kDirectionTableConfigSchema[] = R"({
+    "type": "object",
+    "properties": {
+        "points": { "title": "Number of points, 36 or 72", "type": "integer" },
+        "table": { "title": "Correction in tenths of a degree, from sensor angle 0 upwards", "type": "array", "items": { "type": "integer" } }
+    }
+  })";
+
+String DirectionTableConfig::get_config_schema() {
+  return kDirectionTableConfigSchema;
+}
+
+void DirectionTableConfig::get_configuration(JsonObject& root) {
+  root["points"] = table_.get_points();
+  JsonArray table = root.createNestedArray("table");
+  for (int i = 0; i < table_.get_points(); i++) {
+    // 65536 phase units per 3600 tenths of a degree
+    table.add((int)round(table_.get(i) * 3600.0 / 65536.0));
+  }
+}
+
+bool DirectionTableConfig::set_configuration(const JsonObject& config) {
+  if (!config.containsKey("points") || !config.containsKey("table")) {
+    return false;
+  }
+
+  table_.set_points(config["points"]);
+  JsonArray table = config["table"];
+  int i = 0;
+  for (JsonVariant value : table) {
+    if (i >= table_.get_points()) break;
+    table_.set(i++, (int16_t)round(value.as<int>() * 65536.0 / 3600.0));
+  }
+
+  return true;
+}
+
+void DirectionTableConfig::set(const DirectionTable& table) {
+  table_ = table;
+  save_configuration();
+}
+
+static const char kSpeedTableConfigSchema[] = R"({
+    "type": "object",
+    "properties": {
+        "table": { "title": "Scale in percent at 0.5, 1, 2, 4, 8, 16, 32 and 64 revolutions per second", "type": "array", "items": { "type": "number" } }
+    }
+  })";
+
+String SpeedTableConfig::get_config_schema() {
+  return kSpeedTableConfigSchema;
+}
+
+void SpeedTableConfig::get_configuration(JsonObject& root) {
+  JsonArray table = root.createNestedArray("table");
+  for (int i = 0; i < SpeedTable::kPoints; i++) {
+    // 1024 per 100 percent
+    table.add(round(table_.get(i) * 1000.0 / 1024.0) / 10.0);
+  }
+}
+
+bool SpeedTableConfig::set_configuration(const JsonObject& config) {
+  if (!config.containsKey("table")) {
+    return false;
+  }
+
+  JsonArray table = config["table"];
+  int i = 0;
+  for (JsonVariant value : table) {
+    if (i >= SpeedTable::kPoints) break;
+    table_.set(i++, (uint16_t)round(value.as<float>() * 1024.0 / 100.0));
+  }
+
+  return true;
+}
+
+void SpeedTableConfig::set(const SpeedTable& table) {
+  table_ = table;
+  save_configuration();
+}
@@ -3,6 +3,9 @@
 
 #include "sensesp.h"
 #include "sensesp/system/configurable.h"
+#include "config_store.h"
+#include "direction_table.h"
+#include "speed_table.h"
 
 using namespace sensesp;
 
@@ -10,12 +13,12 @@ using namespace sensesp;
  * @brief Configurable for a single float value.
  *
  */
-class FloatConfig : public Configurable {
+class FloatConfig : public StoredConfigurable {
  public:
   FloatConfig(float value, String config_path,
              String description, int sort_order = 1000)
       : value_(value),
-        Configurable(config_path, description, sort_order) {
+        StoredConfigurable(config_path, description, sort_order) {
     load_configuration();
   }
 
@@ -33,12 +36,12 @@ class FloatConfig : public Configurable {
  * @brief Configurable for a single int value.
  *
  */
-class IntConfig : public Configurable {
+class IntConfig : public StoredConfigurable {
  public:
   IntConfig(int value, String config_path,
              String description, int sort_order = 1000)
       : value_(value),
-        Configurable(config_path, description, sort_order) {
+        StoredConfigurable(config_path, description, sort_order) {
     load_configuration();
   }
 
@@ -48,6 +51,12 @@ class IntConfig : public Configurable {
 
   int get_value() { return value_; }
 
+  /// Change the value and save it
+  void set_value(int value) {
+    value_ = value;
+    save_configuration();
+  }
+
  protected:
   int value_ = 0;
 };
@@ -56,13 +65,13 @@ class IntConfig : public Configurable {
  * @brief Configurable for a single boolean value, represented as a checkbox
  *
  */
-class CheckboxConfig : public Configurable {
+class CheckboxConfig : public StoredConfigurable {
  public:
   CheckboxConfig(bool value, String title, String config_path,
                  String description, int sort_order = 1000)
       : value_(value),
         title_(title),
-        Configurable(config_path, description, sort_order) {
+        StoredConfigurable(config_path, description, sort_order) {
     load_configuration();
   }
 
@@ -81,11 +90,11 @@ class CheckboxConfig : public Configurable {
  * @brief Configurable for a single String.
  *
  */
-class StringConfig : public Configurable {
+class StringConfig : public StoredConfigurable {
  public:
   StringConfig(String& value, String& config_path, String& description,
                int sort_order = 1000)
-      : value_(value), Configurable(config_path, description, sort_order) {
+      : value_(value), StoredConfigurable(config_path, description, sort_order) {
     load_configuration();
   }
 
@@ -100,4 +109,92 @@ class StringConfig : public Configurable {
   String title_ = "Value";
 };
 
+/**
+ * @brief Configurable for the direction correction: the mounting offset and
+ * the first harmonic of the sensor's non-linearity.
+ *
+ * The offset is stored under "value", so a configuration saved by an
+ * IntConfig at the same path is still read. All values are written in one
+ * go by set(), e.g. by the direction calibration.
+ */
+class DirectionConfig : public StoredConfigurable {
+ public:
+  DirectionConfig(int offset, String config_path, String description,
+                  int sort_order = 1000)
+      : offset_(offset), StoredConfigurable(config_path, description, sort_order) {
+    load_configuration();
+  }
+
+  virtual void get_configuration(JsonObject& doc) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual String get_config_schema() override;
+
+  /// Offset in degrees
+  int get_offset() { return offset_; }
+  /// Amplitude (degrees) of the error proportional to sin(sensor angle)
+  float get_sin() { return sin_; }
+  /// Amplitude (degrees) of the error proportional to cos(sensor angle)
+  float get_cos() { return cos_; }
+
+  /// Set all values and save them
+  void set(int offset, float sin_amplitude, float cos_amplitude);
+
+ protected:
+  int offset_ = 0;
+  float sin_ = 0.0;
+  float cos_ = 0.0;
+};
+
+/**
+ * @brief Configurable for the direction linearization table.
+ *
+ * The corrections are stored in tenths of a degree, so the table can also
+ * be reviewed and edited by hand in the configuration UI.
+ */
+class DirectionTableConfig : public StoredConfigurable {
+ public:
+  DirectionTableConfig(String config_path, String description,
+                       int sort_order = 1000)
+      : StoredConfigurable(config_path, description, sort_order) {
+    load_configuration();
+  }
+
+  virtual void get_configuration(JsonObject& doc) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual String get_config_schema() override;
+
+  DirectionTable& get_table() { return table_; }
+
+  /// Replace the table and save it
+  void set(const DirectionTable& table);
+
+ protected:
+  DirectionTable table_;
+};
+
+/**
+ * @brief Configurable for the speed calibration table of the sensor.
+ *
+ */
+class SpeedTableConfig : public StoredConfigurable {
+ public:
+  SpeedTableConfig(String config_path, String description,
+                   int sort_order = 1000)
+      : StoredConfigurable(config_path, description, sort_order) {
+    load_configuration();
+  }
+
+  virtual void get_configuration(JsonObject& doc) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual String get_config_schema() override;
+
+  SpeedTable& get_table() { return table_; }
+
+  /// Replace the table and save it
+  void set(const SpeedTable& table);
+
+ protected:
+  SpeedTable table_;
+};
+
 #endif  // UI_CONFIGURABLES_H_
@@ -0,0 +1,129 @@
+#include "wear_monitor.h"
+
+#include <math.h>
+
+// Smoothing of the current values, per window or stall
+static const float kAlpha = 0.05;
+// Largest change of the mean period between the first and the last quarter of
+// a window for the wind to count as steady
+static const float kMaxTrend = 0.05;
+// Only judge windows with the rotor between 0.5 and 20 rev/s
+static const uint32_t kMinPeriod = 50000;
+static const uint32_t kMaxPeriod = 2000000;
+
+void WearMonitor::add_period(uint32_t period) {
+  periods_[count_++] = period;
+  if (count_ == kWindow) {
+    evaluate_window();
+    count_ = 0;
+  }
+}
+
+void WearMonitor::evaluate_window() {
+  const int quarter = kWindow / 4;
+  float first = 0;
+  float last = 0;
+  float sum_sq_diff = 0;
+
+  for (int i = 0; i < kWindow; i++) {
+    if ((periods_[i] < kMinPeriod) || (periods_[i] > kMaxPeriod)) return;
+    if (i < quarter) first += periods_[i];
+    if (i >= kWindow - quarter) last += periods_[i];
+    if (i > 0) {
+      float a = periods_[i - 1];
+      float b = periods_[i];
+      float rel_diff = 2 * (b - a) / (a + b);
+      sum_sq_diff += rel_diff * rel_diff;
+    }
+  }
+
+  if (fabsf(last - first) > kMaxTrend * first) return;
+
+  // For independent jitter, successive differences have twice its variance
+  float jitter = sqrtf(sum_sq_diff / (2 * (kWindow - 1)));
+
+  jitter_ = (jitter_ == 0) ? jitter : jitter_ + kAlpha * (jitter - jitter_);
+
+  if (baseline_.windows < kBaselineWindows) {
+    baseline_.windows++;
+    baseline_.jitter += (jitter - baseline_.jitter) / baseline_.windows;
+  }
+}
+
+void WearMonitor::add_stall(uint32_t last_period) {
+  if (last_period == 0) return;
+  float rate = 1000000.0f / last_period;
+
+  stall_rate_ =
+      (stall_rate_ == 0) ? rate : stall_rate_ + kAlpha * (rate - stall_rate_);
+
+  if (baseline_.stalls < kBaselineStalls) {
+    baseline_.stalls++;
+    baseline_.stall_rate += (rate - baseline_.stall_rate) / baseline_.stalls;
+  }
+}
+
+float WearMonitor::get_wear_index() {
+  if ((baseline_.windows < kBaselineWindows) ||
+      (baseline_.stalls < kBaselineStalls) || (jitter_ == 0) ||
+      (stall_rate_ == 0)) {
+    return 0;
+  }
+
+  float index = 0;
+  if (baseline_.jitter > 0) index = jitter_ / baseline_.jitter;
+  if (baseline_.stall_rate > 0) {
+    float stall_index = stall_rate_ / baseline_.stall_rate;
+    if (stall_index > index) index = stall_index;
+  }
+  return index;
+}
+
+void WearMonitor::add_time(uint32_t seconds) {
+  history_.seconds += seconds;
+  if (history_.seconds < kDay) return;
+  history_.seconds -= kDay;
+
+  float index = get_wear_index();
+  if (index == 0) return;  // Nothing to compare with yet
+  history_.index[history_.days % WearHistory::kDays] = index;
+  history_.days++;
+}
+
+float WearMonitor::get_trend() {
+  int n = (history_.days < WearHistory::kDays) ? history_.days
+                                                : WearHistory::kDays;
+  if (n < kMinTrendDays) return 0;
+
+  // Least squares slope, x being the age order of the days
+  float sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0;
+  for (int x = 0; x < n; x++) {
+    float y = history_.index[(history_.days - n + x) % WearHistory::kDays];
+    sum_x += x;
+    sum_y += y;
+    sum_xx += (float)x * x;
+    sum_xy += x * y;
+  }
+  return (n * sum_xy - sum_x * sum_y) / (n * sum_xx - sum_x * sum_x);
+}
+
+float WearMonitor::days_until(float limit) {
+  float trend = get_trend();
+  if (trend <= 0) return -1;
+  float index = get_wear_index();
+  if (index >= limit) return 0;
+  return (limit - index) / trend;
+}
+
+WearHistory WearMonitor::get_history() {
+  WearHistory history = history_;
+  history.jitter = jitter_;
+  history.stall_rate = stall_rate_;
+  return history;
+}
+
+void WearMonitor::set_history(const WearHistory& history) {
+  history_ = history;
+  jitter_ = history.jitter;
+  stall_rate_ = history.stall_rate;
+}
@@ -0,0 +1,109 @@
+#ifndef WEAR_MONITOR_H_
+#define WEAR_MONITOR_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Reference values of a sensor in good condition, kept in flash.
+ */
+struct WearBaseline {
+  float jitter = 0;      // Mean revolution jitter at steady wind
+  float stall_rate = 0;  // Mean rotor rate (rev/s) just before stalling
+  uint16_t windows = 0;  // Steady windows the jitter baseline is based on
+  uint16_t stalls = 0;   // Stalls the stall rate baseline is based on
+};
+
+/**
+ * @brief The current values and the recent wear index, kept in flash so
+ * that they survive a restart.
+ */
+struct WearHistory {
+  static const int kDays = 32;
+
+  float jitter = 0;
+  float stall_rate = 0;
+  float index[kDays] = {};  // Wear index per day of operation, a ring
+  uint16_t days = 0;        // Days recorded, the next goes to days % kDays
+  uint32_t seconds = 0;     // Operating time since the last recorded day
+};
+
+/**
+ * @brief Predictive maintenance analysis of the revolution periods.
+ *
+ * With one pulse per revolution there is no view into a revolution, but the
+ * period series still shows bearing friction and rotor imbalance: more
+ * revolution-to-revolution jitter at steady wind, and a rotor that stalls
+ * at ever higher speeds. The periods are collected in non-overlapping
+ * windows of kWindow revolutions. Windows with a trend in the wind speed
+ * are discarded, the jitter of the others (RMS of successive relative
+ * differences, insensitive to slow changes of the wind) is averaged.
+ *
+ * The first kBaselineWindows steady windows and kBaselineStalls stalls
+ * make up the baseline, which is then frozen until reset (e.g. after new
+ * bearings). The wear index is the worse of the ratios of the current
+ * values to the baseline, 1.0 meaning as new.
+ *
+ * The index is recorded once per day of operation (not of calendar time, as
+ * the sensor may only be powered while sailing). The trend is the least
+ * squares slope over the last WearHistory::kDays of them, so a rising index
+ * can be reported before it crosses a threshold.
+ *
+ * Each period costs O(1) on average, memory use is fixed.
+ */
+class WearMonitor {
+ public:
+  static const int kWindow = 32;
+  static const uint16_t kBaselineWindows = 500;
+  static const uint16_t kBaselineStalls = 20;
+  static const uint32_t kDay = 86400;  ///< Seconds of operation per day
+  static const uint16_t kMinTrendDays = 7;
+
+  /// Add the period (in microseconds) of a revolution
+  void add_period(uint32_t period);
+
+  /// Report that the rotor stopped, after last_period as its last revolution
+  void add_stall(uint32_t last_period);
+
+  /// Count operating time, recording the wear index of every full day
+  void add_time(uint32_t seconds);
+
+  /// Current jitter, averaged over recent steady windows
+  float get_jitter() { return jitter_; }
+  /// Current rotor rate just before stalling, rev/s
+  float get_stall_rate() { return stall_rate_; }
+
+  /// Wear index, 0 while the baseline or the current values are learned
+  float get_wear_index();
+
+  /// Change of the wear index per day of operation, 0 before kMinTrendDays
+  float get_trend();
+
+  /**
+   * @brief Days of operation until the wear index reaches limit at the
+   * current trend, negative if it is not rising.
+   */
+  float days_until(float limit);
+
+  const WearBaseline& get_baseline() { return baseline_; }
+  void set_baseline(const WearBaseline& baseline) { baseline_ = baseline; }
+  void reset_baseline() {
+    baseline_ = WearBaseline();
+    history_ = WearHistory();
+  }
+
+  WearHistory get_history();
+  void set_history(const WearHistory& history);
+
+ protected:
+  void evaluate_window();
+
+  uint32_t periods_[kWindow];
+  int count_ = 0;
+
+  float jitter_ = 0;
+  float stall_rate_ = 0;
+  WearBaseline baseline_;
+  WearHistory history_;
+};
+
+#endif  // WEAR_MONITOR_H_
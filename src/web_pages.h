@@ -0,0 +1,96 @@
+#ifndef WEB_PAGES_H_
+#define WEB_PAGES_H_
+
+#include "Arduino.h"
+
+// Direction linearization table calibration, served at /calibration/table/ui
+static const char kDirectionTablePage[] PROGMEM = R"html(<!DOCTYPE html>
+<html><head><meta name="viewport" content="width=device-width"><title>Direction table</title></head>
+<body style="font-family:sans-serif">
+<h3>Direction linearization</h3>
+<p>Keep the cups turning (e.g. with a fan), point the vane at a mark of a compass rose
+centred on the sensor and record it. Repeat all the way round, then finish to save the table.</p>
+<p><select id="pts"><option>36</option><option>72</option></select> points
+<button onclick="post('start?points='+pts.value)">Start</button></p>
+<p>Vane at <input id="ang" type="number" value="0" step="10" style="width:5em"> degrees
+<button onclick="post('point?angle='+ang.value).then(()=>{ang.value=(+ang.value+10)%360})">Record</button></p>
+<p><button onclick="post('finish')">Finish and save</button></p>
+<pre id="st"></pre>
+<script>
+function show(){return fetch('/calibration/table').then(r=>r.text()).then(t=>{st.textContent=t})}
+function post(p){return fetch('/calibration/table/'+p,{method:'POST'}).then(()=>new Promise(r=>setTimeout(r,300))).then(show)}
+show()
+</script>
+</body></html>
+)html";
+
+// Live debug chart of the WebSocket stream at /debug/ws, served at /debug/plot.
+// gzip -9n of web/debug_plot.html, regenerate it after editing the page.
+static const uint8_t kDebugPlotPageGz[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x9d, 0x55, 0xc1, 0x6e, 0xe3, 0x36,
+  0x10, 0xbd, 0xfb, 0x2b, 0xb8, 0x0a, 0x5a, 0x52, 0x11, 0x2d, 0xc9, 0x4e, 0x10, 0x18, 0x96, 0xe4,
+  0x1c, 0x92, 0xec, 0xa1, 0x40, 0xb3, 0x8b, 0x26, 0xed, 0xa2, 0x48, 0x73, 0xa0, 0x25, 0x52, 0xe2,
+  0x46, 0x22, 0x05, 0x91, 0xb6, 0xd6, 0x48, 0xf2, 0xef, 0x1d, 0x4a, 0xb6, 0x93, 0x06, 0x7b, 0xea,
+  0xc5, 0x26, 0xe7, 0x71, 0x66, 0x1e, 0x67, 0xde, 0x50, 0xe9, 0xa7, 0xeb, 0x2f, 0x57, 0xf7, 0x7f,
+  0x7f, 0xbd, 0x41, 0x95, 0x6d, 0xea, 0xd5, 0x24, 0x1d, 0xfe, 0xd2, 0x8a, 0xb3, 0x62, 0x95, 0x36,
+  0xdc, 0x32, 0xa4, 0x58, 0xc3, 0x33, 0x6f, 0x2b, 0x79, 0xdf, 0xea, 0xce, 0x7a, 0x28, 0xd7, 0xca,
+  0x72, 0x65, 0x33, 0xaf, 0x97, 0x85, 0xad, 0xb2, 0x82, 0x6f, 0x65, 0xce, 0xa7, 0xc3, 0xc6, 0x5b,
+  0xa5, 0x56, 0xda, 0x9a, 0xaf, 0xbe, 0x49, 0x55, 0xa0, 0x82, 0xaf, 0x37, 0x65, 0x1a, 0x8d, 0x96,
+  0x34, 0x1a, 0x42, 0x4e, 0xd2, 0xb5, 0x2e, 0x76, 0xc8, 0xd8, 0x5d, 0x0d, 0x41, 0x05, 0x84, 0x9a,
+  0x0a, 0xd6, 0xc8, 0x7a, 0xb7, 0x34, 0x4c, 0x99, 0xa9, 0xe1, 0x9d, 0x14, 0x9e, 0x63, 0x71, 0xf6,
+  0x2e, 0x06, 0x1c, 0xef, 0x38, 0x6b, 0x20, 0xc4, 0x19, 0x40, 0xed, 0xea, 0x46, 0xb1, 0x75, 0xcd,
+  0x91, 0x77, 0x3d, 0x80, 0x77, 0x03, 0xe8, 0x21, 0xa9, 0x90, 0xad, 0x38, 0x32, 0xdc, 0x5a, 0xa9,
+  0x4a, 0x13, 0xa2, 0x6b, 0x6d, 0x0d, 0x62, 0x1d, 0x1f, 0xcc, 0x1d, 0xdf, 0xea, 0x7a, 0x63, 0xa5,
+  0x56, 0x06, 0x91, 0x8e, 0x17, 0xa8, 0xaf, 0x38, 0x40, 0x0c, 0x62, 0xb3, 0xd2, 0xc1, 0xdf, 0x79,
+  0x6e, 0xc1, 0x0c, 0x67, 0x1b, 0x9f, 0xa2, 0x5a, 0x2a, 0x6e, 0x06, 0x47, 0x21, 0x6b, 0xcb, 0x3b,
+  0xa4, 0x37, 0xb6, 0xdd, 0x58, 0x13, 0xa6, 0x51, 0x0b, 0x1c, 0x72, 0xa6, 0xb6, 0xcc, 0x20, 0x59,
+  0x64, 0x9e, 0x69, 0x0b, 0x0f, 0x8d, 0xa5, 0xf0, 0x16, 0x71, 0xec, 0xa1, 0x8a, 0xcb, 0xb2, 0x82,
+  0xf2, 0xcc, 0xdd, 0x66, 0x7f, 0xd1, 0x01, 0x5f, 0xce, 0xe2, 0xf8, 0x17, 0x28, 0x51, 0x34, 0x7a,
+  0xff, 0x37, 0x4c, 0x21, 0xbb, 0xff, 0x1d, 0xa6, 0x85, 0x8b, 0x0c, 0x54, 0xac, 0x33, 0xc3, 0x0e,
+  0x6c, 0x26, 0xef, 0x64, 0x6b, 0x57, 0x13, 0xe8, 0x96, 0xb1, 0xe8, 0x36, 0xbb, 0x88, 0x63, 0xfa,
+  0x39, 0x9b, 0x9f, 0x27, 0x35, 0xb7, 0x48, 0x74, 0xd9, 0xc3, 0x23, 0x2d, 0x3a, 0xdd, 0x66, 0x31,
+  0x85, 0xab, 0x67, 0xcf, 0xaf, 0xc9, 0x44, 0x6c, 0x54, 0xee, 0xea, 0x83, 0xda, 0x5a, 0x5b, 0x92,
+  0xd3, 0x8e, 0xf5, 0x14, 0x6e, 0x4d, 0x1b, 0xf6, 0xc3, 0x7f, 0x1e, 0xc3, 0x94, 0x59, 0x1e, 0x96,
+  0xdc, 0x5e, 0x39, 0x05, 0xfc, 0xb0, 0x04, 0xcf, 0x0b, 0xec, 0xd3, 0x1e, 0x8c, 0x03, 0x31, 0x5a,
+  0xc1, 0x6a, 0xa4, 0x9d, 0x94, 0x61, 0x5e, 0x73, 0xd6, 0xfd, 0x01, 0x45, 0x25, 0x31, 0x8d, 0x69,
+  0x4f, 0x2b, 0x3f, 0x99, 0xb8, 0xdc, 0x4d, 0x06, 0x01, 0x5f, 0x5e, 0x7e, 0x67, 0xb6, 0x0a, 0x61,
+  0x45, 0xe0, 0x36, 0x34, 0x0c, 0x43, 0xd1, 0xc1, 0xae, 0x25, 0x22, 0x5b, 0x1d, 0x11, 0xf1, 0x00,
+  0x14, 0x1e, 0xa9, 0x78, 0x00, 0x16, 0x8f, 0xbe, 0x0f, 0xfe, 0x70, 0x48, 0xe8, 0xee, 0x86, 0xe5,
+  0x15, 0x21, 0x82, 0x4a, 0x3f, 0x5b, 0x3d, 0x97, 0x21, 0x34, 0xa8, 0xbe, 0x1b, 0xea, 0x23, 0x42,
+  0xfd, 0x74, 0x89, 0x4f, 0x16, 0x8b, 0x05, 0x5e, 0xe2, 0x93, 0x22, 0x8e, 0x71, 0x32, 0xc2, 0x03,
+  0x0d, 0x79, 0xda, 0x47, 0xb7, 0xb4, 0x9a, 0x8e, 0x61, 0x4f, 0xab, 0xa8, 0xa1, 0x73, 0x3a, 0xf7,
+  0x5f, 0x21, 0x6e, 0x19, 0x82, 0xc2, 0xf4, 0x13, 0x1f, 0xc3, 0xe0, 0x93, 0xf8, 0x22, 0x77, 0xae,
+  0x6b, 0x5e, 0x4a, 0xf5, 0x15, 0xe8, 0x10, 0x3f, 0xf9, 0x49, 0xea, 0xb1, 0x26, 0xbb, 0xcc, 0x85,
+  0x74, 0x14, 0x5d, 0xc8, 0x44, 0x5e, 0x96, 0xa1, 0x13, 0xcf, 0xbd, 0xde, 0x27, 0xdc, 0xf9, 0xcb,
+  0x32, 0x6c, 0xf4, 0xd6, 0x59, 0x62, 0xd8, 0x41, 0xbe, 0x43, 0x3a, 0x32, 0xa4, 0x7e, 0xe3, 0x0f,
+  0x89, 0xdf, 0x38, 0xdf, 0xbb, 0x0a, 0x3b, 0x8a, 0xb3, 0xd8, 0x7f, 0x7d, 0x6b, 0x4e, 0x01, 0xe4,
+  0x89, 0xff, 0x3c, 0xf4, 0x08, 0xa4, 0x47, 0x71, 0xde, 0xb4, 0x06, 0x53, 0x0c, 0x6b, 0xec, 0x27,
+  0x83, 0x19, 0xa4, 0x44, 0x31, 0xfc, 0x80, 0xb5, 0x00, 0x5e, 0x98, 0x9e, 0x5d, 0xc4, 0x90, 0xc9,
+  0xd8, 0xd0, 0x75, 0xed, 0x6a, 0x3f, 0xbe, 0xd8, 0xb5, 0xbf, 0x05, 0xc5, 0xe3, 0xc0, 0xad, 0x02,
+  0xfc, 0x8f, 0x3a, 0x0e, 0x01, 0xb3, 0xfb, 0xb1, 0xc0, 0xc1, 0x6f, 0x77, 0x5f, 0x6e, 0x1d, 0x5d,
+  0x18, 0x29, 0x29, 0x76, 0x30, 0x39, 0xdf, 0xfd, 0x80, 0x40, 0x31, 0x6a, 0xae, 0x4a, 0x5b, 0x5d,
+  0x82, 0x57, 0x0b, 0x33, 0xab, 0x5d, 0x18, 0xd1, 0x3d, 0x1c, 0x81, 0xe9, 0xec, 0x31, 0x04, 0x20,
+  0xc0, 0x68, 0x63, 0x28, 0x6a, 0x2b, 0x66, 0xf8, 0xcf, 0x4e, 0x54, 0x4b, 0x8c, 0xdf, 0xdf, 0x0e,
+  0x4a, 0xaa, 0x5c, 0xaf, 0x0e, 0x82, 0xeb, 0x4d, 0xa6, 0x78, 0x8f, 0xbe, 0xf1, 0xf5, 0x9d, 0xce,
+  0x9f, 0x38, 0x48, 0xae, 0x37, 0xcb, 0x28, 0xc2, 0x41, 0xad, 0x73, 0xe6, 0x3c, 0xc2, 0x4a, 0x1b,
+  0x1b, 0xe0, 0x68, 0x78, 0x27, 0xa2, 0xde, 0x40, 0x0d, 0x7a, 0x13, 0xae, 0xa5, 0x62, 0xdd, 0xee,
+  0x7e, 0xd7, 0x42, 0x4d, 0x59, 0xd7, 0xb1, 0xdd, 0x7a, 0x23, 0x04, 0xef, 0x70, 0x32, 0x01, 0x50,
+  0xab, 0x86, 0x1b, 0x03, 0xb7, 0xcb, 0xf8, 0xb1, 0x89, 0xdb, 0x21, 0xcd, 0x35, 0xb3, 0xec, 0x2f,
+  0x78, 0xe7, 0x08, 0x0f, 0x0b, 0x58, 0xfa, 0x54, 0x65, 0x5b, 0xa7, 0xf7, 0x3f, 0xa5, 0xb2, 0x0b,
+  0x32, 0xf3, 0x93, 0xa1, 0x50, 0x6f, 0xb6, 0xd9, 0x05, 0x99, 0x53, 0xdb, 0x6d, 0xb8, 0x93, 0xa6,
+  0xee, 0x88, 0x93, 0xb7, 0xcc, 0xe2, 0x44, 0xa6, 0x2a, 0x91, 0x41, 0x70, 0xb8, 0x84, 0xce, 0xce,
+  0x03, 0x79, 0xfa, 0x99, 0x9a, 0xf7, 0xd1, 0x74, 0x30, 0x9f, 0xfb, 0x54, 0xd4, 0x1f, 0x6c, 0x67,
+  0x10, 0x6a, 0xf4, 0x12, 0xd9, 0x33, 0x14, 0x70, 0x79, 0x84, 0xcf, 0xe6, 0x80, 0x9f, 0x8f, 0xe9,
+  0x28, 0x14, 0xee, 0x3d, 0x0b, 0x1d, 0xcc, 0xf6, 0x44, 0xa8, 0x93, 0xc3, 0x47, 0xec, 0xe0, 0x05,
+  0x9a, 0xf8, 0x08, 0x5d, 0xec, 0xa1, 0x09, 0xe8, 0xe7, 0x23, 0xb6, 0x38, 0xb8, 0x81, 0x88, 0x3e,
+  0x60, 0xf3, 0x78, 0x8f, 0xe9, 0xa7, 0x25, 0x11, 0xf5, 0xaf, 0x0b, 0x7f, 0x15, 0xc3, 0x13, 0x22,
+  0x05, 0xf9, 0xe4, 0x86, 0xd0, 0x07, 0x99, 0x3c, 0x98, 0xc7, 0x8c, 0x8c, 0xff, 0x2f, 0x2f, 0xb1,
+  0x1f, 0xcc, 0xdc, 0x08, 0xb5, 0x1b, 0x53, 0x11, 0x01, 0x1d, 0x87, 0x93, 0x47, 0x25, 0xac, 0x6e,
+  0x7d, 0x78, 0x90, 0x60, 0x6b, 0x6a, 0xf8, 0x92, 0x90, 0xe9, 0xad, 0x2b, 0xb4, 0x53, 0xf9, 0xeb,
+  0xbe, 0x5f, 0x79, 0xad, 0x0d, 0xcf, 0x08, 0xcc, 0x1c, 0x3c, 0xee, 0xf7, 0xb2, 0xe1, 0x40, 0x88,
+  0xec, 0xa5, 0x42, 0xe1, 0x7d, 0x74, 0x03, 0x72, 0x54, 0xce, 0x24, 0x8d, 0x0e, 0x6f, 0x5f, 0x1a,
+  0xb9, 0x8f, 0x8d, 0xfb, 0xf4, 0x0c, 0x9f, 0xb6, 0x7f, 0x01, 0x11, 0xb6, 0x3d, 0xfc, 0xeb, 0x06,
+  0x00, 0x00,
+};
+
+#endif  // WEB_PAGES_H_
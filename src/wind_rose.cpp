@@ -0,0 +1,92 @@
+#include "wind_rose.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+// Beaufort-like steps in m/s: 0, 2, 4, 6, 8, 11, 14, 17
+const int32_t WindRose::kSpeedBinEdges[kSpeedBins] = {0,   200,  400,  600,
+                                                      800, 1100, 1400, 1700};
+
+// Renormalize long before the cells, time_constant_ * scale_, lose precision
+static const double kMaxScale = 1e12;
+
+WindRose::WindRose(float time_constant) : time_constant_(time_constant) {
+  for (int s = 0; s < kSectors; s++) {
+    for (int b = 0; b < kSpeedBins; b++) {
+      cells_[s][b] = 0;
+    }
+  }
+}
+
+void WindRose::add(float speed, float direction, float dt) {
+  // Growing the weight of new samples by e^(dt/tau) is the same as decaying
+  // all existing cells by e^(-dt/tau)
+  scale_ *= exp((double)dt / time_constant_);
+  if (scale_ > kMaxScale) renormalize();
+
+  int sector = (int)((direction + 180.0f / kSectors) * kSectors / 360.0f);
+  sector %= kSectors;
+  if (sector < 0) sector += kSectors;
+
+  int bin = kSpeedBins - 1;
+  while ((bin > 0) && (speed < kSpeedBinEdges[bin])) bin--;
+
+  cells_[sector][bin] += (double)dt * scale_;
+}
+
+void WindRose::renormalize() {
+  for (int s = 0; s < kSectors; s++) {
+    for (int b = 0; b < kSpeedBins; b++) {
+      cells_[s][b] /= scale_;
+    }
+  }
+  scale_ = 1;
+}
+
+void WindRose::export_cells(float* cells) {
+  for (int s = 0; s < kSectors; s++) {
+    for (int b = 0; b < kSpeedBins; b++) {
+      *cells++ = get(s, b);
+    }
+  }
+}
+
+void WindRose::import_cells(const float* cells) {
+  scale_ = 1;
+  for (int s = 0; s < kSectors; s++) {
+    for (int b = 0; b < kSpeedBins; b++) {
+      cells_[s][b] = *cells++;
+    }
+  }
+}
+
+// snprintf at the end of buf, false once buf is full
+static bool append(char* buf, size_t size, size_t* len, const char* format,
+                   ...) {
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(buf + *len, size - *len, format, args);
+  va_end(args);
+  if ((n < 0) || ((size_t)n >= size - *len)) return false;
+  *len += n;
+  return true;
+}
+
+size_t WindRose::to_json(char* buf, size_t size) {
+  size_t len = 0;
+
+  if (!append(buf, size, &len, "[")) return len;
+  for (int s = 0; s < kSectors; s++) {
+    if (!append(buf, size, &len, "%s[", (s > 0) ? "," : "")) return len;
+    for (int b = 0; b < kSpeedBins; b++) {
+      if (!append(buf, size, &len, "%s%.0f", (b > 0) ? "," : "", get(s, b))) {
+        return len;
+      }
+    }
+    if (!append(buf, size, &len, "]")) return len;
+  }
+  append(buf, size, &len, "]");
+
+  return len;
+}
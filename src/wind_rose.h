@@ -0,0 +1,66 @@
+#ifndef WIND_ROSE_H_
+#define WIND_ROSE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Direction sector x speed bin histogram with exponential decay.
+ *
+ * Each cell holds the (decayed) time in seconds the wind spent in that
+ * sector and speed bin. Instead of decaying every cell on every sample, new
+ * samples are weighted ever more heavily by a growing scale factor, so an
+ * update is O(1); the cells are renormalized only when the scale gets
+ * large. Memory use is fixed.
+ *
+ * The scale and the cells are doubles. The growth per sample of the day
+ * rose, e^(0.1/86400), is close to the resolution of a float, which would
+ * round much of it away, and a float cell holding a day of samples would
+ * keep only a few bits of each new one.
+ */
+class WindRose {
+ public:
+  static const int kSectors = 16;
+  static const int kSpeedBins = 8;
+
+  /// Lower edges of the speed bins, in cm/s
+  static const int32_t kSpeedBinEdges[kSpeedBins];
+
+  /**
+   * @param time_constant Decay time constant in seconds, e.g. 3600 for the
+   *   last hour
+   */
+  explicit WindRose(float time_constant);
+
+  /**
+   * @param speed Speed in cm/s
+   * @param direction Direction in degrees
+   * @param dt Time the sample stands for, in seconds
+   */
+  void add(float speed, float direction, float dt);
+
+  /// Decayed time in seconds for a sector and speed bin
+  float get(int sector, int bin) { return cells_[sector][bin] / scale_; }
+
+  /// Copy the decayed times of all cells into cells (kSectors * kSpeedBins)
+  void export_cells(float* cells);
+  /// Restore the cells, e.g. after a reboot
+  void import_cells(const float* cells);
+
+  /**
+   * @brief Append the histogram as a JSON array of kSectors arrays of
+   * kSpeedBins values to buf.
+   *
+   * @return Number of characters written, not counting the terminating 0
+   */
+  size_t to_json(char* buf, size_t size);
+
+ protected:
+  void renormalize();
+
+  float time_constant_;
+  double scale_ = 1;
+  double cells_[kSectors][kSpeedBins];
+};
+
+#endif  // WIND_ROSE_H_
@@ -0,0 +1,42 @@
+#include "wind_snapshot.h"
+
+#include <string.h>
+
+bool WindSnapshot::commit(size_t length, size_t compared) {
+  uint32_t version = version_;
+  uint8_t back = (version + 1) & 1;
+  uint8_t front = version & 1;
+  if (length >= kSize) length = kSize - 1;
+
+  if (compared >= length) {
+    if ((length == lengths_[front]) &&
+        (memcmp(buffers_[back], buffers_[front], length) == 0)) {
+      return false;
+    }
+  } else if ((compared <= lengths_[front]) &&
+             (memcmp(buffers_[back], buffers_[front], compared) == 0)) {
+    return false;
+  }
+
+  lengths_[back] = length;
+  // The snapshot is complete before it is published
+  __sync_synchronize();
+  version_ = version + 1;
+  return true;
+}
+
+size_t WindSnapshot::read(char* out, uint32_t* version) const {
+  while (true) {
+    uint32_t before = version_;
+    __sync_synchronize();
+    uint8_t front = before & 1;
+    size_t length = lengths_[front];
+    if (length >= kSize) length = 0;  // Torn by an update, retried below
+    memcpy(out, buffers_[front], length);
+    __sync_synchronize();
+    if (version_ == before) {
+      *version = before;
+      return length;
+    }
+  }
+}
@@ -0,0 +1,54 @@
+#ifndef WIND_SNAPSHOT_H_
+#define WIND_SNAPSHOT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief The latest wind as pre-serialized text, for a polling endpoint.
+ *
+ * The single writer serializes into the back buffer and flips it to the
+ * front by bumping the version, whose parity selects the front buffer. A
+ * reader copies the front buffer and retries if the version moved meanwhile,
+ * so reads take no lock and never block the writer. As the writer only ever
+ * changes the buffer that is not in front, a reader is only disturbed by two
+ * updates within its copy.
+ *
+ * The version only changes with the content, so it serves as the ETag.
+ */
+class WindSnapshot {
+ public:
+  static const size_t kSize = 192;
+
+  /// The buffer to serialize the next snapshot into, kSize bytes
+  char* begin_update() { return buffers_[(version_ + 1) & 1]; }
+
+  /**
+   * @brief Publish the snapshot written since begin_update().
+   *
+   * Only the first compared bytes decide whether it changed, so a trailing
+   * timestamp does not make every snapshot a new version.
+   *
+   * @param compared Bytes to compare, the whole snapshot if larger
+   * @return false if it equals the current one, which stays in front
+   */
+  bool commit(size_t length, size_t compared = kSize);
+
+  /**
+   * @brief Copy the current snapshot.
+   *
+   * @param out At least kSize bytes
+   * @param version The version of the copy
+   * @return Length of the copy, 0 before the first commit
+   */
+  size_t read(char* out, uint32_t* version) const;
+
+  uint32_t get_version() const { return version_; }
+
+ protected:
+  char buffers_[2][kSize];
+  size_t lengths_[2] = {0, 0};
+  volatile uint32_t version_ = 0;
+};
+
+#endif  // WIND_SNAPSHOT_H_
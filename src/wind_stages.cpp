@@ -0,0 +1,3 @@
+#include "wind_stages.h"
+
+WindContext wind_context;
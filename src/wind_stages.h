@@ -0,0 +1,254 @@
+#ifndef WIND_STAGES_H_
+#define WIND_STAGES_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "anemometer_model.h"
+#include "direction_table.h"
+#include "filter_profile.h"
+#include "overspeed.h"
+#include "pipeline.h"
+#include "speed_table.h"
+
+/**
+ * @brief The inputs and the state of the revolution processing.
+ *
+ * The stages of a Pipeline only get the WindSample, so whatever else they
+ * read or carry from one revolution to the next is here, in wind_context.
+ * The caller sets the inputs before each run: the time, the sensor tables
+ * and corrections, and the flags of the sampling. Nothing in it depends on
+ * the hardware, so the stages run on the host as they do on the device.
+ */
+struct WindContext {
+  // Inputs
+  unsigned long now = 0;      ///< micros() at the processing
+  unsigned long timeout = 0;  ///< Longer since the speed pulse is a stall, us
+  FilterCoefficients filter = {};
+  SpeedTable* speed_table = nullptr;
+  DirectionTable* dir_table = nullptr;
+  int dir_offset = 0;    ///< Degrees between device-north and the bow
+  float dir_sin = 0.0f;  ///< First harmonic of the sensor non-linearity, deg
+  float dir_cos = 0.0f;
+  OverspeedCompensator overspeed;  ///< With the distance constant set
+  bool true_periods = true;  ///< The periods are of single revolutions
+  bool dir_valid = true;     ///< A direction phase is captured
+  bool vane_ready = false;   ///< The analog vane has a reading
+  uint16_t vane_phase = 0;   ///< Its phase, 65536 per turn
+  void (*on_phase)(uint16_t) = nullptr;  ///< Called with each phase, or null
+
+  // Outputs
+  int speed_out = 0;  ///< Filtered speed, cm/s
+  int dir_out = 0;    ///< Filtered direction, degrees
+  long rps = 0;       ///< Rotor rate of the last revolution, per 100 s
+  bool ignore_next = false;  ///< A speed was rejected since boot
+
+  // Filter state, and the last speed and direction, valid or not, for the
+  // deviation checks
+  int32_t speed_state = 0;  // cm/s in Q16
+  int prev_speed = 0;
+  int prev_dir = 0;
+};
+
+extern WindContext wind_context;
+
+template <class Model>
+bool check_speed_dev(long cmps, int dev) {
+  if (cmps < Model::kBand0) return abs(dev) < Model::kSpeedDevLimit0;
+  if (cmps < Model::kBand1) return abs(dev) < Model::kSpeedDevLimit1;
+  return abs(dev) < Model::kSpeedDevLimit2;
+}
+
+template <class Model>
+bool check_dir_dev(long cmps, int dev) {
+  int limit = (cmps < Model::kBand0)   ? Model::kDirDevLimit0
+              : (cmps < Model::kBand1) ? Model::kDirDevLimit1
+                                       : Model::kDirDevLimit2;
+  return (abs(dev) < limit) || (abs(dev) > 360 - limit);
+}
+
+/**
+ * @brief Apply the first harmonic of the sensor non-linearity.
+ *
+ * A function of the sensor angle, the direction before the offset is added.
+ */
+inline long correct_direction(long direction) {
+  const WindContext& c = wind_context;
+  if ((c.dir_sin == 0.0f) && (c.dir_cos == 0.0f)) return direction;
+
+  float sensor_angle = (direction - c.dir_offset) * 0.0174533;
+  direction = (direction + (long)round(c.dir_sin * sin(sensor_angle) +
+                                       c.dir_cos * cos(sensor_angle))) %
+              360;
+  if (direction < 0) direction += 360;
+  return direction;
+}
+
+/// Make the speed zero if the pulse is too long ago
+struct CheckTimeout {
+  static constexpr const char* kName = "CheckTimeout";
+
+  static inline bool run(WindSample& s) {
+    if (wind_context.now - s.speed_pulse > wind_context.timeout) {
+      s.speed_time = 0;
+    }
+    return true;
+  }
+};
+
+/**
+ * @brief Convert the period to revolutions per 100 s and to cm/s.
+ *
+ * With the calibration curve of the model, the per-sensor table and, for
+ * cup rotors, the overspeed compensation. Periods averaged over several
+ * revolutions hide the speed changes the compensation needs, so those are
+ * passed as they are.
+ */
+template <class Model>
+struct CalibrateSpeed {
+  static constexpr const char* kName = "CalibrateSpeed";
+
+  static inline bool run(WindSample& s) {
+    WindContext& c = wind_context;
+    if (s.speed_time == 0) {
+      c.speed_out = 0;
+      c.speed_state = 0;
+      c.prev_speed = 0;
+      return false;
+    }
+
+    s.rps = 100000000 / (s.speed_time * Model::kPulsesPerRevolution);
+    c.rps = s.rps;
+
+    s.cmps = Model::calibrate(s.rps);
+    if (s.cmps < 0) s.cmps = 0;
+    s.cmps = c.speed_table->correct(s.cmps, s.rps);
+    if (Model::kRotor) {
+      if (c.true_periods) {
+        s.cmps = c.overspeed.compensate(s.cmps, s.speed_pulse, s.speed_time);
+      } else {
+        c.overspeed.reset();
+      }
+    }
+    return true;
+  }
+};
+
+/// Only continue if plausible and in the deviation limit
+template <class Model>
+struct ValidateSpeed {
+  static constexpr const char* kName = "ValidateSpeed";
+
+  static inline bool run(WindSample& s) {
+    WindContext& c = wind_context;
+    int dev = (int)s.cmps - c.prev_speed;
+    // Updated even outside the deviation limit, it might be valid
+    c.prev_speed = s.cmps;
+    bool valid =
+        (s.cmps <= Model::kMaxSpeed) && check_speed_dev<Model>(s.cmps, dev);
+    if (!valid) c.ignore_next = true;
+    return valid;
+  }
+};
+
+/// Speed filter, rising with the attack and falling with the release gain
+struct FilterSpeed {
+  static constexpr const char* kName = "FilterSpeed";
+
+  static inline bool run(WindSample& s) {
+    WindContext& c = wind_context;
+    int32_t target = s.cmps << 16;
+    int32_t gain = (target > c.speed_state) ? c.filter.speed_attack
+                                            : c.filter.speed_release;
+    c.speed_state += (int32_t)(((int64_t)(target - c.speed_state) * gain) >> 16);
+    c.speed_out = c.speed_state >> 16;
+    return true;
+  }
+};
+
+/**
+ * @brief The direction as a phase of 65536 per turn.
+ *
+ * From the captured pulse times, or the vane's, which turns the other way.
+ */
+template <class Model>
+struct MeasurePhase {
+  static constexpr const char* kName = "MeasurePhase";
+
+  static inline bool run(WindSample& s) {
+    WindContext& c = wind_context;
+    if (Model::kDirection == kAnalogVane) {
+      if (!c.vane_ready) return false;
+      s.phase = (uint16_t)(0u - c.vane_phase);
+    } else {
+      if (!c.dir_valid || (s.direction_time > s.speed_time)) return false;
+      s.phase =
+          (uint16_t)((((uint64_t)s.direction_time) << 16) / s.speed_time);
+    }
+    if (c.on_phase != nullptr) c.on_phase(s.phase);
+    return true;
+  }
+};
+
+/// Linearize the phase with the sensor's table, apply the offset and the
+/// harmonic correction
+struct CorrectDirection {
+  static constexpr const char* kName = "CorrectDirection";
+
+  static inline bool run(WindSample& s) {
+    WindContext& c = wind_context;
+    uint16_t phase = c.dir_table->correct(s.phase);
+    s.direction = phase_to_direction(phase, c.dir_offset);
+    s.direction = correct_direction(s.direction);
+    return true;
+  }
+};
+
+/// Check the deviation from the previous direction is in range
+template <class Model>
+struct ValidateDirection {
+  static constexpr const char* kName = "ValidateDirection";
+
+  static inline bool run(WindSample& s) {
+    WindContext& c = wind_context;
+    int dev = (int)s.direction - c.prev_dir;
+    c.prev_dir = s.direction;
+    return check_dir_dev<Model>(s.cmps, dev);
+  }
+};
+
+/// Smooth the direction output outside the deadband, the shortest way round
+struct FilterDirection {
+  static constexpr const char* kName = "FilterDirection";
+
+  static inline bool run(WindSample& s) {
+    WindContext& c = wind_context;
+    int delta = (int)s.direction - c.dir_out;
+    if (delta < -180) {
+      delta += 360;
+    } else if (delta > 180) {
+      delta -= 360;
+    }
+    if (abs(delta) > c.filter.dir_deadband) {
+      c.dir_out =
+          (c.dir_out + q16_round((int64_t)delta * c.filter.dir_gain)) % 360;
+      if (c.dir_out < 0) c.dir_out += 360;
+    }
+    return true;
+  }
+};
+
+/**
+ * @brief The processing of one revolution.
+ *
+ * A stage returning false ends it, so a rejected speed holds the direction
+ * too. Stages can be added or reordered here per build.
+ */
+template <class Model>
+using WindPipeline =
+    Pipeline<CheckTimeout, CalibrateSpeed<Model>, ValidateSpeed<Model>,
+             FilterSpeed, MeasurePhase<Model>, CorrectDirection,
+             ValidateDirection<Model>, FilterDirection>;
+
+#endif  // WIND_STAGES_H_
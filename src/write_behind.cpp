@@ -0,0 +1,24 @@
+#include "write_behind.h"
+
+void WriteBehind::mark(unsigned long now) {
+  if (!marked_) first_mark_ = now;
+  last_mark_ = now;
+  marked_ = true;
+}
+
+bool WriteBehind::is_due(unsigned long now, bool dirty) const {
+  if (marked_) {
+    return (now - last_mark_ >= quiet_ms_) || (now - first_mark_ >= max_ms_);
+  }
+  return dirty && (now - last_write_ >= retry_ms_);
+}
+
+void WriteBehind::written(bool ok, unsigned long now) {
+  last_write_ = now;
+  if (ok) {
+    retry_ms_ = quiet_ms_;
+  } else if (failed_) {
+    retry_ms_ = (retry_ms_ < max_retry_ms_ / 2) ? retry_ms_ * 2 : max_retry_ms_;
+  }
+  failed_ = !ok;
+}
@@ -0,0 +1,61 @@
+#ifndef WRITE_BEHIND_H_
+#define WRITE_BEHIND_H_
+
+/**
+ * @brief When to write changes behind, coalesced, with a retry backoff.
+ *
+ * Changes are marked as they happen. A write is due once no change was marked
+ * for quiet_ms, or max_ms after the first mark, so a burst of changes costs
+ * one write. A write that failed leaves the data dirty without any mark; it is
+ * retried quiet_ms later, then after twice as long each time up to
+ * max_retry_ms, so a worn or full flash is not hammered from the main loop.
+ * A new mark still follows the coalescing window.
+ *
+ * Holds no lock, the owner serializes the calls.
+ */
+class WriteBehind {
+ public:
+  /**
+   * @param quiet_ms Due once nothing was marked for this long
+   * @param max_ms Due at the latest this long after the first mark
+   * @param max_retry_ms Longest wait between the retries of a failed write
+   */
+  WriteBehind(unsigned long quiet_ms, unsigned long max_ms,
+              unsigned long max_retry_ms)
+      : quiet_ms_(quiet_ms),
+        max_ms_(max_ms),
+        max_retry_ms_(max_retry_ms),
+        retry_ms_(quiet_ms) {}
+
+  /// A change to be written
+  void mark(unsigned long now);
+
+  /// A write is due, given whether unwritten data is left
+  bool is_due(unsigned long now, bool dirty) const;
+
+  /// The marks are taken into a write, call before writing
+  void take() { marked_ = false; }
+
+  /// The outcome of the write, which sets the next retry
+  void written(bool ok, unsigned long now);
+
+  bool is_marked() const { return marked_; }
+
+  bool has_failed() const { return failed_; }
+
+  /// Wait before the next retry of a failed write
+  unsigned long get_retry_ms() const { return retry_ms_; }
+
+ protected:
+  unsigned long quiet_ms_;
+  unsigned long max_ms_;
+  unsigned long max_retry_ms_;
+  unsigned long retry_ms_;
+  bool marked_ = false;
+  bool failed_ = false;
+  unsigned long first_mark_ = 0;
+  unsigned long last_mark_ = 0;
+  unsigned long last_write_ = 0;
+};
+
+#endif  // WRITE_BEHIND_H_
@@ -0,0 +1,54 @@
+#ifndef MOCK_ARDUINO_H_
+#define MOCK_ARDUINO_H_
+
+// Just enough of the Arduino core for the native tests of the modules
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define IRAM_ATTR
+
+// Time as set by the test
+inline unsigned long mock_micros = 0;
+
+inline unsigned long micros() { return mock_micros; }
+inline unsigned long millis() { return mock_micros / 1000; }
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+inline void delayMicroseconds(uint32_t us) { mock_micros += us; }
+
+// Cycle counter and core as set by the test, the CPU at 240 MHz
+inline uint32_t mock_cycles = 0;
+inline int mock_core = 1;
+
+struct MockEsp {
+  uint32_t getCycleCount() { return mock_cycles; }
+};
+inline MockEsp ESP;
+
+inline uint32_t getCpuFrequencyMhz() { return 240; }
+inline int xPortGetCoreID() { return mock_core; }
+
+// The byte sink of the Arduino streams, for a port written by a module
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while ((n < size) && (write(buffer[n]) == 1)) n++;
+    return n;
+  }
+  virtual int availableForWrite() { return 0; }
+};
+
+// ADC1 channels of the ESP32 pins, -1 for the pins without
+inline int8_t digitalPinToAnalogChannel(uint8_t pin) {
+  static const int8_t kAdc1[8] = {4, 5, 6, 7, 0, 1, 2, 3};  // GPIO 32 to 39
+  return ((pin >= 32) && (pin <= 39)) ? kAdc1[pin - 32] : -1;
+}
+
+#endif  // MOCK_ARDUINO_H_
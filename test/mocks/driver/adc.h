@@ -0,0 +1,135 @@
+#ifndef MOCK_DRIVER_ADC_H_
+#define MOCK_DRIVER_ADC_H_
+
+// Simulated ESP32 ADC continuous mode for the native tests. Readings are
+// queued with mock_adc_feed() and returned by adc_digi_read_bytes() in
+// conversion frames, as the DMA would deliver them. SOC_ADC_DIGI_MAX_BITWIDTH
+// is left undefined, like on cores whose soc caps lack it.
+
+#include <stdint.h>
+#include <string.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL (-1)
+#define ESP_ERR_TIMEOUT 0x107
+
+typedef enum { ADC_ATTEN_DB_0, ADC_ATTEN_DB_2_5, ADC_ATTEN_DB_6, ADC_ATTEN_DB_11 } adc_atten_t;
+typedef enum {
+  ADC_CONV_SINGLE_UNIT_1 = 1,
+  ADC_CONV_SINGLE_UNIT_2 = 2,
+  ADC_CONV_BOTH_UNIT = 3,
+  ADC_CONV_ALTER_UNIT = 7
+} adc_digi_convert_mode_t;
+typedef enum { ADC_DIGI_OUTPUT_FORMAT_TYPE1, ADC_DIGI_OUTPUT_FORMAT_TYPE2 } adc_digi_output_format_t;
+
+typedef struct {
+  uint32_t max_store_buf_size;
+  uint32_t conv_num_each_intr;
+  uint32_t adc1_chan_mask;
+  uint32_t adc2_chan_mask;
+} adc_digi_init_config_t;
+
+typedef struct {
+  uint8_t atten;
+  uint8_t channel;
+  uint8_t unit;
+  uint8_t bit_width;
+} adc_digi_pattern_config_t;
+
+typedef struct {
+  bool conv_limit_en;
+  uint32_t conv_limit_num;
+  uint32_t pattern_num;
+  adc_digi_pattern_config_t* adc_pattern;
+  uint32_t sample_freq_hz;
+  adc_digi_convert_mode_t conv_mode;
+  adc_digi_output_format_t format;
+} adc_digi_configuration_t;
+
+typedef struct {
+  union {
+    struct {
+      uint16_t data : 12;
+      uint16_t channel : 4;
+    } type1;
+    uint16_t val;
+  };
+} adc_digi_output_data_t;
+
+struct MockAdc {
+  bool initialized;
+  bool configured;
+  bool running;
+  adc_digi_init_config_t init;
+  adc_digi_pattern_config_t pattern;
+  adc_digi_configuration_t config;
+  uint16_t fifo[4096];
+  uint32_t head;
+  uint32_t tail;
+};
+
+inline MockAdc mock_adc = {};
+
+inline void mock_adc_reset() { mock_adc = {}; }
+
+/// Queue readings of the configured channel, dropped if it is not running
+inline void mock_adc_feed(const uint16_t* raw, int count) {
+  if (!mock_adc.running) return;
+  for (int i = 0; (i < count) && (mock_adc.tail < 4096); i++) {
+    mock_adc.fifo[mock_adc.tail++] = raw[i];
+  }
+}
+
+inline esp_err_t adc_digi_initialize(const adc_digi_init_config_t* init) {
+  if ((init->adc1_chan_mask == 0) || (init->conv_num_each_intr == 0)) {
+    return ESP_FAIL;
+  }
+  mock_adc.init = *init;
+  mock_adc.initialized = true;
+  return ESP_OK;
+}
+
+inline esp_err_t adc_digi_controller_configure(
+    const adc_digi_configuration_t* config) {
+  if (!mock_adc.initialized || (config->pattern_num != 1) ||
+      (config->sample_freq_hz < 20000)) {
+    return ESP_FAIL;
+  }
+  mock_adc.config = *config;
+  mock_adc.pattern = config->adc_pattern[0];
+  mock_adc.configured = true;
+  return ESP_OK;
+}
+
+inline esp_err_t adc_digi_start() {
+  if (!mock_adc.configured) return ESP_FAIL;
+  mock_adc.running = true;
+  return ESP_OK;
+}
+
+inline esp_err_t adc_digi_stop() {
+  mock_adc.running = false;
+  return ESP_OK;
+}
+
+/// Whole frames of what is queued, ESP_ERR_TIMEOUT if nothing is
+inline esp_err_t adc_digi_read_bytes(uint8_t* buf, uint32_t length_max,
+                                     uint32_t* out_length, uint32_t timeout) {
+  uint32_t count = mock_adc.tail - mock_adc.head;
+  uint32_t room = length_max / sizeof(adc_digi_output_data_t);
+  if (count > room) count = room;
+  *out_length = 0;
+  if (count == 0) return ESP_ERR_TIMEOUT;
+
+  adc_digi_output_data_t* data = (adc_digi_output_data_t*)buf;
+  for (uint32_t i = 0; i < count; i++) {
+    data[i].val = 0;
+    data[i].type1.data = mock_adc.fifo[mock_adc.head++];
+    data[i].type1.channel = mock_adc.pattern.channel;
+  }
+  *out_length = count * sizeof(adc_digi_output_data_t);
+  return ESP_OK;
+}
+
+#endif  // MOCK_DRIVER_ADC_H_
@@ -0,0 +1,156 @@
+#ifndef MOCK_DRIVER_PCNT_H_
+#define MOCK_DRIVER_PCNT_H_
+
+// Simulated ESP32 pulse counter units for the native tests. Edges are fed
+// with mock_pcnt_edge(), which counts them as configured, restarts the
+// counter at the high limit and calls the ISR of the enabled events.
+
+#include <stdint.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define PCNT_PIN_NOT_USED (-1)
+
+typedef enum { PCNT_UNIT_0, PCNT_UNIT_1, PCNT_UNIT_2, PCNT_UNIT_3, PCNT_UNIT_MAX } pcnt_unit_t;
+typedef enum { PCNT_CHANNEL_0, PCNT_CHANNEL_1 } pcnt_channel_t;
+typedef enum { PCNT_COUNT_DIS, PCNT_COUNT_INC, PCNT_COUNT_DEC } pcnt_count_mode_t;
+typedef enum { PCNT_MODE_KEEP, PCNT_MODE_REVERSE, PCNT_MODE_DISABLE } pcnt_ctrl_mode_t;
+typedef enum {
+  PCNT_EVT_THRES_1 = 1 << 2,
+  PCNT_EVT_THRES_0 = 1 << 3,
+  PCNT_EVT_L_LIM = 1 << 4,
+  PCNT_EVT_H_LIM = 1 << 5,
+  PCNT_EVT_ZERO = 1 << 6
+} pcnt_evt_type_t;
+
+typedef struct {
+  int pulse_gpio_num;
+  int ctrl_gpio_num;
+  pcnt_ctrl_mode_t lctrl_mode;
+  pcnt_ctrl_mode_t hctrl_mode;
+  pcnt_count_mode_t pos_mode;
+  pcnt_count_mode_t neg_mode;
+  int16_t counter_h_lim;
+  int16_t counter_l_lim;
+  pcnt_unit_t unit;
+  pcnt_channel_t channel;
+} pcnt_config_t;
+
+struct MockPcntUnit {
+  pcnt_config_t config;
+  int16_t count;
+  bool running;
+  bool filter;
+  uint16_t filter_value;
+  uint32_t events;
+  int16_t threshold;
+  uint32_t status;
+  void (*isr)(void*);
+  void* isr_arg;
+};
+
+inline MockPcntUnit mock_pcnt_units[PCNT_UNIT_MAX];
+
+inline void mock_pcnt_reset() {
+  for (int i = 0; i < PCNT_UNIT_MAX; i++) mock_pcnt_units[i] = MockPcntUnit();
+}
+
+inline esp_err_t pcnt_unit_config(const pcnt_config_t* config) {
+  mock_pcnt_units[config->unit].config = *config;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_set_mode(pcnt_unit_t unit, pcnt_channel_t channel,
+                               pcnt_count_mode_t pos_mode,
+                               pcnt_count_mode_t neg_mode,
+                               pcnt_ctrl_mode_t hctrl_mode,
+                               pcnt_ctrl_mode_t lctrl_mode) {
+  mock_pcnt_units[unit].config.pos_mode = pos_mode;
+  mock_pcnt_units[unit].config.neg_mode = neg_mode;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_set_filter_value(pcnt_unit_t unit, uint16_t value) {
+  mock_pcnt_units[unit].filter_value = value;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_filter_enable(pcnt_unit_t unit) {
+  mock_pcnt_units[unit].filter = true;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_counter_pause(pcnt_unit_t unit) {
+  mock_pcnt_units[unit].running = false;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_counter_resume(pcnt_unit_t unit) {
+  mock_pcnt_units[unit].running = true;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_counter_clear(pcnt_unit_t unit) {
+  mock_pcnt_units[unit].count = 0;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_get_counter_value(pcnt_unit_t unit, int16_t* count) {
+  *count = mock_pcnt_units[unit].count;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_event_enable(pcnt_unit_t unit, pcnt_evt_type_t event) {
+  mock_pcnt_units[unit].events |= event;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_event_disable(pcnt_unit_t unit, pcnt_evt_type_t event) {
+  mock_pcnt_units[unit].events &= ~(uint32_t)event;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_set_event_value(pcnt_unit_t unit, pcnt_evt_type_t event,
+                                      int16_t value) {
+  if (event == PCNT_EVT_THRES_0) mock_pcnt_units[unit].threshold = value;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_isr_service_install(int flags) { return ESP_OK; }
+
+inline esp_err_t pcnt_isr_handler_add(pcnt_unit_t unit, void (*isr)(void*),
+                                      void* arg) {
+  mock_pcnt_units[unit].isr = isr;
+  mock_pcnt_units[unit].isr_arg = arg;
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_get_event_status(pcnt_unit_t unit, uint32_t* status) {
+  *status = mock_pcnt_units[unit].status;
+  return ESP_OK;
+}
+
+/// An edge on the input of the unit
+inline void mock_pcnt_edge(pcnt_unit_t unit, bool rising) {
+  MockPcntUnit& u = mock_pcnt_units[unit];
+  pcnt_count_mode_t mode = rising ? u.config.pos_mode : u.config.neg_mode;
+  if (!u.running || (mode != PCNT_COUNT_INC)) return;
+
+  u.count++;
+  u.status = 0;
+  if (u.count == u.config.counter_h_lim) {
+    u.count = 0;
+    if (u.events & PCNT_EVT_H_LIM) u.status |= PCNT_EVT_H_LIM;
+  } else if ((u.count == u.threshold) && (u.events & PCNT_EVT_THRES_0)) {
+    u.status |= PCNT_EVT_THRES_0;
+  }
+  if ((u.status != 0) && (u.isr != nullptr)) u.isr(u.isr_arg);
+}
+
+/// A pulse of the given polarity, leading and trailing edge
+inline void mock_pcnt_pulse(pcnt_unit_t unit, bool active_high) {
+  mock_pcnt_edge(unit, active_high);
+  mock_pcnt_edge(unit, !active_high);
+}
+
+#endif  // MOCK_DRIVER_PCNT_H_
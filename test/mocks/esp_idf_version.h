@@ -0,0 +1,10 @@
+#ifndef MOCK_ESP_IDF_VERSION_H_
+#define MOCK_ESP_IDF_VERSION_H_
+
+// The IDF of arduino-esp32 2.0.x, which the native tests stand in for
+
+#define ESP_IDF_VERSION_VAL(major, minor, patch) \
+  (((major) << 16) | ((minor) << 8) | (patch))
+#define ESP_IDF_VERSION ESP_IDF_VERSION_VAL(4, 4, 0)
+
+#endif  // MOCK_ESP_IDF_VERSION_H_
@@ -0,0 +1,92 @@
+#include <unity.h>
+
+#include "analog_vane.h"
+#include "driver/adc.h"
+
+static const uint8_t kPin = 34;  // ADC1 channel 6
+
+// The raw reading of a vane position in degrees, with no dead zone
+static uint16_t raw_of(float degrees) {
+  return (uint16_t)(8 + degrees / 360.0f * (4087 - 8));
+}
+
+static float degrees_of(uint16_t phase) { return phase * 360.0f / 65536.0f; }
+
+static void feed(float degrees, int count) {
+  uint16_t raw[256];
+  for (int i = 0; i < count; i++) raw[i] = raw_of(degrees);
+  mock_adc_feed(raw, count);
+}
+
+void setUp() { mock_adc_reset(); }
+
+void tearDown() {}
+
+void test_begin_configures_adc1() {
+  AnalogVane vane(kPin, 0);
+  TEST_ASSERT_TRUE(vane.begin());
+  TEST_ASSERT_TRUE(mock_adc.running);
+  TEST_ASSERT_EQUAL_UINT32(1ul << 6, mock_adc.init.adc1_chan_mask);
+  TEST_ASSERT_EQUAL_UINT8(6, mock_adc.pattern.channel);
+  TEST_ASSERT_EQUAL_UINT8(12, mock_adc.pattern.bit_width);
+  TEST_ASSERT_EQUAL_UINT32(AnalogVane::kSampleRate,
+                           mock_adc.config.sample_freq_hz);
+}
+
+void test_begin_rejects_adc2_pin() {
+  AnalogVane vane(25, 0);
+  TEST_ASSERT_FALSE(vane.begin());
+  TEST_ASSERT_FALSE(mock_adc.running);
+}
+
+void test_update_decodes_buffered_samples() {
+  AnalogVane vane(kPin, 0);
+  vane.begin();
+  vane.update();
+  TEST_ASSERT_FALSE(vane.ready());
+
+  feed(90.0f, 200);
+  vane.update();
+  TEST_ASSERT_TRUE(vane.ready());
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 90.0f, degrees_of(vane.get_phase()));
+  TEST_ASSERT_EQUAL_UINT16(raw_of(90.0f), vane.get_raw());
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, vane.get_dead_share());
+}
+
+void test_batch_across_north() {
+  AnalogVane vane(kPin, 0);
+  vane.begin();
+  feed(355.0f, 100);
+  feed(5.0f, 100);
+  vane.update();
+  float direction = degrees_of(vane.get_phase());
+  if (direction > 180.0f) direction -= 360.0f;
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 0.0f, direction);
+}
+
+// Without a dead zone the middle of the dead zone is phase 0, which a live
+// reading at the start of the range gives too
+void test_live_sample_at_dead_phase_not_dead() {
+  AnalogVane vane(kPin, 0);
+  uint16_t raw[4] = {8, 8, 9, 8};
+  vane.add_batch(raw, 4);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, vane.get_dead_share());
+}
+
+void test_rail_samples_dead() {
+  AnalogVane vane(kPin, 20);
+  uint16_t raw[4] = {0, 4095, 2000, 2000};
+  vane.add_batch(raw, 4);
+  TEST_ASSERT_EQUAL_FLOAT(0.5f, vane.get_dead_share());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_begin_configures_adc1);
+  RUN_TEST(test_begin_rejects_adc2_pin);
+  RUN_TEST(test_update_decodes_buffered_samples);
+  RUN_TEST(test_batch_across_north);
+  RUN_TEST(test_live_sample_at_dead_phase_not_dead);
+  RUN_TEST(test_rail_samples_dead);
+  return UNITY_END();
+}
@@ -0,0 +1,149 @@
+#include <unity.h>
+
+#include "debug_stream.h"
+
+static const DebugFrame kFrame = {
+    0x12345678,              // speed_pulse
+    250000,                  // speed_time
+    62500,                   // direction_time
+    0x4000,                  // phase, a quarter turn
+    1234,                    // cmps
+    270,                     // direction
+    1230,                    // speed_out
+    269,                     // dir_out
+    7,                       // stages
+    kPassed | kAnalogVaneFlag  // flags
+};
+
+// kFrame as the chart page in src/web/debug_plot.html decodes it
+static const uint8_t kFrameBytes[] = {
+    0x78, 0x56, 0x34, 0x12,  // speed_pulse
+    0x90, 0xd0, 0x03, 0x00,  // speed_time
+    0x24, 0xf4, 0x00, 0x00,  // direction_time
+    0x00, 0x40,              // phase
+    0xd2, 0x04,              // cmps
+    0x0e, 0x01,              // direction
+    0xce, 0x04,              // speed_out
+    0x0d, 0x01,              // dir_out
+    0x07,                    // stages
+    0x0c                     // flags
+};
+
+static void assert_frame_bytes(const uint8_t* bytes) {
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(kFrameBytes, bytes, sizeof(kFrameBytes));
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_frame_layout() {
+  TEST_ASSERT_EQUAL(24, sizeof(DebugFrame));
+  TEST_ASSERT_EQUAL(sizeof(kFrameBytes), sizeof(DebugFrame));
+}
+
+void test_empty_message() {
+  DebugStream stream;
+  TEST_ASSERT_TRUE(stream.empty());
+  uint8_t buffer[DebugStream::kMaxMessageSize];
+  const uint8_t golden[] = {DebugStream::kVersion, 0, 0, 0};
+  TEST_ASSERT_EQUAL(sizeof(golden), stream.serialize(buffer));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(golden, buffer, sizeof(golden));
+}
+
+void test_message_golden() {
+  DebugStream stream;
+  DebugFrame second = kFrame;
+  second.speed_time = 0;  // Stalled
+  second.flags = kIgnoreNext | kStorm;
+  stream.add(kFrame);
+  stream.add(second);
+  TEST_ASSERT_FALSE(stream.empty());
+  TEST_ASSERT_EQUAL(4 + 2 * 24, stream.message_size());
+
+  uint8_t buffer[DebugStream::kMaxMessageSize];
+  TEST_ASSERT_EQUAL(4 + 2 * 24, stream.serialize(buffer));
+  const uint8_t header[] = {1, 2, 0, 0};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(header, buffer, sizeof(header));
+  assert_frame_bytes(buffer + 4);
+
+  uint8_t golden[sizeof(kFrameBytes)];
+  for (size_t i = 0; i < sizeof(golden); i++) golden[i] = kFrameBytes[i];
+  golden[4] = golden[5] = golden[6] = golden[7] = 0;
+  golden[23] = 0x03;
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(golden, buffer + 28, sizeof(golden));
+
+  // Serializing starts the next message
+  TEST_ASSERT_TRUE(stream.empty());
+  TEST_ASSERT_EQUAL(4, stream.message_size());
+}
+
+// Frames beyond kMaxFrames are only counted, in the header of the message
+// and in the total
+void test_dropped_in_header() {
+  DebugStream stream;
+  for (int i = 0; i < DebugStream::kMaxFrames + 300; i++) stream.add(kFrame);
+  uint8_t buffer[DebugStream::kMaxMessageSize];
+  TEST_ASSERT_EQUAL(DebugStream::kMaxMessageSize, stream.serialize(buffer));
+  const uint8_t header[] = {1, DebugStream::kMaxFrames, 0x2c, 0x01};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(header, buffer, sizeof(header));
+  assert_frame_bytes(buffer + 4 + (DebugStream::kMaxFrames - 1) * 24);
+  TEST_ASSERT_EQUAL_UINT32(300, stream.get_dropped_total());
+
+  // The next message counts from zero again
+  stream.add(kFrame);
+  stream.serialize(buffer);
+  const uint8_t next[] = {1, 1, 0, 0};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(next, buffer, sizeof(next));
+}
+
+// Frames of a message the clients could not take are dropped, and the
+// message after reports them
+void test_drop_pending() {
+  DebugStream stream;
+  for (int i = 0; i < 5; i++) stream.add(kFrame);
+  stream.drop_pending();
+  TEST_ASSERT_FALSE(stream.empty());
+  stream.add(kFrame);
+
+  uint8_t buffer[DebugStream::kMaxMessageSize];
+  TEST_ASSERT_EQUAL(4 + 24, stream.serialize(buffer));
+  const uint8_t header[] = {1, 1, 5, 0};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(header, buffer, sizeof(header));
+  assert_frame_bytes(buffer + 4);
+  TEST_ASSERT_EQUAL_UINT32(5, stream.get_dropped_total());
+}
+
+void test_dropped_count_saturates() {
+  DebugStream stream;
+  for (uint32_t i = 0; i < DebugStream::kMaxFrames + 70000u; i++) {
+    stream.add(kFrame);
+  }
+  stream.drop_pending();
+  uint8_t buffer[DebugStream::kMaxMessageSize];
+  stream.serialize(buffer);
+  const uint8_t header[] = {1, 0, 0xff, 0xff};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(header, buffer, sizeof(header));
+  TEST_ASSERT_EQUAL_UINT32(DebugStream::kMaxFrames + 70000u,
+                           stream.get_dropped_total());
+}
+
+void test_clear_forgets_pending() {
+  DebugStream stream;
+  for (int i = 0; i < DebugStream::kMaxFrames + 1; i++) stream.add(kFrame);
+  stream.clear();
+  TEST_ASSERT_TRUE(stream.empty());
+  TEST_ASSERT_EQUAL_UINT32(1, stream.get_dropped_total());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_frame_layout);
+  RUN_TEST(test_empty_message);
+  RUN_TEST(test_message_golden);
+  RUN_TEST(test_dropped_in_header);
+  RUN_TEST(test_drop_pending);
+  RUN_TEST(test_dropped_count_saturates);
+  RUN_TEST(test_clear_forgets_pending);
+  return UNITY_END();
+}
@@ -0,0 +1,112 @@
+#include <unity.h>
+
+#include <string>
+
+#include "debug_telemetry.h"
+
+// A port taking at most room bytes per pump, like a UART transmit FIFO
+class MockPort : public Print {
+ public:
+  size_t write(uint8_t c) override {
+    if (room == 0) return 0;
+    room--;
+    out.push_back((char)c);
+    return 1;
+  }
+  int availableForWrite() override { return room; }
+
+  int room = 1 << 20;
+  std::string out;
+};
+
+static MockPort port;
+
+void setUp() { port = MockPort(); }
+
+void tearDown() {}
+
+void test_text_record() {
+  DebugTelemetry telemetry(&port);
+  telemetry.begin_record();
+  telemetry.add("dir", (int32_t)-42);
+  telemetry.add("spd", 5.126f, 2);
+  telemetry.add("gain", 0.05f, 3);
+  telemetry.end_record();
+  telemetry.pump();
+  TEST_ASSERT_EQUAL_STRING("dir: -42,spd: 5.13,gain: 0.050\n",
+                           port.out.c_str());
+}
+
+void test_binary_frame() {
+  DebugTelemetry telemetry(&port);
+  telemetry.set_binary(true);
+  telemetry.begin_record();
+  telemetry.add("dir", (int32_t)-2);
+  telemetry.add("spd", 5.12f, 2);
+  telemetry.end_record();
+  telemetry.pump();
+
+  // Sync, count, -2 and 512 as little-endian int32
+  const uint8_t expected[] = {0xA5, 0x5A, 2,    0xFE, 0xFF, 0xFF,
+                              0xFF, 0x00, 0x02, 0x00, 0x00};
+  TEST_ASSERT_EQUAL(sizeof(expected) + 1, port.out.size());
+  uint8_t sum = 0;
+  for (size_t i = 0; i < sizeof(expected); i++) {
+    TEST_ASSERT_EQUAL_UINT8(expected[i], (uint8_t)port.out[i]);
+    if (i >= 2) sum += expected[i];
+  }
+  TEST_ASSERT_EQUAL_UINT8(sum, (uint8_t)port.out[sizeof(expected)]);
+}
+
+void test_pump_takes_only_room() {
+  DebugTelemetry telemetry(&port);
+  telemetry.begin_record();
+  telemetry.add("value", (int32_t)123456);
+  telemetry.end_record();
+  port.room = 5;
+  telemetry.pump();
+  TEST_ASSERT_EQUAL_STRING("value", port.out.c_str());
+  port.room = 100;
+  telemetry.pump();
+  TEST_ASSERT_EQUAL_STRING("value: 123456\n", port.out.c_str());
+}
+
+// A full queue drops whole records, what is sent stays whole lines
+void test_full_queue_drops_records() {
+  DebugTelemetry telemetry(&port);
+  port.room = 0;
+  int records = 0;
+  while (telemetry.get_dropped() == 0) {
+    telemetry.begin_record();
+    telemetry.add("record", (int32_t)records++);
+    telemetry.end_record();
+  }
+  TEST_ASSERT_EQUAL_UINT32(records - 1, telemetry.get_queued());
+
+  port.room = 1 << 20;
+  telemetry.pump();
+  size_t lines = 0;
+  for (char c : port.out) lines += (c == '\n');
+  TEST_ASSERT_EQUAL(records - 1, lines);
+  TEST_ASSERT_EQUAL('\n', port.out.back());
+}
+
+void test_overlong_record_dropped() {
+  DebugTelemetry telemetry(&port);
+  telemetry.begin_record();
+  for (int i = 0; i < 40; i++) telemetry.add("a_long_field_name", (int32_t)i);
+  telemetry.end_record();
+  telemetry.pump();
+  TEST_ASSERT_EQUAL_UINT32(1, telemetry.get_dropped());
+  TEST_ASSERT_EQUAL(0, port.out.size());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_text_record);
+  RUN_TEST(test_binary_frame);
+  RUN_TEST(test_pump_takes_only_room);
+  RUN_TEST(test_full_queue_drops_records);
+  RUN_TEST(test_overlong_record_dropped);
+  return UNITY_END();
+}
@@ -0,0 +1,107 @@
+#include <unity.h>
+
+#include <chrono>
+#include <stdio.h>
+
+#include "direction_table.h"
+
+// Phase of a sensor angle in degrees, 65536 per turn, rounded up so that
+// it converts back to the same degree
+static uint16_t phase_of(long degrees) {
+  return (uint16_t)((degrees * 65536 + 359) / 360);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_direction_without_offset() {
+  TEST_ASSERT_EQUAL(0, phase_to_direction(phase_of(0), 0));
+  TEST_ASSERT_EQUAL(270, phase_to_direction(phase_of(90), 0));
+  TEST_ASSERT_EQUAL(1, phase_to_direction(phase_of(359), 0));
+}
+
+void test_direction_phase_above_offset() {
+  TEST_ASSERT_EQUAL(0, phase_to_direction(phase_of(40), 40));
+  TEST_ASSERT_EQUAL(350, phase_to_direction(phase_of(50), 40));
+}
+
+void test_direction_phase_below_offset() {
+  // Used to give 360 - (-30) = 390
+  TEST_ASSERT_EQUAL(30, phase_to_direction(phase_of(10), 40));
+  TEST_ASSERT_EQUAL(359, phase_to_direction(phase_of(0), 359));
+}
+
+void test_direction_negative_offset() {
+  TEST_ASSERT_EQUAL(340, phase_to_direction(phase_of(0), -20));
+}
+
+void test_direction_always_in_range() {
+  for (int offset = -359; offset < 360; offset += 7) {
+    for (uint32_t phase = 0; phase < 65536; phase += 97) {
+      long direction = phase_to_direction(phase, offset);
+      TEST_ASSERT_TRUE((direction >= 0) && (direction < 360));
+    }
+  }
+}
+
+void test_table_interpolates_and_wraps() {
+  DirectionTable table;
+  table.set(0, 100);
+  table.set(35, 300);
+  TEST_ASSERT_EQUAL(100, table.correct(0));
+  // Halfway between the last point and the first one
+  TEST_ASSERT_INT_WITHIN(1, 65536 - 910 + 200, table.correct(65536 - 910));
+}
+
+void test_table_fit_reproduces_pairs() {
+  DirectionTable table;
+  uint16_t measured[] = {phase_of(10), phase_of(130), phase_of(250)};
+  uint16_t reference[] = {phase_of(12), phase_of(128), phase_of(250)};
+  TEST_ASSERT_TRUE(table.fit(measured, reference, 3));
+  for (int i = 0; i < 3; i++) {
+    TEST_ASSERT_INT_WITHIN(40, reference[i], table.correct(measured[i]));
+  }
+}
+
+// The cost of the direction calculation with and without the linearization
+// table, on the host; the firmware used to print this at every boot
+void test_benchmark_lookup() {
+  const int n = 1000000;
+  volatile unsigned long sink = 0;
+  unsigned long speed_time = 87654;
+  DirectionTable table;
+  table.set(3, 120);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < n; i++) sink = sink + ((12345ul + i) * 360) / speed_time;
+  auto plain = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < n; i++) {
+    uint16_t phase = table.correct(
+        (uint16_t)((((uint64_t)(12345ul + i)) << 16) / speed_time));
+    sink = sink + phase_to_direction(phase, 0);
+  }
+  auto lookup = std::chrono::steady_clock::now() - start;
+
+  char message[96];
+  snprintf(message, sizeof(message),
+           "Direction calculation: %.1f ns plain, %.1f ns with the table",
+           std::chrono::duration<double, std::nano>(plain).count() / n,
+           std::chrono::duration<double, std::nano>(lookup).count() / n);
+  TEST_MESSAGE(message);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_direction_without_offset);
+  RUN_TEST(test_direction_phase_above_offset);
+  RUN_TEST(test_direction_phase_below_offset);
+  RUN_TEST(test_direction_negative_offset);
+  RUN_TEST(test_direction_always_in_range);
+  RUN_TEST(test_table_interpolates_and_wraps);
+  RUN_TEST(test_table_fit_reproduces_pairs);
+  RUN_TEST(test_benchmark_lookup);
+  return UNITY_END();
+}
@@ -0,0 +1,111 @@
+#include <unity.h>
+
+#include <math.h>
+
+#include "direction_calibrator.h"
+
+static const float kDegToRad = 0.0174533f;
+
+/**
+ * @brief Feed a motoring run to the calibrator.
+ *
+ * The boat motors at stw through the true wind (true_x, true_y), earth
+ * frame, and turns through the headings from first to last heading. The
+ * sensor reads the apparent wind angle offset degrees short and its speed
+ * divided by scale. Measured angles are wrapped into [0, 360).
+ */
+static void motor(DirectionCalibrator& calibrator, float offset, float scale,
+                  float true_x, float true_y, float stw, float first_heading,
+                  float last_heading, int samples) {
+  for (int i = 0; i < samples; i++) {
+    float heading =
+        first_heading + (last_heading - first_heading) * i / (samples - 1);
+    float ch = cosf(heading);
+    float sh = sinf(heading);
+    float ax = ch * true_x + sh * true_y + stw;
+    float ay = -sh * true_x + ch * true_y;
+    float direction = atan2f(ay, ax) / kDegToRad - offset;
+    direction = fmodf(direction + 720.0f, 360.0f);
+    float speed = sqrtf(ax * ax + ay * ay) / scale;
+    calibrator.add(direction, direction, speed, heading, stw);
+  }
+}
+
+// Difference of two angles in degrees, in [-180, 180)
+static float angle_diff(float a, float b) {
+  return fmodf(a - b + 540.0f, 360.0f) - 180.0f;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_too_few_samples() {
+  DirectionCalibrator calibrator;
+  DirectionCalibration result;
+  calibrator.start();
+  motor(calibrator, 5.0f, 1.0f, 0.0f, 0.0f, 3.0f, 0.0f, 6.0f, 99);
+  TEST_ASSERT_EQUAL_UINT32(99, calibrator.get_samples());
+  TEST_ASSERT_FALSE(calibrator.solve(&result));
+}
+
+void test_recovers_offset_and_scale() {
+  DirectionCalibrator calibrator;
+  DirectionCalibration result;
+  calibrator.start();
+  motor(calibrator, 7.0f, 1.1f, 0.4f, -0.3f, 3.0f, 0.0f, 2 * M_PI, 720);
+  TEST_ASSERT_TRUE(calibrator.solve(&result));
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, 7.0f, result.offset);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.1f, result.speed_scale);
+  TEST_ASSERT_FLOAT_WITHIN(0.02f, 0.5f, result.true_wind);
+}
+
+// A negative offset makes the readings ahead wrap from 0 to 359
+void test_negative_offset_across_north() {
+  DirectionCalibrator calibrator;
+  DirectionCalibration result;
+  calibrator.start();
+  motor(calibrator, -4.0f, 1.0f, 0.0f, 0.0f, 2.5f, 0.0f, 0.0f, 200);
+  TEST_ASSERT_TRUE(calibrator.solve(&result));
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, -4.0f, result.offset);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.0f, result.speed_scale);
+  TEST_ASSERT_FLOAT_WITHIN(0.02f, 0.0f, result.true_wind);
+}
+
+// A sensor mounted backwards, the offset wraps around 180
+void test_offset_wraps_around() {
+  const float offsets[] = {179.5f, -179.5f};
+  for (float offset : offsets) {
+    DirectionCalibrator calibrator;
+    DirectionCalibration result;
+    calibrator.start();
+    motor(calibrator, offset, 0.9f, -0.2f, 0.3f, 4.0f, -1.0f, 3.0f, 400);
+    TEST_ASSERT_TRUE(calibrator.solve(&result));
+    TEST_ASSERT_TRUE(result.offset >= -180.0f && result.offset <= 180.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 0.0f, angle_diff(result.offset, offset));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.9f, result.speed_scale);
+  }
+}
+
+// start() forgets an earlier run
+void test_start_clears_samples() {
+  DirectionCalibrator calibrator;
+  DirectionCalibration result;
+  calibrator.start();
+  motor(calibrator, 30.0f, 1.0f, 0.0f, 0.0f, 3.0f, 0.0f, 2 * M_PI, 200);
+  calibrator.start();
+  TEST_ASSERT_EQUAL_UINT32(0, calibrator.get_samples());
+  motor(calibrator, -2.0f, 1.0f, 0.0f, 0.0f, 3.0f, 0.0f, 2 * M_PI, 200);
+  TEST_ASSERT_TRUE(calibrator.solve(&result));
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, -2.0f, result.offset);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_too_few_samples);
+  RUN_TEST(test_recovers_offset_and_scale);
+  RUN_TEST(test_negative_offset_across_north);
+  RUN_TEST(test_offset_wraps_around);
+  RUN_TEST(test_start_clears_samples);
+  return UNITY_END();
+}
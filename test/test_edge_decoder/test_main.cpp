@@ -0,0 +1,225 @@
+#include <unity.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "edge_decoder.h"
+
+// Samples of an input, bit 0 the earliest: low from `from` to `to` - 1
+static uint32_t low_run(int from, int to) {
+  uint32_t word = 0xffffffff;
+  for (int i = from; i < to; i++) word &= ~(1u << i);
+  return word;
+}
+
+/**
+ * The decoding sample by sample: the level changes once the input has been
+ * at the other level for debounce samples.
+ */
+class ReferenceDecoder {
+ public:
+  ReferenceDecoder(int debounce, bool active_high)
+      : debounce_(debounce), active_high_(active_high), level_(!active_high) {}
+
+  void decode(const std::vector<uint32_t>& words,
+              std::vector<uint32_t>* edges) {
+    for (size_t w = 0; w < words.size(); w++) {
+      for (int b = 0; b < 32; b++) {
+        bool sample = (words[w] >> b) & 1;
+        if (sample == level_) {
+          run_ = 0;
+        } else if (++run_ >= debounce_) {
+          level_ = sample;
+          run_ = 0;
+          uint32_t i = w * 32 + b;
+          if (level_ == active_high_) edges->push_back(i - (debounce_ - 1));
+        }
+      }
+    }
+  }
+
+ protected:
+  int debounce_;
+  bool active_high_;
+  bool level_;
+  int run_ = 0;
+};
+
+/**
+ * Active low pulses of random length with bounces at both edges, sampled into
+ * words. Lengths are in samples.
+ */
+static std::vector<uint32_t> bouncy_pulses(int words, int min_length,
+                                           int max_length, int bounce) {
+  std::vector<uint32_t> out(words, 0xffffffff);
+  int total = words * 32;
+  int i = 0;
+  bool low = false;
+  while (i < total) {
+    int length = min_length + rand() % (max_length - min_length + 1);
+    for (int j = 0; (j < length) && (i + j < total); j++) {
+      bool sample = !low;
+      // Bounces right after the edge flip the level for single samples
+      if ((j < bounce) && (rand() % 2)) sample = !sample;
+      if (!sample) out[(i + j) / 32] &= ~(1u << ((i + j) % 32));
+    }
+    i += length;
+    low = !low;
+  }
+  return out;
+}
+
+static std::vector<uint32_t> decode_all(EdgeDecoder& decoder,
+                                        const std::vector<uint32_t>& words) {
+  std::vector<uint32_t> edges;
+  uint32_t buffer[32];
+  for (size_t w = 0; w < words.size(); w++) {
+    int n = decoder.decode(words[w], w * 32, buffer, 32);
+    edges.insert(edges.end(), buffer, buffer + n);
+  }
+  return edges;
+}
+
+void setUp() { srand(1); }
+
+void tearDown() {}
+
+void test_active_low_falling_edge() {
+  EdgeDecoder decoder(4);
+  uint32_t edges[4];
+  TEST_ASSERT_EQUAL(1, decoder.decode(low_run(10, 20), 0, edges, 4));
+  TEST_ASSERT_EQUAL(10, edges[0]);
+}
+
+void test_active_high_rising_edge() {
+  EdgeDecoder decoder(4, true);
+  uint32_t edges[4];
+  // The inverted word, a high pulse from 10 to 19 on a low idle input
+  TEST_ASSERT_EQUAL(1, decoder.decode(~low_run(10, 20), 0, edges, 4));
+  TEST_ASSERT_EQUAL(10, edges[0]);
+}
+
+void test_active_high_idles_low() {
+  EdgeDecoder decoder(4, true);
+  uint32_t edges[4];
+  TEST_ASSERT_FALSE(decoder.get_level());
+  // A low input is idle, not a pulse
+  TEST_ASSERT_EQUAL(0, decoder.decode(0, 0, edges, 4));
+}
+
+void test_set_active_high_switches_edges() {
+  EdgeDecoder decoder(4);
+  uint32_t edges[4];
+  decoder.set_active_high(true);
+  TEST_ASSERT_EQUAL(1, decoder.decode(~low_run(0, 8), 0, edges, 4));
+  TEST_ASSERT_EQUAL(0, edges[0]);
+  decoder.set_active_high(false);
+  TEST_ASSERT_EQUAL(1, decoder.decode(low_run(3, 30), 32, edges, 4));
+  TEST_ASSERT_EQUAL(35, edges[0]);
+}
+
+void test_bounce_shorter_than_debounce_ignored() {
+  EdgeDecoder decoder(4);
+  uint32_t edges[4];
+  // A glitch of 3 samples, then a pulse with a 1 sample bounce in it
+  uint32_t word = low_run(2, 5) & low_run(10, 15) & low_run(16, 26);
+  TEST_ASSERT_EQUAL(1, decoder.decode(word, 0, edges, 4));
+  TEST_ASSERT_EQUAL(10, edges[0]);
+  TEST_ASSERT_TRUE(decoder.get_level());
+}
+
+void test_run_across_words() {
+  EdgeDecoder decoder(8);
+  uint32_t edges[4];
+  TEST_ASSERT_EQUAL(0, decoder.decode(low_run(28, 32), 0, edges, 4));
+  TEST_ASSERT_EQUAL(1, decoder.decode(low_run(0, 10), 32, edges, 4));
+  TEST_ASSERT_EQUAL(28, edges[0]);
+}
+
+void test_gap_restarts_debounce() {
+  EdgeDecoder decoder(8);
+  uint32_t edges[4];
+  TEST_ASSERT_EQUAL(0, decoder.decode(low_run(28, 32), 0, edges, 4));
+  // A word was dropped, the 4 low samples before the gap do not count
+  TEST_ASSERT_EQUAL(1, decoder.decode(low_run(0, 10), 64, edges, 4));
+  TEST_ASSERT_EQUAL(64, edges[0]);
+}
+
+void test_max_edges() {
+  EdgeDecoder decoder(1);
+  uint32_t edges[2];
+  // 16 pulses of one sample
+  TEST_ASSERT_EQUAL(2, decoder.decode(0xaaaaaaaa, 0, edges, 2));
+  TEST_ASSERT_EQUAL(0, edges[0]);
+  TEST_ASSERT_EQUAL(2, edges[1]);
+  TEST_ASSERT_TRUE(decoder.get_level());
+}
+
+void test_matches_reference() {
+  const int debounces[] = {1, 3, 8, 17, 32};
+  for (int debounce : debounces) {
+    for (int polarity = 0; polarity < 2; polarity++) {
+      std::vector<uint32_t> words = bouncy_pulses(500, 20, 150, 10);
+      if (polarity) {
+        for (uint32_t& word : words) word = ~word;
+      }
+      EdgeDecoder decoder(debounce, polarity);
+      ReferenceDecoder reference(debounce, polarity);
+      std::vector<uint32_t> expected;
+      reference.decode(words, &expected);
+
+      std::vector<uint32_t> edges = decode_all(decoder, words);
+      TEST_ASSERT_TRUE(expected.size() > 10);
+      TEST_ASSERT_EQUAL(expected.size(), edges.size());
+      for (size_t i = 0; i < edges.size(); i++) {
+        TEST_ASSERT_EQUAL_UINT32(expected[i], edges[i]);
+      }
+    }
+  }
+}
+
+// Decoding speed on bouncy pulses, against walking every sample
+void test_benchmark_decode() {
+  const int words = 100000;
+  std::vector<uint32_t> samples = bouncy_pulses(words, 40, 400, 10);
+
+  auto start = std::chrono::steady_clock::now();
+  EdgeDecoder decoder(8);
+  size_t found = decode_all(decoder, samples).size();
+  auto parallel = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  ReferenceDecoder reference(8, false);
+  std::vector<uint32_t> expected;
+  reference.decode(samples, &expected);
+  auto serial = std::chrono::steady_clock::now() - start;
+
+  double parallel_us =
+      std::chrono::duration<double, std::micro>(parallel).count();
+  double serial_us = std::chrono::duration<double, std::micro>(serial).count();
+  char message[128];
+  snprintf(message, sizeof(message),
+           "Edge decoding: %.1f edges/us (%.0f samples/us) word-parallel, "
+           "%.1f edges/us sample by sample",
+           found / parallel_us, words * 32 / parallel_us,
+           expected.size() / serial_us);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_EQUAL(expected.size(), found);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_active_low_falling_edge);
+  RUN_TEST(test_active_high_rising_edge);
+  RUN_TEST(test_active_high_idles_low);
+  RUN_TEST(test_set_active_high_switches_edges);
+  RUN_TEST(test_bounce_shorter_than_debounce_ignored);
+  RUN_TEST(test_run_across_words);
+  RUN_TEST(test_gap_restarts_debounce);
+  RUN_TEST(test_max_edges);
+  RUN_TEST(test_matches_reference);
+  RUN_TEST(test_benchmark_decode);
+  return UNITY_END();
+}
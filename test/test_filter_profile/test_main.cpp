@@ -0,0 +1,50 @@
+#include <unity.h>
+
+#include "filter_profile.h"
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_q16_round_symmetric() {
+  for (int64_t value = 1; value < 10 * 65536; value += 4097) {
+    TEST_ASSERT_EQUAL_INT32(-q16_round(value), q16_round(-value));
+  }
+}
+
+void test_q16_round_halves_away_from_zero() {
+  TEST_ASSERT_EQUAL_INT32(1, q16_round(32768));
+  TEST_ASSERT_EQUAL_INT32(-1, q16_round(-32768));
+  TEST_ASSERT_EQUAL_INT32(0, q16_round(32767));
+  TEST_ASSERT_EQUAL_INT32(0, q16_round(-32767));
+  TEST_ASSERT_EQUAL_INT32(3, q16_round(3 * 65536));
+  TEST_ASSERT_EQUAL_INT32(-3, q16_round(-3 * 65536));
+}
+
+// A filter stepping towards a target from either side ends at the same
+// distance from it
+void test_filter_settles_symmetric() {
+  const int32_t gain = 65536 / 4;
+  int up = 0;
+  int down = 100;
+  for (int i = 0; i < 100; i++) {
+    up += q16_round((int64_t)(50 - up) * gain);
+    down += q16_round((int64_t)(50 - down) * gain);
+  }
+  TEST_ASSERT_EQUAL_INT(50 - up, down - 50);
+}
+
+void test_find_profile() {
+  const char* name = kFilterProfiles[kAnchorProfile].name;
+  TEST_ASSERT_EQUAL_INT(kAnchorProfile, find_filter_profile(name));
+  TEST_ASSERT_EQUAL_INT(-1, find_filter_profile("no such profile"));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_q16_round_symmetric);
+  RUN_TEST(test_q16_round_halves_away_from_zero);
+  RUN_TEST(test_filter_settles_symmetric);
+  RUN_TEST(test_find_profile);
+  return UNITY_END();
+}
@@ -0,0 +1,116 @@
+#include <unity.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "gust_spectrum.h"
+
+static const float kTwoPi = 6.2831853f;
+static const int kBlock = 128;  // Samples per block at 1 Hz
+
+static std::vector<GustStats> outputs;
+
+static GustSpectrum make_spectrum() {
+  GustSpectrum spectrum(1.0f, kBlock);
+  spectrum.set_output([](const GustStats& stats) { outputs.push_back(stats); });
+  return spectrum;
+}
+
+// A sinusoid of the given amplitude at k cycles per block around mean
+static void add_sine(GustSpectrum& spectrum, float mean, float amplitude,
+                     int k, int blocks) {
+  for (int n = 0; n < blocks * kBlock; n++) {
+    spectrum.add(mean + amplitude * sinf(kTwoPi * k * (n % kBlock) / kBlock));
+  }
+}
+
+void setUp() {
+  outputs.clear();
+  srand(1);
+}
+
+void tearDown() {}
+
+void test_steady_speed() {
+  GustSpectrum spectrum = make_spectrum();
+  for (int n = 0; n < 2 * kBlock; n++) spectrum.add(7.5f);
+  TEST_ASSERT_EQUAL(2, outputs.size());
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 7.5f, outputs[1].mean);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.0f, outputs[1].std_dev);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.0f, outputs[1].turbulence_intensity);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, outputs[1].band_energy);
+}
+
+// The Hann window spreads a line over its bin (A^2 / 3) and both neighbours
+// (A^2 / 12 each); together they hold the variance A^2 / 2
+void test_sine_on_bin() {
+  GustSpectrum spectrum = make_spectrum();
+  add_sine(spectrum, 5.0f, 2.0f, 8, 2);
+  TEST_ASSERT_EQUAL(2, outputs.size());
+  for (const GustStats& stats : outputs) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 5.0f, stats.mean);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 2.0f / sqrtf(2.0f), stats.std_dev);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.2828f, stats.turbulence_intensity);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 16.0f, stats.peak_period);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 2.0f, stats.band_energy);
+  }
+}
+
+// A line just above the band leaves only its lower neighbour in it, which
+// has the power of a single side bin
+void test_side_bin_power() {
+  GustSpectrum spectrum = make_spectrum();
+  add_sine(spectrum, 5.0f, 2.0f, GustSpectrum::kBins + 1, 1);
+  TEST_ASSERT_EQUAL(1, outputs.size());
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, (float)kBlock / GustSpectrum::kBins,
+                           outputs[0].peak_period);
+  TEST_ASSERT_FLOAT_WITHIN(0.005f, 4.0f / 12, outputs[0].band_energy);
+}
+
+// Uniform noise of variance w^2 / 12 spreads evenly over the kBlock / 2
+// lines, so the band of kBins lines holds kBins / (kBlock / 2) of it
+void test_white_noise() {
+  const float width = 2.0f;
+  const int blocks = 200;
+  GustSpectrum spectrum = make_spectrum();
+  for (int n = 0; n < (blocks + 1) * kBlock; n++) {
+    spectrum.add(10.0f + width * ((float)rand() / RAND_MAX - 0.5f));
+  }
+  TEST_ASSERT_EQUAL(blocks + 1, outputs.size());
+
+  // The first block is analysed around its first sample, not the mean
+  float variance = 0;
+  float band_energy = 0;
+  for (int i = 1; i <= blocks; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(0.25f, 10.0f, outputs[i].mean);
+    variance += outputs[i].std_dev * outputs[i].std_dev / blocks;
+    band_energy += outputs[i].band_energy / blocks;
+  }
+  float expected = width * width / 12;
+  TEST_ASSERT_FLOAT_WITHIN(0.03f * expected, expected, variance);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f * expected,
+                           expected * GustSpectrum::kBins / (kBlock / 2),
+                           band_energy);
+}
+
+// The block length never goes below what the bins need
+void test_short_block() {
+  GustSpectrum spectrum(0.1f, 10);
+  spectrum.set_output([](const GustStats& stats) { outputs.push_back(stats); });
+  for (int n = 0; n < 2 * GustSpectrum::kBins + 1; n++) spectrum.add(1.0f);
+  TEST_ASSERT_EQUAL(0, outputs.size());
+  spectrum.add(1.0f);
+  TEST_ASSERT_EQUAL(1, outputs.size());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_steady_speed);
+  RUN_TEST(test_sine_on_bin);
+  RUN_TEST(test_side_bin_power);
+  RUN_TEST(test_white_noise);
+  RUN_TEST(test_short_block);
+  return UNITY_END();
+}
@@ -0,0 +1,130 @@
+#include <unity.h>
+
+#include <string.h>
+
+#include "metrics.h"
+
+static const uint32_t kBounds[] = {100, 1000, 10000};
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_histogram_buckets() {
+  Histogram histogram(kBounds, 3);
+  const uint32_t values[] = {5, 100, 101, 999, 5000, 20000};
+  for (uint32_t value : values) histogram.observe(value);
+  TEST_ASSERT_EQUAL_UINT32(2, histogram.get_count(0));
+  TEST_ASSERT_EQUAL_UINT32(2, histogram.get_count(1));
+  TEST_ASSERT_EQUAL_UINT32(1, histogram.get_count(2));
+  TEST_ASSERT_EQUAL_UINT32(1, histogram.get_count(3));
+  TEST_ASSERT_EQUAL_UINT32(6, histogram.get_total());
+  TEST_ASSERT_EQUAL_UINT32(26205, (uint32_t)histogram.get_sum());
+}
+
+// Every kind of metric on one page, in the Prometheus text format
+void test_page_golden() {
+  Histogram histogram(kBounds, 3);
+  histogram.observe(50);
+  histogram.observe(700);
+  histogram.observe(800);
+  histogram.observe(50000);
+
+  char buffer[1024];
+  MetricsWriter writer(buffer, sizeof(buffer));
+  writer.gauge("wind_speed_mps", "Apparent wind speed", 5.25f);
+  writer.gauge("wind_heap_free_bytes", "Free heap", (uint32_t)123456);
+  writer.counter("wind_revolutions_total", "Revolutions processed",
+                 (uint32_t)4000000000u);
+  writer.family("wind_stage_rejects_total", "counter",
+                "Revolutions rejected by each stage");
+  writer.sample("wind_stage_rejects_total", "stage=\"ValidateSpeed\"",
+                (uint32_t)3);
+  writer.sample("wind_stage_rejects_total", "stage=\"ValidateDirection\"",
+                (uint32_t)0);
+  writer.family("wind_direction_deg", "gauge", "Direction");
+  writer.sample("wind_direction_deg", nullptr, 0.5f);
+  writer.histogram("wind_loop_us", "Loop time", histogram);
+
+  const char* golden =
+      "# HELP wind_speed_mps Apparent wind speed\n"
+      "# TYPE wind_speed_mps gauge\n"
+      "wind_speed_mps 5.25\n"
+      "# HELP wind_heap_free_bytes Free heap\n"
+      "# TYPE wind_heap_free_bytes gauge\n"
+      "wind_heap_free_bytes 123456\n"
+      "# HELP wind_revolutions_total Revolutions processed\n"
+      "# TYPE wind_revolutions_total counter\n"
+      "wind_revolutions_total 4000000000\n"
+      "# HELP wind_stage_rejects_total Revolutions rejected by each stage\n"
+      "# TYPE wind_stage_rejects_total counter\n"
+      "wind_stage_rejects_total{stage=\"ValidateSpeed\"} 3\n"
+      "wind_stage_rejects_total{stage=\"ValidateDirection\"} 0\n"
+      "# HELP wind_direction_deg Direction\n"
+      "# TYPE wind_direction_deg gauge\n"
+      "wind_direction_deg 0.5\n"
+      "# HELP wind_loop_us Loop time\n"
+      "# TYPE wind_loop_us histogram\n"
+      "wind_loop_us_bucket{le=\"100\"} 1\n"
+      "wind_loop_us_bucket{le=\"1000\"} 3\n"
+      "wind_loop_us_bucket{le=\"10000\"} 3\n"
+      "wind_loop_us_bucket{le=\"+Inf\"} 4\n"
+      "wind_loop_us_sum 51550\n"
+      "wind_loop_us_count 4\n";
+  TEST_ASSERT_EQUAL_STRING(golden, buffer);
+  TEST_ASSERT_EQUAL(strlen(golden), writer.length());
+  TEST_ASSERT_FALSE(writer.overflow());
+}
+
+void test_empty_histogram() {
+  Histogram histogram(kBounds, 1);
+  char buffer[256];
+  MetricsWriter writer(buffer, sizeof(buffer));
+  writer.histogram("h", "Empty", histogram);
+  TEST_ASSERT_EQUAL_STRING(
+      "# HELP h Empty\n"
+      "# TYPE h histogram\n"
+      "h_bucket{le=\"100\"} 0\n"
+      "h_bucket{le=\"+Inf\"} 0\n"
+      "h_sum 0\n"
+      "h_count 0\n",
+      buffer);
+}
+
+// A full buffer ends at the last complete line, and nothing is added after
+void test_overflow_cuts_at_line() {
+  char buffer[64];
+  MetricsWriter writer(buffer, sizeof(buffer));
+  writer.counter("a_total", "First", (uint32_t)1);
+  size_t first = writer.length();
+  TEST_ASSERT_EQUAL(54, first);
+  writer.counter("b_total", "Second", (uint32_t)2);
+  TEST_ASSERT_TRUE(writer.overflow());
+  TEST_ASSERT_EQUAL_STRING(
+      "# HELP a_total First\n"
+      "# TYPE a_total counter\n"
+      "a_total 1\n",
+      buffer);
+  TEST_ASSERT_EQUAL(first, writer.length());
+
+  writer.sample("c", nullptr, (uint32_t)3);
+  TEST_ASSERT_EQUAL(first, writer.length());
+  TEST_ASSERT_EQUAL(first, strlen(buffer));
+}
+
+void test_starts_empty() {
+  char buffer[8] = "garbage";
+  MetricsWriter writer(buffer, sizeof(buffer));
+  TEST_ASSERT_EQUAL_STRING("", buffer);
+  TEST_ASSERT_EQUAL(0, writer.length());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_histogram_buckets);
+  RUN_TEST(test_page_golden);
+  RUN_TEST(test_empty_histogram);
+  RUN_TEST(test_overflow_cuts_at_line);
+  RUN_TEST(test_starts_empty);
+  return UNITY_END();
+}
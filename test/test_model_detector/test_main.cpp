@@ -0,0 +1,219 @@
+#include <unity.h>
+
+#include <string.h>
+
+#include "model_detector.h"
+
+static ModelDetector detector;
+
+struct Model {
+  const char* name;
+  ModelSignature signature;
+};
+
+#define MODEL(M) \
+  {#M, {M::kPulsesPerRevolution, M::kDirection, M::kReedSwitch, M::kVaneDeadZone}}
+static const Model kModels[] = {MODEL(PeetBrosPro), MODEL(Davis6410),
+                                MODEL(InspeedVortex), MODEL(UltrasonicPulse)};
+static const int kModelCount = sizeof(kModels) / sizeof(kModels[0]);
+
+static int index_of(const char* name) {
+  for (int i = 0; i < kModelCount; i++) {
+    if (strcmp(kModels[i].name, name) == 0) return i;
+  }
+  return -1;
+}
+
+// Observe 3 s of a rotor at 20 revolutions/s, active low, with vane
+// readings every 10 ms from the given function. The pulse counters count
+// speed_pulses and dir_pulses, more than 60 if the reeds bounce.
+static PulsePattern observe(uint32_t speed_pulses, uint32_t dir_pulses,
+                            uint16_t (*vane)(int i)) {
+  detector.start(1000, 2000);
+  for (int i = 0; i < 3000; i++) detector.sample((i % 50) > 2);
+  for (int i = 0; i < 300; i++) detector.sample_vane(vane(i));
+  return detector.finish(1000 + speed_pulses, 2000 + dir_pulses);
+}
+
+static PulsePattern observe(uint32_t dir_pulses, uint16_t (*vane)(int i)) {
+  return observe(60, dir_pulses, vane);
+}
+
+static uint16_t vane_steady(int i) { return 2000 + (i % 5); }
+static uint16_t vane_swinging(int i) { return 1500 + 10 * (i % 100); }
+static uint16_t vane_floating(int i) { return (uint16_t)((i * 2654435761u) >> 20); }
+static uint16_t vane_grounded(int i) { return i % 3; }
+static uint16_t vane_open(int i) { return 4095; }
+
+// Veering through north, a potentiometer reads at the rail in its dead zone
+// while a hall vane jumps straight to the other end
+static uint16_t vane_dead_zone(int i) {
+  if (i < 100) return 3600 + 4 * i;
+  if (i < 104) return 4095;
+  return 50 + 4 * (i - 104);
+}
+static uint16_t vane_hall(int i) {
+  return (i < 100) ? 3600 + 4 * i : 100 + 4 * (i - 100);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_too_few_pulses() {
+  detector.start(0, 0);
+  detector.sample(true);
+  PulsePattern pattern = detector.finish(3, 3);
+  TEST_ASSERT_FALSE(pattern.valid);
+}
+
+void test_direction_pulse() {
+  PulsePattern pattern = observe(60, vane_grounded);
+  TEST_ASSERT_TRUE(pattern.valid);
+  TEST_ASSERT_TRUE(pattern.direction_pulse);
+  TEST_ASSERT_FALSE(pattern.analog_vane);
+  TEST_ASSERT_EQUAL(1, pattern.pulses_per_revolution);
+  TEST_ASSERT_FALSE(pattern.active_high);
+}
+
+void test_analog_vane_steady() {
+  PulsePattern pattern = observe(0, vane_steady);
+  TEST_ASSERT_FALSE(pattern.direction_pulse);
+  TEST_ASSERT_TRUE(pattern.analog_vane);
+}
+
+void test_analog_vane_swinging() {
+  PulsePattern pattern = observe(0, vane_swinging);
+  TEST_ASSERT_TRUE(pattern.analog_vane);
+}
+
+// A dead direction reed must not pass for an analog vane
+void test_dead_reed_floating_input() {
+  PulsePattern pattern = observe(0, vane_floating);
+  TEST_ASSERT_FALSE(pattern.direction_pulse);
+  TEST_ASSERT_FALSE(pattern.analog_vane);
+}
+
+void test_dead_reed_input_at_rail() {
+  TEST_ASSERT_FALSE(observe(0, vane_grounded).analog_vane);
+  TEST_ASSERT_FALSE(observe(0, vane_open).analog_vane);
+}
+
+void test_no_vane_samples() {
+  detector.start(0, 0);
+  for (int i = 0; i < 3000; i++) detector.sample(true);
+  PulsePattern pattern = detector.finish(60, 0);
+  TEST_ASSERT_TRUE(pattern.valid);
+  TEST_ASSERT_FALSE(pattern.analog_vane);
+}
+
+void test_active_high() {
+  detector.start(0, 0);
+  for (int i = 0; i < 3000; i++) detector.sample((i % 50) < 3);
+  TEST_ASSERT_TRUE(detector.finish(60, 60).active_high);
+}
+
+void test_reed_bounce() {
+  PulsePattern pattern = observe(120, 120, vane_grounded);
+  TEST_ASSERT_TRUE(pattern.bounce_known);
+  TEST_ASSERT_TRUE(pattern.bounce);
+  TEST_ASSERT_EQUAL(1, pattern.pulses_per_revolution);
+
+  pattern = observe(60, 60, vane_grounded);
+  TEST_ASSERT_TRUE(pattern.bounce_known);
+  TEST_ASSERT_FALSE(pattern.bounce);
+}
+
+// Pulses shorter than the sampling can't be told from bounce
+void test_fast_pulses_bounce_unknown() {
+  detector.start(0, 0);
+  for (int i = 0; i < 3000; i++) detector.sample((i % 4) < 2);
+  PulsePattern pattern = detector.finish(750, 750);
+  TEST_ASSERT_TRUE(pattern.valid);
+  TEST_ASSERT_FALSE(pattern.bounce_known);
+}
+
+void test_vane_dead_zone() {
+  PulsePattern pattern = observe(0, vane_dead_zone);
+  TEST_ASSERT_TRUE(pattern.analog_vane);
+  TEST_ASSERT_TRUE(pattern.dead_zone_known);
+  TEST_ASSERT_TRUE(pattern.dead_zone);
+
+  pattern = observe(0, vane_hall);
+  TEST_ASSERT_TRUE(pattern.analog_vane);
+  TEST_ASSERT_TRUE(pattern.dead_zone_known);
+  TEST_ASSERT_FALSE(pattern.dead_zone);
+
+  TEST_ASSERT_FALSE(observe(0, vane_steady).dead_zone_known);
+}
+
+void test_select_confirms_current() {
+  PulsePattern pattern = observe(120, 120, vane_grounded);
+  int current = index_of("PeetBrosPro");
+  ModelDetector::Selection selection =
+      ModelDetector::select(pattern, kModels, kModelCount, current);
+  TEST_ASSERT_EQUAL(current, selection.index);
+  TEST_ASSERT_EQUAL_STRING("confirmed", selection.result);
+}
+
+// A foreign pattern of the other model of each pair switches to it
+void test_select_other_model_of_pair() {
+  struct {
+    const char* current;
+    PulsePattern pattern;
+    const char* expected;
+  } cases[] = {
+      {"PeetBrosPro", observe(60, 60, vane_grounded), "UltrasonicPulse"},
+      {"UltrasonicPulse", observe(120, 120, vane_grounded), "PeetBrosPro"},
+      {"Davis6410", observe(0, vane_hall), "InspeedVortex"},
+      {"InspeedVortex", observe(0, vane_dead_zone), "Davis6410"},
+      {"PeetBrosPro", observe(0, vane_dead_zone), "Davis6410"},
+      {"Davis6410", observe(120, 120, vane_grounded), "PeetBrosPro"},
+  };
+  for (const auto& c : cases) {
+    ModelDetector::Selection selection = ModelDetector::select(
+        c.pattern, kModels, kModelCount, index_of(c.current));
+    TEST_ASSERT_EQUAL_STRING("selected", selection.result);
+    TEST_ASSERT_EQUAL_STRING(c.expected, kModels[selection.index].name);
+  }
+}
+
+// Without the signature of its pair, a pattern matches both models
+void test_select_ambiguous_without_signature() {
+  ModelDetector::Selection selection = ModelDetector::select(
+      observe(0, vane_steady), kModels, kModelCount, index_of("PeetBrosPro"));
+  TEST_ASSERT_EQUAL(-1, selection.index);
+  TEST_ASSERT_EQUAL_STRING("ambiguous", selection.result);
+
+  // but the current model of the pair is kept
+  selection = ModelDetector::select(observe(0, vane_steady), kModels,
+                                    kModelCount, index_of("InspeedVortex"));
+  TEST_ASSERT_EQUAL_STRING("confirmed", selection.result);
+}
+
+void test_select_keeps_model_without_direction() {
+  ModelDetector::Selection selection = ModelDetector::select(
+      observe(0, vane_floating), kModels, kModelCount, 0);
+  TEST_ASSERT_EQUAL(-1, selection.index);
+  TEST_ASSERT_EQUAL_STRING("no direction", selection.result);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_too_few_pulses);
+  RUN_TEST(test_direction_pulse);
+  RUN_TEST(test_analog_vane_steady);
+  RUN_TEST(test_analog_vane_swinging);
+  RUN_TEST(test_dead_reed_floating_input);
+  RUN_TEST(test_dead_reed_input_at_rail);
+  RUN_TEST(test_no_vane_samples);
+  RUN_TEST(test_active_high);
+  RUN_TEST(test_reed_bounce);
+  RUN_TEST(test_fast_pulses_bounce_unknown);
+  RUN_TEST(test_vane_dead_zone);
+  RUN_TEST(test_select_confirms_current);
+  RUN_TEST(test_select_other_model_of_pair);
+  RUN_TEST(test_select_ambiguous_without_signature);
+  RUN_TEST(test_select_keeps_model_without_direction);
+  return UNITY_END();
+}
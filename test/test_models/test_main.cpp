@@ -0,0 +1,151 @@
+#include <unity.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "anemometer_model.h"
+#include "wind_stages.h"
+
+// Pulses per second at the highest plausible speed of the model
+template <class Model>
+static unsigned long max_pulse_rate() {
+  long rps = 0;  // Revolutions per 100 s
+  while (Model::calibrate(rps) < Model::kMaxSpeed) rps++;
+  return (unsigned long)(rps * Model::kPulsesPerRevolution + 99) / 100;
+}
+
+// The debounce and the storm guard must pass every plausible speed
+template <class Model>
+static void check_rates() {
+  unsigned long rate = max_pulse_rate<Model>();
+  TEST_ASSERT_LESS_THAN(1000000ul / rate, Model::kDebounce);
+  TEST_ASSERT_GREATER_THAN(rate, Model::kSaneRate);
+  TEST_ASSERT_GREATER_THAN(Model::kSaneRate, Model::kStormRate);
+}
+
+template <class Model>
+static void check_calibration_monotonic() {
+  long previous = Model::calibrate(0);
+  for (long rps = 1; Model::calibrate(rps) < Model::kMaxSpeed; rps++) {
+    long speed = Model::calibrate(rps);
+    TEST_ASSERT_GREATER_OR_EQUAL(previous, speed);
+    previous = speed;
+  }
+}
+
+static SpeedTable speed_table;
+static DirectionTable dir_table;
+
+/**
+ * @brief Simulated pulse trains of a model in a steady wind.
+ *
+ * The rotor turns at the rate the calibration curve gives for the speed,
+ * with 1% period jitter. The direction pulse follows the speed pulse at the
+ * phase of the direction, or the vane reads it, and the revolutions run
+ * through the model's WindPipeline as in processRevolution().
+ *
+ * @return false if the last revolution did not pass
+ */
+template <class Model>
+static bool simulate(long cmps, int direction, int revolutions) {
+  long rps = 1;  // Revolutions per 100 s
+  while (Model::calibrate(rps) < cmps) rps++;
+  unsigned long period = 100000000ul / (rps * Model::kPulsesPerRevolution);
+  // phase_to_direction() reverses the sensor phase
+  uint16_t phase = (uint16_t)(((360 - direction) % 360) * 65536l / 360);
+
+  unsigned long pulse = 1000000;
+  bool passed = false;
+  for (int i = 0; i < revolutions; i++) {
+    unsigned long speed_time = period + (long)period * (rand() % 201 - 100) /
+                                            10000;
+    pulse += speed_time;
+    wind_context.now = pulse + 500;
+    wind_context.vane_phase = (uint16_t)(0u - phase);
+    WindSample sample = {pulse, speed_time,
+                         (unsigned long)(((uint64_t)speed_time * phase) >> 16),
+                         0, 0, 0, 0, 0};
+    passed = WindPipeline<Model>::run(sample);
+  }
+  return passed;
+}
+
+// The speed and direction a model recovers from a simulated wind, within 2%
+// and 2 degrees, starting from calm for every wind
+template <class Model>
+static void check_recovers_wind() {
+  const long speeds[] = {150, 520, 1230, 2500};
+  const int directions[] = {0, 3, 87, 180, 271, 357};
+  for (long cmps : speeds) {
+    if (cmps > Model::kMaxSpeed) continue;
+    for (int direction : directions) {
+      wind_context = WindContext();
+      wind_context.timeout = 3000000;
+      wind_context.filter.set(kFilterProfiles[kCustomProfile]);
+      wind_context.speed_table = &speed_table;
+      wind_context.dir_table = &dir_table;
+      wind_context.vane_ready = true;
+
+      bool passed = simulate<Model>(cmps, direction, 100);
+      char message[64];
+      snprintf(message, sizeof(message), "%ld cm/s from %d deg: %d, %d deg",
+               cmps, direction, wind_context.speed_out, wind_context.dir_out);
+      TEST_ASSERT_TRUE_MESSAGE(passed, message);
+      TEST_ASSERT_INT_WITHIN_MESSAGE(cmps / 50 + 1, cmps,
+                                     wind_context.speed_out, message);
+      int error = (wind_context.dir_out - direction + 540) % 360 - 180;
+      TEST_ASSERT_INT_WITHIN_MESSAGE(2, 0, error, message);
+    }
+  }
+}
+
+void setUp() { srand(1); }
+
+void tearDown() {}
+
+void test_peet_bros_rates() { check_rates<PeetBrosPro>(); }
+void test_davis_rates() { check_rates<Davis6410>(); }
+void test_inspeed_rates() { check_rates<InspeedVortex>(); }
+void test_ultrasonic_rates() { check_rates<UltrasonicPulse>(); }
+
+void test_ultrasonic_max_rate() {
+  // 10 Hz per m/s
+  TEST_ASSERT_EQUAL(600, max_pulse_rate<UltrasonicPulse>());
+}
+
+void test_calibrations_monotonic() {
+  check_calibration_monotonic<PeetBrosPro>();
+  check_calibration_monotonic<Davis6410>();
+  check_calibration_monotonic<InspeedVortex>();
+  check_calibration_monotonic<UltrasonicPulse>();
+}
+
+void test_calibration_points() {
+  // 1 revolution/s
+  TEST_ASSERT_EQUAL(100, Davis6410::calibrate(100));
+  TEST_ASSERT_EQUAL(111, InspeedVortex::calibrate(100));
+  TEST_ASSERT_EQUAL(10, UltrasonicPulse::calibrate(100));
+}
+
+void test_peet_bros_recovers_wind() { check_recovers_wind<PeetBrosPro>(); }
+void test_davis_recovers_wind() { check_recovers_wind<Davis6410>(); }
+void test_inspeed_recovers_wind() { check_recovers_wind<InspeedVortex>(); }
+void test_ultrasonic_recovers_wind() {
+  check_recovers_wind<UltrasonicPulse>();
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_peet_bros_rates);
+  RUN_TEST(test_davis_rates);
+  RUN_TEST(test_inspeed_rates);
+  RUN_TEST(test_ultrasonic_rates);
+  RUN_TEST(test_ultrasonic_max_rate);
+  RUN_TEST(test_calibrations_monotonic);
+  RUN_TEST(test_calibration_points);
+  RUN_TEST(test_peet_bros_recovers_wind);
+  RUN_TEST(test_davis_recovers_wind);
+  RUN_TEST(test_inspeed_recovers_wind);
+  RUN_TEST(test_ultrasonic_recovers_wind);
+  return UNITY_END();
+}
@@ -0,0 +1,168 @@
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+
+#include "overspeed.h"
+
+static const float kDistanceConstant = 300.0f;   // cm
+static const float kRevolution = 50.0f;          // cm of wind per revolution
+static const float kStep = 100e-6f;              // s
+
+struct Revolution {
+  uint32_t speed_pulse;   // us
+  uint32_t speed_time;    // us
+  int32_t cmps;           // rotor speed
+  int32_t reference;      // mean wind speed over the revolution
+};
+
+/**
+ * Spin a rotor with the response time L/u (fast up, slow down) in a wind
+ * gusting around mean with the given amplitude and period, and call back
+ * every revolution.
+ */
+template <class F>
+static void simulate(float mean, float amplitude, float period,
+                     float seconds, F on_revolution) {
+  float rotor = mean;
+  float travelled = 0.0f;
+  float wind_sum = 0.0f;
+  uint32_t last_pulse = 0;
+  uint32_t steps = 0;
+  for (float t = 0.0f; t < seconds; t += kStep) {
+    float wind = mean + amplitude * sinf(2.0f * (float)M_PI * t / period);
+    rotor += kStep * wind / kDistanceConstant * (wind - rotor);
+    travelled += rotor * kStep;
+    wind_sum += wind;
+    steps++;
+    if (travelled >= kRevolution) {
+      travelled -= kRevolution;
+      uint32_t pulse = (uint32_t)(t * 1e6f);
+      uint32_t speed_time = pulse - last_pulse;
+      Revolution rev = {pulse, speed_time,
+                        (int32_t)(kRevolution * 1e6f / speed_time),
+                        (int32_t)(wind_sum / steps)};
+      if (last_pulse > 0) on_revolution(rev);
+      last_pulse = pulse;
+      wind_sum = 0.0f;
+      steps = 0;
+    }
+  }
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_disabled_passes_speed() {
+  OverspeedCompensator compensator;
+  TEST_ASSERT_EQUAL_INT32(500, compensator.compensate(500, 1000, 100000));
+  TEST_ASSERT_EQUAL_INT32(700, compensator.compensate(700, 2000, 71428));
+}
+
+void test_steady_speed_unchanged() {
+  OverspeedCompensator compensator;
+  compensator.set_distance_constant(300);
+  for (uint32_t i = 1; i < 10; i++) {
+    TEST_ASSERT_EQUAL_INT32(500, compensator.compensate(500, i * 100000,
+                                                        100000));
+  }
+}
+
+void test_snapshot_reuses_correction() {
+  OverspeedCompensator compensator;
+  compensator.set_distance_constant(300);
+  compensator.compensate(500, 100000, 100000);
+  int32_t first = compensator.compensate(600, 183333, 83333);
+  TEST_ASSERT_GREATER_THAN_INT32(600, first);
+  TEST_ASSERT_EQUAL_INT32(first, compensator.compensate(600, 183333, 83333));
+}
+
+// u = (u_r + sqrt(u_r^2 + 4 L du_r/dt)) / 2 with du_r/dt = 1200 cm/s^2
+void test_exact_root() {
+  OverspeedCompensator compensator;
+  compensator.set_distance_constant(300);
+  compensator.compensate(500, 100000, 100000);
+  TEST_ASSERT_EQUAL_INT32(970, compensator.compensate(600, 183333, 83333));
+}
+
+void test_reset_skips_next_revolution() {
+  OverspeedCompensator compensator;
+  compensator.set_distance_constant(300);
+  compensator.compensate(500, 100000, 100000);
+  compensator.reset();
+  TEST_ASSERT_EQUAL_INT32(600, compensator.compensate(600, 183333, 83333));
+}
+
+void test_correction_bounded() {
+  OverspeedCompensator compensator;
+  compensator.set_distance_constant(100000);
+  compensator.compensate(100, 100000, 500000);
+  TEST_ASSERT_EQUAL_INT32(400, compensator.compensate(200, 350000, 250000));
+  // A deceleration faster than the rotor model allows
+  TEST_ASSERT_EQUAL_INT32(50, compensator.compensate(100, 850000, 500000));
+}
+
+void test_estimate_distance_constant() {
+  DistanceConstantEstimator estimator;
+  int32_t last = 0;
+  simulate(500.0f, 200.0f, 4.0f, 60.0f, [&](const Revolution& rev) {
+    estimator.add(rev.reference, rev.cmps, last, rev.speed_time);
+    last = rev.cmps;
+  });
+
+  char message[64];
+  snprintf(message, sizeof(message), "Estimated L %.0f cm, simulated %.0f cm",
+           estimator.get_distance_constant(), kDistanceConstant);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_FLOAT_WITHIN(0.2f * kDistanceConstant, kDistanceConstant,
+                           estimator.get_distance_constant());
+}
+
+// The time weighted mean of the rotor overestimates the mean wind, the
+// compensation with the estimated L takes most of that back
+void test_accuracy_gain() {
+  DistanceConstantEstimator estimator;
+  int32_t last = 0;
+  simulate(500.0f, 250.0f, 3.0f, 60.0f, [&](const Revolution& rev) {
+    estimator.add(rev.reference, rev.cmps, last, rev.speed_time);
+    last = rev.cmps;
+  });
+
+  OverspeedCompensator compensator;
+  compensator.set_distance_constant(
+      (int32_t)lroundf(estimator.get_distance_constant()));
+  double raw = 0.0;
+  double compensated = 0.0;
+  double time = 0.0;
+  simulate(500.0f, 250.0f, 3.0f, 60.0f, [&](const Revolution& rev) {
+    int32_t cmps = compensator.compensate(rev.cmps, rev.speed_pulse,
+                                          rev.speed_time);
+    raw += (double)rev.cmps * rev.speed_time;
+    compensated += (double)cmps * rev.speed_time;
+    time += rev.speed_time;
+  });
+  float raw_error = raw / time - 500.0;
+  float compensated_error = compensated / time - 500.0;
+
+  char message[96];
+  snprintf(message, sizeof(message),
+           "Mean speed error %.1f cm/s raw, %.1f cm/s compensated", raw_error,
+           compensated_error);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_TRUE(raw_error > 0.0f);
+  TEST_ASSERT_TRUE(fabsf(compensated_error) < 0.5f * raw_error);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_disabled_passes_speed);
+  RUN_TEST(test_steady_speed_unchanged);
+  RUN_TEST(test_snapshot_reuses_correction);
+  RUN_TEST(test_exact_root);
+  RUN_TEST(test_reset_skips_next_revolution);
+  RUN_TEST(test_correction_bounded);
+  RUN_TEST(test_estimate_distance_constant);
+  RUN_TEST(test_accuracy_gain);
+  return UNITY_END();
+}
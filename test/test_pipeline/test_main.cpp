@@ -0,0 +1,279 @@
+#include <unity.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "wind_stages.h"
+
+static SpeedTable speed_table;
+static DirectionTable dir_table;
+
+// The inputs main.cpp sets, with a sensor offset and harmonic to exercise
+// every stage, and the filter state of a fresh boot
+static void reset_context() {
+  wind_context = WindContext();
+  wind_context.timeout = 3000000;
+  wind_context.filter.set(kFilterProfiles[kCruisingProfile]);
+  wind_context.speed_table = &speed_table;
+  wind_context.dir_table = &dir_table;
+  wind_context.dir_offset = 12;
+  wind_context.dir_sin = 2.0f;
+  wind_context.dir_cos = -1.5f;
+  wind_context.vane_ready = true;
+}
+
+/**
+ * The processing as one function, as calcWindSpeedAndDir() called it before
+ * the pipeline: the body of processRevolution() up to the commit that split
+ * it into stages, with the fixes made to the stages since (rounding of the
+ * direction step, phase_to_direction() at north). It keeps the state in
+ * wind_context too, so the two can be compared output for output.
+ */
+template <class Model>
+static __attribute__((noinline)) bool monolith(unsigned long speed_pulse,
+                                               unsigned long speed_time,
+                                               unsigned long direction_time) {
+  WindContext& c = wind_context;
+  long wind_direction = 0, cmps = 0;
+  int dev = 0;
+  bool passed = false;
+
+  // Make speed zero, if the pulse delay is too long
+  if (c.now - speed_pulse > c.timeout) speed_time = 0;
+
+  if (speed_time > 0) {
+    c.rps = 100000000 / (speed_time * Model::kPulsesPerRevolution);
+
+    cmps = Model::calibrate(c.rps);
+    if (cmps < 0) cmps = 0;
+    cmps = c.speed_table->correct(cmps, c.rps);
+    if (Model::kRotor) {
+      if (c.true_periods) {
+        cmps = c.overspeed.compensate(cmps, speed_pulse, speed_time);
+      } else {
+        c.overspeed.reset();
+      }
+    }
+    dev = (int)cmps - c.prev_speed;
+
+    if ((cmps <= Model::kMaxSpeed) && check_speed_dev<Model>(cmps, dev)) {
+      int32_t target = cmps << 16;
+      int32_t gain = (target > c.speed_state) ? c.filter.speed_attack
+                                              : c.filter.speed_release;
+      c.speed_state +=
+          (int32_t)(((int64_t)(target - c.speed_state) * gain) >> 16);
+      c.speed_out = c.speed_state >> 16;
+
+      bool have_direction = (Model::kDirection == kAnalogVane)
+                                ? c.vane_ready
+                                : (c.dir_valid && (direction_time <= speed_time));
+      if (have_direction) {
+        uint16_t phase;
+        if (Model::kDirection == kAnalogVane) {
+          phase = (uint16_t)(0u - c.vane_phase);
+        } else {
+          phase = (uint16_t)((((uint64_t)direction_time) << 16) / speed_time);
+        }
+        if (c.on_phase != nullptr) c.on_phase(phase);
+        phase = c.dir_table->correct(phase);
+        wind_direction = phase_to_direction(phase, c.dir_offset);
+        wind_direction = correct_direction(wind_direction);
+
+        dev = (int)wind_direction - c.prev_dir;
+        if (check_dir_dev<Model>(cmps, dev)) {
+          int delta = ((int)wind_direction - c.dir_out);
+          if (delta < -180) {
+            delta = delta + 360;
+          } else if (delta > +180) {
+            delta = delta - 360;
+          }
+          if (abs(delta) > c.filter.dir_deadband) {
+            c.dir_out =
+                (c.dir_out + q16_round((int64_t)delta * c.filter.dir_gain)) %
+                360;
+            if (c.dir_out < 0) c.dir_out = c.dir_out + 360;
+          }
+          passed = true;
+        }
+        c.prev_dir = wind_direction;
+      }
+    } else {
+      c.ignore_next = true;
+    }
+
+    c.prev_speed = cmps;
+  } else {
+    c.speed_out = 0;
+    c.speed_state = 0;
+    c.prev_speed = 0;
+  }
+  return passed;
+}
+
+template <class Model>
+static __attribute__((noinline)) bool pipeline(unsigned long speed_pulse,
+                                               unsigned long speed_time,
+                                               unsigned long direction_time) {
+  WindSample sample = {speed_pulse, speed_time, direction_time, 0, 0, 0, 0, 0};
+  return WindPipeline<Model>::run(sample);
+}
+
+struct Revolution {
+  unsigned long now;
+  unsigned long speed_pulse;
+  unsigned long speed_time;
+  unsigned long direction_time;
+  uint16_t vane_phase;
+};
+
+// A wind around 8 m/s, veering and gusting, with now and then a stall, a
+// direction pulse outside its revolution and an implausible revolution
+static std::vector<Revolution> revolutions(int n) {
+  std::vector<Revolution> out;
+  unsigned long pulse = 0;
+  for (int i = 0; i < n; i++) {
+    unsigned long speed_time = 100000 + rand() % 20000;
+    if (rand() % 100 == 0) speed_time = 3000;
+    pulse += speed_time;
+    unsigned long direction_time =
+        (speed_time * (20000 + (i % 400) * 10 + rand() % 3000)) / 65536;
+    if (rand() % 50 == 0) direction_time = speed_time + 1;
+    unsigned long now = pulse + 1000;
+    if (rand() % 100 == 0) now += 4000000;
+    uint16_t vane_phase = (uint16_t)(40000 + (i % 400) * 10 + rand() % 3000);
+    out.push_back({now, pulse, speed_time, direction_time, vane_phase});
+  }
+  return out;
+}
+
+template <class Model>
+static void check_matches_monolith() {
+  std::vector<Revolution> in = revolutions(20000);
+
+  reset_context();
+  std::vector<bool> passed;
+  std::vector<int> speeds;
+  std::vector<int> directions;
+  for (const Revolution& r : in) {
+    wind_context.now = r.now;
+    wind_context.vane_phase = r.vane_phase;
+    passed.push_back(monolith<Model>(r.speed_pulse, r.speed_time,
+                                     r.direction_time));
+    speeds.push_back(wind_context.speed_out);
+    directions.push_back(wind_context.dir_out);
+  }
+
+  reset_context();
+  for (size_t i = 0; i < in.size(); i++) {
+    const Revolution& r = in[i];
+    wind_context.now = r.now;
+    wind_context.vane_phase = r.vane_phase;
+    TEST_ASSERT_EQUAL(passed[i], pipeline<Model>(r.speed_pulse, r.speed_time,
+                                                 r.direction_time));
+    TEST_ASSERT_EQUAL_INT32(speeds[i], wind_context.speed_out);
+    TEST_ASSERT_EQUAL_INT32(directions[i], wind_context.dir_out);
+  }
+}
+
+template <class Model>
+static void benchmark(const char* name) {
+  const int rounds = 50;
+  std::vector<Revolution> in = revolutions(10000);
+  volatile long sink = 0;
+
+  reset_context();
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < rounds; round++) {
+    for (const Revolution& r : in) {
+      wind_context.now = r.now;
+      wind_context.vane_phase = r.vane_phase;
+      sink = sink + monolith<Model>(r.speed_pulse, r.speed_time,
+                                    r.direction_time);
+    }
+  }
+  auto hand_written = std::chrono::steady_clock::now() - start;
+
+  reset_context();
+  start = std::chrono::steady_clock::now();
+  for (int round = 0; round < rounds; round++) {
+    for (const Revolution& r : in) {
+      wind_context.now = r.now;
+      wind_context.vane_phase = r.vane_phase;
+      sink = sink + pipeline<Model>(r.speed_pulse, r.speed_time,
+                                    r.direction_time);
+    }
+  }
+  auto composed = std::chrono::steady_clock::now() - start;
+
+  double n = (double)rounds * in.size();
+  char message[128];
+  snprintf(message, sizeof(message),
+           "%s revolution: %.1f ns monolith, %.1f ns pipeline", name,
+           std::chrono::duration<double, std::nano>(hand_written).count() / n,
+           std::chrono::duration<double, std::nano>(composed).count() / n);
+  TEST_MESSAGE(message);
+}
+
+void setUp() {
+  srand(1);
+  reset_context();
+}
+
+void tearDown() {}
+
+void test_stage_names() {
+  TEST_ASSERT_EQUAL(8, WindPipeline<PeetBrosPro>::kStages);
+  TEST_ASSERT_EQUAL_STRING("CheckTimeout",
+                           WindPipeline<PeetBrosPro>::stage_name(0));
+  TEST_ASSERT_EQUAL_STRING("FilterDirection",
+                           WindPipeline<PeetBrosPro>::stage_name(7));
+  TEST_ASSERT_EQUAL_STRING("", WindPipeline<PeetBrosPro>::stage_name(8));
+}
+
+// A direction pulse after the end of its revolution holds the direction,
+// but the speed goes through
+void test_rejecting_stage_ends_pass() {
+  wind_context.now = 1001000;
+  WindSample s = {1000000, 1000000, 2000000, 0, 0, 0, 0, 0};
+  TEST_ASSERT_FALSE(WindPipeline<PeetBrosPro>::run(s));
+  TEST_ASSERT_EQUAL_STRING("MeasurePhase",
+                           WindPipeline<PeetBrosPro>::stage_name(s.stages));
+  TEST_ASSERT_TRUE(wind_context.speed_out > 0);
+  TEST_ASSERT_EQUAL_INT(0, wind_context.dir_out);
+}
+
+void test_stall_zeroes_speed() {
+  wind_context.now = 1001000;
+  pipeline<Davis6410>(1000000, 1000000, 0);
+  TEST_ASSERT_TRUE(wind_context.speed_out > 0);
+  wind_context.now = 1000000 + wind_context.timeout + 1;
+  TEST_ASSERT_FALSE(pipeline<Davis6410>(1000000, 1000000, 0));
+  TEST_ASSERT_EQUAL_INT(0, wind_context.speed_out);
+}
+
+void test_matches_monolith_phase_pulse() {
+  check_matches_monolith<PeetBrosPro>();
+}
+
+void test_matches_monolith_analog_vane() {
+  check_matches_monolith<Davis6410>();
+}
+
+// The cost of the composed stages against the hand-written function
+void test_benchmark_pipeline() {
+  benchmark<PeetBrosPro>("PeetBrosPro");
+  benchmark<Davis6410>("Davis6410");
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_stage_names);
+  RUN_TEST(test_rejecting_stage_ends_pass);
+  RUN_TEST(test_stall_zeroes_speed);
+  RUN_TEST(test_matches_monolith_phase_pulse);
+  RUN_TEST(test_matches_monolith_analog_vane);
+  RUN_TEST(test_benchmark_pipeline);
+  return UNITY_END();
+}
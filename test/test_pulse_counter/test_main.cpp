@@ -0,0 +1,113 @@
+#include <unity.h>
+
+#include "pulse_counter.h"
+
+static uint32_t events = 0;
+static uint32_t last_status = 0;
+
+static void on_event(uint32_t status) {
+  events++;
+  last_status = status;
+}
+
+static void pulses(int n, bool active_high) {
+  for (int i = 0; i < n; i++) mock_pcnt_pulse(PCNT_UNIT_0, active_high);
+}
+
+void setUp() {
+  mock_pcnt_reset();
+  events = 0;
+  last_status = 0;
+}
+
+void tearDown() {}
+
+void test_counts_falling_edges() {
+  PulseCounter counter(4, PCNT_UNIT_0);
+  counter.begin();
+  TEST_ASSERT_EQUAL(PCNT_COUNT_DIS, mock_pcnt_units[0].config.pos_mode);
+  TEST_ASSERT_EQUAL(PCNT_COUNT_INC, mock_pcnt_units[0].config.neg_mode);
+  TEST_ASSERT_TRUE(mock_pcnt_units[0].filter);
+  pulses(5, false);
+  TEST_ASSERT_EQUAL(5, counter.get_total());
+}
+
+void test_counts_rising_edges_active_high() {
+  PulseCounter counter(4, PCNT_UNIT_0, 1023, true);
+  counter.begin();
+  TEST_ASSERT_EQUAL(PCNT_COUNT_INC, mock_pcnt_units[0].config.pos_mode);
+  TEST_ASSERT_EQUAL(PCNT_COUNT_DIS, mock_pcnt_units[0].config.neg_mode);
+  // The leading edge only
+  mock_pcnt_edge(PCNT_UNIT_0, true);
+  TEST_ASSERT_EQUAL(1, counter.get_total());
+  mock_pcnt_edge(PCNT_UNIT_0, false);
+  TEST_ASSERT_EQUAL(1, counter.get_total());
+}
+
+void test_set_active_high_while_counting() {
+  PulseCounter counter(4, PCNT_UNIT_0);
+  counter.begin();
+  pulses(3, false);
+  counter.set_active_high(true);
+  TEST_ASSERT_EQUAL(PCNT_COUNT_INC, mock_pcnt_units[0].config.pos_mode);
+  pulses(2, true);
+  TEST_ASSERT_EQUAL(5, counter.get_total());
+}
+
+void test_wraps_extend_the_total() {
+  PulseCounter counter(4, PCNT_UNIT_0);
+  counter.begin(8);
+  pulses(8 * 1000 + 3, false);
+  TEST_ASSERT_EQUAL(8 * 1000 + 3, counter.get_total());
+}
+
+void test_read_delta() {
+  PulseCounter counter(4, PCNT_UNIT_0);
+  counter.begin(8);
+  pulses(13, false);
+  TEST_ASSERT_EQUAL(13, counter.read_delta());
+  TEST_ASSERT_EQUAL(0, counter.read_delta());
+  pulses(4, false);
+  TEST_ASSERT_EQUAL(4, counter.read_delta());
+}
+
+// The counter mode interrupts at every block and one revolution later
+void test_block_and_threshold_events() {
+  PulseCounter counter(4, PCNT_UNIT_0);
+  counter.set_event_handler(on_event);
+  counter.begin(8);
+  counter.enable_threshold(1);
+  pulses(7, false);
+  TEST_ASSERT_EQUAL(1, events);  // The first revolution, before any block
+  TEST_ASSERT_TRUE(last_status & PCNT_EVT_THRES_0);
+  pulses(1, false);
+  TEST_ASSERT_EQUAL(2, events);
+  TEST_ASSERT_TRUE(last_status & PCNT_EVT_H_LIM);
+  pulses(1, false);
+  TEST_ASSERT_EQUAL(3, events);
+  TEST_ASSERT_TRUE(last_status & PCNT_EVT_THRES_0);
+  pulses(7, false);
+  TEST_ASSERT_EQUAL(4, events);
+  TEST_ASSERT_TRUE(last_status & PCNT_EVT_H_LIM);
+}
+
+// Reed bounce longer than the glitch filter is counted, which the counter
+// mode can only catch as an implausibly short period
+void test_bounce_is_counted() {
+  PulseCounter counter(4, PCNT_UNIT_0);
+  counter.begin();
+  for (int i = 0; i < 10; i++) pulses(3, false);  // 2 bounces per closure
+  TEST_ASSERT_EQUAL(30, counter.get_total());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_counts_falling_edges);
+  RUN_TEST(test_counts_rising_edges_active_high);
+  RUN_TEST(test_set_active_high_while_counting);
+  RUN_TEST(test_wraps_extend_the_total);
+  RUN_TEST(test_read_delta);
+  RUN_TEST(test_block_and_threshold_events);
+  RUN_TEST(test_bounce_is_counted);
+  return UNITY_END();
+}
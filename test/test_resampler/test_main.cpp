@@ -0,0 +1,125 @@
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include "resampler.h"
+
+static std::vector<ResampledWind> outputs;
+
+static Resampler make_resampler(uint8_t rate) {
+  Resampler resampler(rate);
+  resampler.set_output(
+      [](const ResampledWind& wind) { outputs.push_back(wind); });
+  return resampler;
+}
+
+void setUp() { outputs.clear(); }
+
+void tearDown() {}
+
+void test_steady_wind() {
+  Resampler resampler = make_resampler(1);
+  for (uint32_t t = 0; t <= 10000000; t += 200000) resampler.add(t, 250, 90);
+  TEST_ASSERT_EQUAL(10, outputs.size());
+  for (size_t i = 0; i < outputs.size(); i++) {
+    TEST_ASSERT_EQUAL_UINT32((i + 1) * 1000000, outputs[i].time);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 250.0f, outputs[i].speed);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 90.0f, outputs[i].direction);
+  }
+}
+
+void test_direction_across_north() {
+  Resampler resampler = make_resampler(1);
+  for (uint32_t t = 0; t <= 10000000; t += 100000) {
+    resampler.add(t, 100, ((t / 100000) % 2) ? 10 : 350);
+  }
+  float direction = outputs.back().direction;
+  if (direction > 180) direction -= 360;
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, 0.0f, direction);
+}
+
+void test_advance_through_calm() {
+  Resampler resampler = make_resampler(1);
+  resampler.add(0, 100, 45);
+  resampler.add(1000000, 100, 45);
+  resampler.advance(8100000, 1000000);
+  TEST_ASSERT_EQUAL(8, outputs.size());
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 100.0f, outputs[0].speed);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, outputs[7].speed);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 45.0f, outputs[7].direction);
+}
+
+// A revolution added after the time passed to advance() must not make the
+// zero samples run backwards or forever
+void test_advance_before_last_revolution() {
+  Resampler resampler = make_resampler(1);
+  resampler.add(0, 100, 45);
+  resampler.add(1500000, 100, 45);
+  resampler.advance(1400000, 1000000);
+  TEST_ASSERT_EQUAL(1, outputs.size());
+  resampler.add(2000000, 100, 45);
+  TEST_ASSERT_EQUAL(2, outputs.size());
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 100.0f, outputs[1].speed);
+}
+
+void test_older_sample_dropped() {
+  Resampler resampler = make_resampler(1);
+  resampler.add(0, 100, 45);
+  resampler.add(600000, 100, 45);
+  resampler.add(400000, 500, 45);
+  resampler.add(1000000, 100, 45);
+  TEST_ASSERT_EQUAL(1, outputs.size());
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 100.0f, outputs[0].speed);
+}
+
+// Amplitude of the output for a speed of 500 +- 100 cm/s at frequency hz,
+// with a revolution every 10 ms, from the RMS over 100 s once the filter has
+// settled
+static float amplitude(float hz) {
+  outputs.clear();
+  Resampler resampler = make_resampler(1);
+  for (uint32_t t = 0; t <= 120000000; t += 10000) {
+    resampler.add(t, 500 + 100 * sinf(2 * (float)M_PI * hz * t * 1e-6f), 0);
+  }
+  double sum = 0;
+  for (size_t i = 20; i < 120; i++) {
+    sum += (outputs[i].speed - 500.0) * (outputs[i].speed - 500.0);
+  }
+  return sqrt(2 * sum / 100);
+}
+
+void test_passband() {
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 100.0f, amplitude(0.01f));
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 91.5f, amplitude(0.1f));
+}
+
+// Gusts above half the output rate alias into the series. The boxcar alone
+// leaves 0.75 Hz at 30 cm/s, aliased to 0.25 Hz. The FIR's worst is the
+// image near 8 Hz, the sub-interval rate.
+void test_stopband_rejection() {
+  const float frequencies[] = {0.6f, 0.75f, 1.3f, 2.3f, 3.7f, 7.8f};
+  for (float hz : frequencies) {
+    float rejected = amplitude(hz);
+    char message[64];
+    snprintf(message, sizeof(message), "%.2f Hz: %.3f cm/s of 100 (%.0f dB)",
+             hz, rejected, 20 * log10f(rejected / 100));
+    TEST_MESSAGE(message);
+    // 34 dB
+    TEST_ASSERT_TRUE(rejected < 2.0f);
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_steady_wind);
+  RUN_TEST(test_direction_across_north);
+  RUN_TEST(test_advance_through_calm);
+  RUN_TEST(test_advance_before_last_revolution);
+  RUN_TEST(test_older_sample_dropped);
+  RUN_TEST(test_passband);
+  RUN_TEST(test_stopband_rejection);
+  return UNITY_END();
+}
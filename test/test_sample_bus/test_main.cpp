@@ -0,0 +1,134 @@
+#include <unity.h>
+
+#include "sample_bus.h"
+
+typedef SampleBus<uint32_t, 8> Bus;
+
+// Starts the record count where it is about to wrap around
+class WrappingBus : public Bus {
+ public:
+  explicit WrappingBus(uint32_t head) { head_ = head; }
+};
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_empty_until_published() {
+  Bus bus;
+  Bus::Reader reader;
+  bus.subscribe(&reader);
+  TEST_ASSERT_NULL(bus.read(&reader));
+  bus.publish(7);
+  const uint32_t* record = bus.read(&reader);
+  TEST_ASSERT_NOT_NULL(record);
+  TEST_ASSERT_EQUAL_UINT32(7, *record);
+  TEST_ASSERT_NULL(bus.read(&reader));
+  TEST_ASSERT_EQUAL_UINT32(1, bus.get_published());
+}
+
+void test_subscribe_skips_earlier_records() {
+  Bus bus;
+  Bus::Reader reader;
+  bus.publish(1);
+  bus.publish(2);
+  bus.subscribe(&reader);
+  bus.publish(3);
+  TEST_ASSERT_EQUAL_UINT32(3, *bus.read(&reader));
+  TEST_ASSERT_NULL(bus.read(&reader));
+}
+
+// Up to N - 1 records behind a reader misses nothing
+void test_reader_keeps_up_within_capacity() {
+  Bus bus;
+  Bus::Reader reader;
+  bus.subscribe(&reader);
+  for (uint32_t i = 0; i < 7; i++) bus.publish(i);
+  for (uint32_t i = 0; i < 7; i++) {
+    TEST_ASSERT_EQUAL_UINT32(i, *bus.read(&reader));
+  }
+  TEST_ASSERT_NULL(bus.read(&reader));
+  TEST_ASSERT_EQUAL_UINT32(0, reader.get_overruns());
+}
+
+// A lapped reader counts the records it missed and goes on with the oldest
+// record still in the ring, in order
+void test_lapped_reader_resyncs() {
+  Bus bus;
+  Bus::Reader reader;
+  bus.subscribe(&reader);
+  for (uint32_t i = 0; i < 20; i++) bus.publish(i);
+
+  for (uint32_t i = 13; i < 20; i++) {
+    TEST_ASSERT_EQUAL_UINT32(i, *bus.read(&reader));
+  }
+  TEST_ASSERT_NULL(bus.read(&reader));
+  TEST_ASSERT_EQUAL_UINT32(13, reader.get_overruns());
+
+  // Back in step, the count only grows when lapped again
+  bus.publish(20);
+  TEST_ASSERT_EQUAL_UINT32(20, *bus.read(&reader));
+  for (uint32_t i = 21; i < 31; i++) bus.publish(i);
+  TEST_ASSERT_EQUAL_UINT32(24, *bus.read(&reader));
+  TEST_ASSERT_EQUAL_UINT32(16, reader.get_overruns());
+}
+
+// A slow reader does not hold back the others
+void test_readers_independent() {
+  Bus bus;
+  Bus::Reader fast;
+  Bus::Reader slow;
+  bus.subscribe(&fast);
+  bus.subscribe(&slow);
+  for (uint32_t i = 0; i < 12; i++) {
+    bus.publish(i);
+    TEST_ASSERT_EQUAL_UINT32(i, *bus.read(&fast));
+  }
+  TEST_ASSERT_EQUAL_UINT32(5, *bus.read(&slow));
+  TEST_ASSERT_EQUAL_UINT32(0, fast.get_overruns());
+  TEST_ASSERT_EQUAL_UINT32(5, slow.get_overruns());
+
+  bus.subscribe(&slow);
+  TEST_ASSERT_EQUAL_UINT32(0, slow.get_overruns());
+  TEST_ASSERT_NULL(bus.read(&slow));
+}
+
+// A copy made in another task is good until the writer reaches its slot
+void test_still_valid_until_overwritten() {
+  Bus bus;
+  Bus::Reader reader;
+  bus.subscribe(&reader);
+  bus.publish(1);
+  bus.read(&reader);
+  for (uint32_t i = 0; i < 7; i++) {
+    TEST_ASSERT_TRUE(bus.still_valid(reader));
+    bus.publish(i);
+  }
+  TEST_ASSERT_FALSE(bus.still_valid(reader));
+}
+
+void test_record_count_wraps_around() {
+  WrappingBus bus(0xfffffffcu);
+  Bus::Reader reader;
+  bus.subscribe(&reader);
+  for (uint32_t i = 0; i < 12; i++) bus.publish(i);
+  TEST_ASSERT_EQUAL_UINT32(8, bus.get_published());
+  TEST_ASSERT_EQUAL_UINT32(5, *bus.read(&reader));
+  TEST_ASSERT_EQUAL_UINT32(5, reader.get_overruns());
+  for (uint32_t i = 6; i < 12; i++) {
+    TEST_ASSERT_EQUAL_UINT32(i, *bus.read(&reader));
+  }
+  TEST_ASSERT_NULL(bus.read(&reader));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_until_published);
+  RUN_TEST(test_subscribe_skips_earlier_records);
+  RUN_TEST(test_reader_keeps_up_within_capacity);
+  RUN_TEST(test_lapped_reader_resyncs);
+  RUN_TEST(test_readers_independent);
+  RUN_TEST(test_still_valid_until_overwritten);
+  RUN_TEST(test_record_count_wraps_around);
+  return UNITY_END();
+}
@@ -0,0 +1,145 @@
+#include <unity.h>
+
+#include "speed_table.h"
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_cleared_table_passes_speed() {
+  SpeedTable table;
+  for (int i = 0; i < SpeedTable::kPoints; i++) {
+    TEST_ASSERT_EQUAL_UINT16(1024, table.get(i));
+  }
+  TEST_ASSERT_EQUAL(1234, table.correct(1234, 10));
+  TEST_ASSERT_EQUAL(1234, table.correct(1234, 300));
+  TEST_ASSERT_EQUAL(1234, table.correct(1234, 100000));
+}
+
+void test_interpolates_between_points() {
+  SpeedTable table;
+  table.set(1, 1024);  // 100 rps/100
+  table.set(2, 1280);  // 200 rps/100
+  TEST_ASSERT_EQUAL(1000, table.correct(1000, 100));
+  TEST_ASSERT_EQUAL(1125, table.correct(1000, 150));
+  TEST_ASSERT_EQUAL(1250, table.correct(1000, 200));
+  // Falling from the raised point to the next
+  TEST_ASSERT_EQUAL(1125, table.correct(1000, 300));
+}
+
+// Below the first and above the last point the end scales hold
+void test_holds_scale_out_of_range() {
+  SpeedTable table;
+  table.set(0, 512);
+  table.set(SpeedTable::kPoints - 1, 2048);
+  TEST_ASSERT_EQUAL(500, table.correct(1000, SpeedTable::kRates[0]));
+  TEST_ASSERT_EQUAL(500, table.correct(1000, 1));
+  TEST_ASSERT_EQUAL(500, table.correct(1000, 0));
+  TEST_ASSERT_EQUAL(500, table.correct(1000, -5));
+  TEST_ASSERT_EQUAL(2000, table.correct(1000, 6400));
+  TEST_ASSERT_EQUAL(2000, table.correct(1000, 1000000));
+}
+
+void test_clear_resets_scales() {
+  SpeedTable table;
+  table.set(3, 900);
+  table.clear();
+  TEST_ASSERT_EQUAL_UINT16(1024, table.get(3));
+}
+
+void test_fit_needs_pairs() {
+  SpeedCalibrator calibrator;
+  SpeedTable table;
+  calibrator.start();
+  for (uint32_t i = 1; i < SpeedCalibrator::kMinPairs; i++) {
+    calibrator.add(10.0f, 11.0f, 400);
+  }
+  TEST_ASSERT_FALSE(calibrator.fit(&table));
+  TEST_ASSERT_EQUAL_UINT16(1024, table.get(3));
+}
+
+// A rotor reading 5% low everywhere gets a scale of 1.05 at every point
+void test_fit_known_scale() {
+  SpeedCalibrator calibrator;
+  SpeedTable table;
+  calibrator.start();
+  for (int i = 0; i < SpeedTable::kPoints; i++) {
+    for (uint32_t n = 0; n < SpeedCalibrator::kMinPairs; n++) {
+      float measured = 0.5f + 0.01f * SpeedTable::kRates[i] + 0.01f * n;
+      calibrator.add(measured, 1.05f * measured, SpeedTable::kRates[i]);
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(SpeedTable::kPoints * SpeedCalibrator::kMinPairs,
+                           calibrator.get_pairs());
+  TEST_ASSERT_TRUE(calibrator.fit(&table));
+  for (int i = 0; i < SpeedTable::kPoints; i++) {
+    TEST_ASSERT_UINT16_WITHIN(1, 1075, table.get(i));
+  }
+}
+
+// The fit refines the scales already in the table
+void test_fit_refines_table() {
+  SpeedCalibrator calibrator;
+  SpeedTable table;
+  for (int i = 0; i < SpeedTable::kPoints; i++) table.set(i, 2048);
+  calibrator.start();
+  for (uint32_t n = 0; n < SpeedCalibrator::kMinPairs; n++) {
+    calibrator.add(10.0f, 9.0f, 800);
+  }
+  TEST_ASSERT_TRUE(calibrator.fit(&table));
+  TEST_ASSERT_UINT16_WITHIN(1, 1843, table.get(4));
+}
+
+// Pairs go to the nearest point on the octave scale; points with too few
+// pairs, and the rates outside the table, take the fit over all pairs
+void test_fit_sparse_points() {
+  SpeedCalibrator calibrator;
+  SpeedTable table;
+  calibrator.start();
+  for (uint32_t n = 0; n < SpeedCalibrator::kMinPairs; n++) {
+    calibrator.add(10.0f, 12.0f, 560);   // Nearest 400
+    calibrator.add(10.0f, 8.0f, 590);    // Nearest 800
+  }
+  calibrator.add(10.0f, 20.0f, 1000000);  // Above the last point
+  calibrator.add(10.0f, 20.0f, 1);        // Below the first point
+  calibrator.add(10.0f, 20.0f, 0);        // Ignored, no rotation
+  calibrator.add(0.0f, 20.0f, 400);       // Ignored, no speed
+  TEST_ASSERT_EQUAL_UINT32(2 * SpeedCalibrator::kMinPairs + 2,
+                           calibrator.get_pairs());
+  TEST_ASSERT_TRUE(calibrator.fit(&table));
+
+  TEST_ASSERT_UINT16_WITHIN(1, 1229, table.get(3));
+  TEST_ASSERT_UINT16_WITHIN(1, 819, table.get(4));
+  // All pairs: (50 * 120 + 50 * 80 + 2 * 200) / (102 * 100)
+  uint16_t overall = (uint16_t)(1024.0f * 10400.0f / 10200.0f + 0.5f);
+  TEST_ASSERT_UINT16_WITHIN(1, overall, table.get(0));
+  TEST_ASSERT_UINT16_WITHIN(1, overall, table.get(SpeedTable::kPoints - 1));
+}
+
+// Scales are clamped to what the table can hold
+void test_fit_clamps_scale() {
+  SpeedCalibrator calibrator;
+  SpeedTable table;
+  calibrator.start();
+  for (uint32_t n = 0; n < SpeedCalibrator::kMinPairs; n++) {
+    calibrator.add(1.0f, 100.0f, 100);
+    calibrator.add(1.0f, 0.0f, 3200);
+  }
+  TEST_ASSERT_TRUE(calibrator.fit(&table));
+  TEST_ASSERT_EQUAL_UINT16(65535, table.get(1));
+  TEST_ASSERT_EQUAL_UINT16(1, table.get(6));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_cleared_table_passes_speed);
+  RUN_TEST(test_interpolates_between_points);
+  RUN_TEST(test_holds_scale_out_of_range);
+  RUN_TEST(test_clear_resets_scales);
+  RUN_TEST(test_fit_needs_pairs);
+  RUN_TEST(test_fit_known_scale);
+  RUN_TEST(test_fit_refines_table);
+  RUN_TEST(test_fit_sparse_points);
+  RUN_TEST(test_fit_clamps_scale);
+  return UNITY_END();
+}
@@ -0,0 +1,120 @@
+#include <unity.h>
+
+#include "anemometer_model.h"
+#include "pulse_counter.h"
+#include "storm_guard.h"
+
+// As checkStorm() in main.cpp
+static const uint32_t kWindow = 100;  // ms
+static const uint16_t kRearmWindows = 30;
+
+/**
+ * The storm guard of a WindLimits model, fed the edges a pulse counter
+ * counts in each window, like checkStorm().
+ */
+class StormSimulation {
+ public:
+  StormSimulation()
+      : counter_(4, PCNT_UNIT_0),
+        guard_(WindLimits::kStormRate, WindLimits::kSaneRate,
+               kRearmWindows) {
+    mock_pcnt_reset();
+    counter_.begin();
+  }
+
+  /**
+   * Feed rate edges/s for the given number of windows.
+   *
+   * @return The window the storm state first changed in, -1 if it did not
+   */
+  int run(float rate, int windows) {
+    int changed = -1;
+    for (int i = 0; i < windows; i++) {
+      due_ += rate * kWindow / 1000.0f;
+      while (due_ >= 1.0f) {
+        mock_pcnt_pulse(PCNT_UNIT_0, false);
+        due_ -= 1.0f;
+      }
+      if (guard_.update(counter_.read_delta(), kWindow) && (changed < 0)) {
+        changed = i;
+      }
+    }
+    return changed;
+  }
+
+  StormGuard& guard() { return guard_; }
+
+ protected:
+  PulseCounter counter_;
+  StormGuard guard_;
+  float due_ = 0.0f;
+};
+
+void setUp() {}
+
+void tearDown() {}
+
+// A reed switch at the highest plausible speed, bouncing twice per pulse
+void test_bouncing_gale_is_no_storm() {
+  StormSimulation sim;
+  TEST_ASSERT_EQUAL_INT(-1, sim.run(3 * WindLimits::kSaneRate, 600));
+  TEST_ASSERT_FALSE(sim.guard().in_storm());
+}
+
+// A chafed cable oscillating at 2 kHz is caught in its first window
+void test_oscillation_detected_at_once() {
+  StormSimulation sim;
+  sim.run(20.0f, 50);
+  TEST_ASSERT_EQUAL_INT(0, sim.run(2000.0f, 10));
+  TEST_ASSERT_TRUE(sim.guard().in_storm());
+  TEST_ASSERT_EQUAL_UINT32(1, sim.guard().get_storm_count());
+}
+
+void test_rearmed_after_sane_windows() {
+  StormSimulation sim;
+  sim.run(2000.0f, 10);
+  TEST_ASSERT_EQUAL_INT(kRearmWindows - 1, sim.run(20.0f, 100));
+  TEST_ASSERT_FALSE(sim.guard().in_storm());
+}
+
+// A wet connector that oscillates in bursts keeps the interrupts masked,
+// as one storm
+void test_bursts_keep_storm() {
+  StormSimulation sim;
+  for (int i = 0; i < 20; i++) {
+    sim.run(2000.0f, 1);
+    sim.run(20.0f, kRearmWindows - 5);
+  }
+  TEST_ASSERT_TRUE(sim.guard().in_storm());
+  TEST_ASSERT_EQUAL_UINT32(1, sim.guard().get_storm_count());
+}
+
+// Between the sane and the storm rate the state is kept either way
+void test_hysteresis() {
+  StormSimulation sim;
+  float between = (WindLimits::kSaneRate + WindLimits::kStormRate) / 2.0f;
+  TEST_ASSERT_EQUAL_INT(-1, sim.run(between, 100));
+  sim.run(2000.0f, 1);
+  TEST_ASSERT_EQUAL_INT(-1, sim.run(between, 100));
+  TEST_ASSERT_TRUE(sim.guard().in_storm());
+}
+
+void test_storms_counted() {
+  StormSimulation sim;
+  for (int i = 0; i < 3; i++) {
+    sim.run(2000.0f, 5);
+    sim.run(0.0f, kRearmWindows);
+  }
+  TEST_ASSERT_EQUAL_UINT32(3, sim.guard().get_storm_count());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bouncing_gale_is_no_storm);
+  RUN_TEST(test_oscillation_detected_at_once);
+  RUN_TEST(test_rearmed_after_sane_windows);
+  RUN_TEST(test_bursts_keep_storm);
+  RUN_TEST(test_hysteresis);
+  RUN_TEST(test_storms_counted);
+  return UNITY_END();
+}
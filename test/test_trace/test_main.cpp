@@ -0,0 +1,254 @@
+// The tracer is compiled into this test only, the other builds leave the
+// TRACE_ macros empty
+#define TRACE_ENABLED
+#define TRACE_EVENTS 64
+
+#include <unity.h>
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "trace.cpp"
+
+/**
+ * A minimal JSON parser, just enough to validate the dump: checks the syntax
+ * and collects the members of the trace events.
+ */
+class JsonChecker {
+ public:
+  struct Event {
+    std::string name;
+    std::string ph;
+    double ts;
+    int tid;
+  };
+
+  explicit JsonChecker(const std::string& text) : s_(text) {}
+
+  bool parse() {
+    pos_ = 0;
+    if (!value(0)) return false;
+    skip_space();
+    return pos_ == s_.size();
+  }
+
+  std::vector<Event> events;
+
+ protected:
+  void skip_space() {
+    while ((pos_ < s_.size()) && isspace((unsigned char)s_[pos_])) pos_++;
+  }
+
+  bool literal(const char* text) {
+    size_t n = strlen(text);
+    if (s_.compare(pos_, n, text) != 0) return false;
+    pos_ += n;
+    return true;
+  }
+
+  bool string(std::string* out) {
+    if (!literal("\"")) return false;
+    out->clear();
+    while ((pos_ < s_.size()) && (s_[pos_] != '"')) {
+      if ((s_[pos_] == '\\') || ((unsigned char)s_[pos_] < 0x20)) {
+        return false;  // Not produced by the dump
+      }
+      out->push_back(s_[pos_++]);
+    }
+    return literal("\"");
+  }
+
+  bool number(double* out) {
+    const char* start = s_.c_str() + pos_;
+    char* end;
+    *out = strtod(start, &end);
+    if (end == start) return false;
+    pos_ += end - start;
+    return true;
+  }
+
+  // depth 2 is an event object in the traceEvents array
+  bool value(int depth) {
+    skip_space();
+    if (pos_ >= s_.size()) return false;
+    char c = s_[pos_];
+    if (c == '{') return object(depth);
+    if (c == '[') {
+      pos_++;
+      skip_space();
+      if (literal("]")) return true;
+      do {
+        if (!value(depth + 1)) return false;
+        skip_space();
+      } while (literal(","));
+      return literal("]");
+    }
+    if (c == '"') {
+      std::string text;
+      return string(&text);
+    }
+    double number_value;
+    return number(&number_value);
+  }
+
+  bool object(int depth) {
+    pos_++;
+    Event event = {"", "", -1, -1};
+    skip_space();
+    if (!literal("}")) {
+      do {
+        skip_space();
+        std::string key;
+        if (!string(&key)) return false;
+        skip_space();
+        if (!literal(":")) return false;
+        skip_space();
+        size_t start = pos_;
+        if (!value(depth + 1)) return false;
+        if (depth == 2) {
+          std::string raw = s_.substr(start, pos_ - start);
+          if (key == "name") event.name = raw.substr(1, raw.size() - 2);
+          if (key == "ph") event.ph = raw.substr(1, raw.size() - 2);
+          if (key == "ts") event.ts = atof(raw.c_str());
+          if (key == "tid") event.tid = atoi(raw.c_str());
+        }
+        skip_space();
+      } while (literal(","));
+      if (!literal("}")) return false;
+    }
+    if (depth == 2) events.push_back(event);
+    return true;
+  }
+
+  std::string s_;
+  size_t pos_ = 0;
+};
+
+// The whole dump, read in pieces of chunk bytes. Not JSON if it is busy.
+static std::string dump(size_t chunk) {
+  std::string out;
+  uint8_t buffer[512];
+  if (!Tracer::start_dump()) return out;
+  size_t n;
+  while ((n = Tracer::read_dump(buffer, chunk)) > 0) {
+    out.append((const char*)buffer, n);
+  }
+  return out;
+}
+
+// The ring is not consumed by a dump, each test starts it empty
+class TestTracer : public Tracer {
+ public:
+  static void clear() { head_ = 0; }
+};
+
+// A pass through two stages, cycles apart
+static void record_pass(uint32_t cycles) {
+  TRACE_INSTANT("Revolution", 7);
+  {
+    TRACE_SCOPE("CalibrateSpeed");
+    mock_cycles += cycles;
+  }
+  {
+    TRACE_SCOPE("FilterSpeed");
+    mock_cycles += cycles;
+  }
+}
+
+void setUp() {
+  TestTracer::clear();
+  mock_cycles = 0;
+  mock_core = 1;
+}
+
+void tearDown() {}
+
+void test_dump_is_valid_json() {
+  record_pass(240);
+  JsonChecker json(dump(512));
+  TEST_ASSERT_TRUE(json.parse());
+  TEST_ASSERT_EQUAL(5, json.events.size());
+  TEST_ASSERT_EQUAL_STRING("Revolution", json.events[0].name.c_str());
+  TEST_ASSERT_EQUAL_STRING("i", json.events[0].ph.c_str());
+  TEST_ASSERT_EQUAL_STRING("B", json.events[1].ph.c_str());
+  TEST_ASSERT_EQUAL_STRING("E", json.events[2].ph.c_str());
+  TEST_ASSERT_EQUAL(1, json.events[1].tid);
+  // 240 cycles at 240 MHz
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 1.0, json.events[2].ts - json.events[1].ts);
+}
+
+void test_empty_dump_is_valid_json() {
+  std::string text = dump(512);
+  JsonChecker json(text);
+  TEST_ASSERT_TRUE(json.parse());
+  TEST_ASSERT_EQUAL(0, json.events.size());
+}
+
+// The web server asks for pieces of any size
+void test_chunked_dump_equals_whole() {
+  record_pass(100);
+  record_pass(100);
+  std::string whole = dump(512);
+  TEST_ASSERT_EQUAL_STRING(whole.c_str(), dump(7).c_str());
+}
+
+void test_scopes_balanced_and_ordered() {
+  for (int i = 0; i < 5; i++) record_pass(1000 + i);
+  JsonChecker json(dump(512));
+  TEST_ASSERT_TRUE(json.parse());
+  int open = 0;
+  double last = -1;
+  for (const JsonChecker::Event& event : json.events) {
+    if (event.ph == "B") open++;
+    if (event.ph == "E") open--;
+    TEST_ASSERT_TRUE((open == 0) || (open == 1));
+    TEST_ASSERT_TRUE(event.ts >= last);
+    last = event.ts;
+  }
+  TEST_ASSERT_EQUAL(0, open);
+}
+
+// The 32 bit cycle counter wraps every 18 s at 240 MHz
+void test_cycle_counter_wrap() {
+  mock_cycles = 0xffffff00u;
+  record_pass(0x100);
+  JsonChecker json(dump(512));
+  TEST_ASSERT_TRUE(json.parse());
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 2 * 256 / 240.0,
+                           json.events[4].ts - json.events[0].ts);
+}
+
+// A full ring keeps the newest events, and the dump stays valid
+void test_ring_overflow() {
+  for (int i = 0; i < 30; i++) record_pass(10);
+  JsonChecker json(dump(512));
+  TEST_ASSERT_TRUE(json.parse());
+  TEST_ASSERT_EQUAL(Tracer::kEvents, json.events.size());
+  TEST_ASSERT_EQUAL_STRING("FilterSpeed", json.events.back().name.c_str());
+  TEST_ASSERT_EQUAL_STRING("E", json.events.back().ph.c_str());
+}
+
+void test_no_recording_while_dumping() {
+  record_pass(10);
+  TEST_ASSERT_TRUE(Tracer::start_dump());
+  TEST_ASSERT_FALSE(Tracer::start_dump());
+  record_pass(10);
+  Tracer::end_dump();
+  JsonChecker json(dump(512));
+  TEST_ASSERT_TRUE(json.parse());
+  TEST_ASSERT_EQUAL(5, json.events.size());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_dump_is_valid_json);
+  RUN_TEST(test_empty_dump_is_valid_json);
+  RUN_TEST(test_chunked_dump_equals_whole);
+  RUN_TEST(test_scopes_balanced_and_ordered);
+  RUN_TEST(test_cycle_counter_wrap);
+  RUN_TEST(test_ring_overflow);
+  RUN_TEST(test_no_recording_while_dumping);
+  return UNITY_END();
+}
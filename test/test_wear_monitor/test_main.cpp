@@ -0,0 +1,123 @@
+#include <unity.h>
+
+#include <stdlib.h>
+
+#include "wear_monitor.h"
+
+// Steady windows of 5 rev/s with the given relative jitter, and stalls at
+// the given rotor rate
+static void learn(WearMonitor& monitor, int windows, float jitter,
+                  int stalls, float stall_rate) {
+  for (int i = 0; i < windows * WearMonitor::kWindow; i++) {
+    float noise = jitter * ((rand() % 2001) - 1000) / 1000.0f;
+    monitor.add_period((uint32_t)(200000 * (1 + noise)));
+  }
+  for (int i = 0; i < stalls; i++) {
+    monitor.add_stall((uint32_t)(1000000 / stall_rate));
+  }
+}
+
+static void learn_baseline(WearMonitor& monitor) {
+  learn(monitor, WearMonitor::kBaselineWindows, 0.01f,
+        WearMonitor::kBaselineStalls, 0.5f);
+}
+
+void setUp() { srand(1); }
+
+void tearDown() {}
+
+void test_index_zero_while_learning() {
+  WearMonitor monitor;
+  learn(monitor, 10, 0.01f, 5, 0.5f);
+  TEST_ASSERT_EQUAL(0, monitor.get_wear_index());
+}
+
+void test_index_as_new() {
+  WearMonitor monitor;
+  learn_baseline(monitor);
+  TEST_ASSERT_FLOAT_WITHIN(0.1, 1.0, monitor.get_wear_index());
+}
+
+void test_index_rises_with_stall_rate() {
+  WearMonitor monitor;
+  learn_baseline(monitor);
+  learn(monitor, 0, 0, 200, 1.0f);
+  TEST_ASSERT_FLOAT_WITHIN(0.1, 2.0, monitor.get_wear_index());
+}
+
+// Before, the current values restarted from 0 and the index read 0 or
+// the bare jitter ratio after a restart
+void test_history_restores_the_index() {
+  WearMonitor monitor;
+  learn_baseline(monitor);
+  learn(monitor, 0, 0, 200, 0.8f);
+  float index = monitor.get_wear_index();
+
+  WearMonitor restarted;
+  restarted.set_baseline(monitor.get_baseline());
+  restarted.set_history(monitor.get_history());
+  TEST_ASSERT_FLOAT_WITHIN(0.001, index, restarted.get_wear_index());
+}
+
+void test_baseline_only_suppresses_the_index() {
+  WearMonitor monitor;
+  learn_baseline(monitor);
+
+  WearMonitor restarted;
+  restarted.set_baseline(monitor.get_baseline());
+  TEST_ASSERT_EQUAL(0, restarted.get_wear_index());
+}
+
+void test_days_are_operating_time() {
+  WearMonitor monitor;
+  learn_baseline(monitor);
+  monitor.add_time(WearMonitor::kDay - 60);
+  TEST_ASSERT_EQUAL(0, monitor.get_history().days);
+  monitor.add_time(60);
+  TEST_ASSERT_EQUAL(1, monitor.get_history().days);
+}
+
+void test_trend_of_rising_wear() {
+  WearMonitor monitor;
+  learn_baseline(monitor);
+  // The stall rate grows by 2 % of the baseline per day
+  for (int day = 0; day < 20; day++) {
+    learn(monitor, 0, 0, 200, 0.5f * (1 + 0.02f * day));
+    monitor.add_time(WearMonitor::kDay);
+  }
+  TEST_ASSERT_FLOAT_WITHIN(0.002, 0.02, monitor.get_trend());
+  // From 1.38 to 1.5
+  TEST_ASSERT_FLOAT_WITHIN(1.0, 6.0, monitor.days_until(1.5f));
+}
+
+void test_no_trend_when_steady() {
+  WearMonitor monitor;
+  learn_baseline(monitor);
+  for (int day = 0; day < 20; day++) monitor.add_time(WearMonitor::kDay);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 0, monitor.get_trend());
+  TEST_ASSERT_TRUE(monitor.days_until(1.5f) < 0);
+}
+
+void test_trend_needs_days() {
+  WearMonitor monitor;
+  learn_baseline(monitor);
+  for (int day = 0; day < WearMonitor::kMinTrendDays - 1; day++) {
+    learn(monitor, 0, 0, 200, 0.5f * (1 + 0.1f * day));
+    monitor.add_time(WearMonitor::kDay);
+  }
+  TEST_ASSERT_EQUAL(0, monitor.get_trend());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_index_zero_while_learning);
+  RUN_TEST(test_index_as_new);
+  RUN_TEST(test_index_rises_with_stall_rate);
+  RUN_TEST(test_history_restores_the_index);
+  RUN_TEST(test_baseline_only_suppresses_the_index);
+  RUN_TEST(test_days_are_operating_time);
+  RUN_TEST(test_trend_of_rising_wear);
+  RUN_TEST(test_no_trend_when_steady);
+  RUN_TEST(test_trend_needs_days);
+  return UNITY_END();
+}
@@ -0,0 +1,78 @@
+#include <unity.h>
+
+#include <math.h>
+#include <string.h>
+
+#include "wind_rose.h"
+
+static const int kCells = WindRose::kSectors * WindRose::kSpeedBins;
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_sector_and_bin() {
+  WindRose rose(3600);
+  rose.add(250, 95, 2);    // East, 2 to 4 m/s
+  rose.add(2000, 355, 1);  // North, above 17 m/s
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 2.0, rose.get(4, 1));
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 1.0, rose.get(0, 7));
+}
+
+// A day of 10 Hz samples into one cell decays another to e^-1, and sums to
+// the closed form of the decayed integral
+void test_day_rose_decay() {
+  const double tau = 86400;
+  const double dt = 0.1;
+  WindRose rose(tau);
+  float cells[kCells] = {};
+  cells[0] = 1.0f;
+  rose.import_cells(cells);
+
+  const long steps = lround(tau / dt);
+  for (long i = 0; i < steps; i++) rose.add(500, 90, dt);
+
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, exp(-1.0), rose.get(0, 0));
+  // dt * sum of e^(-k dt / tau) for k = 0 to steps - 1
+  double expected = dt * (1 - exp(-1.0)) / (1 - exp(-dt / tau));
+  TEST_ASSERT_FLOAT_WITHIN(expected * 1e-4, expected, rose.get(4, 2));
+}
+
+// Past the renormalization the rose settles at tau of the same sample
+void test_renormalized_steady_state() {
+  const double tau = 10;
+  WindRose rose(tau);
+  for (int i = 0; i < 100 * 10 * 30; i++) rose.add(500, 180, 0.01f);
+  double expected = 0.01 / (1 - exp(-0.01 / tau));
+  TEST_ASSERT_FLOAT_WITHIN(expected * 1e-4, expected, rose.get(8, 2));
+}
+
+void test_export_import() {
+  WindRose rose(3600);
+  rose.add(900, 45, 10);
+  float cells[kCells];
+  rose.export_cells(cells);
+  WindRose restored(3600);
+  restored.import_cells(cells);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, rose.get(2, 4), restored.get(2, 4));
+}
+
+void test_json() {
+  WindRose rose(3600);
+  rose.add(0, 0, 3);
+  char json[1024];
+  size_t length = rose.to_json(json, sizeof(json));
+  TEST_ASSERT_EQUAL(strlen(json), length);
+  TEST_ASSERT_EQUAL_STRING_LEN("[[3,0,0,0,0,0,0,0],[0,", json, 22);
+  TEST_ASSERT_EQUAL(']', json[length - 1]);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_sector_and_bin);
+  RUN_TEST(test_day_rose_decay);
+  RUN_TEST(test_renormalized_steady_state);
+  RUN_TEST(test_export_import);
+  RUN_TEST(test_json);
+  return UNITY_END();
+}
@@ -0,0 +1,132 @@
+#include <unity.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+#include "wind_snapshot.h"
+
+// Serialize like updateWindSnapshot(), the timestamp after the compared part
+static bool update(WindSnapshot& snapshot, float speed, float angle,
+                   unsigned long millis) {
+  char* json = snapshot.begin_update();
+  int compared = snprintf(json, WindSnapshot::kSize,
+                          "{\"speedApparent\":%.2f,\"angleApparent\":%.4f,",
+                          speed, angle);
+  int length = snprintf(json + compared, WindSnapshot::kSize - compared,
+                        "\"millis\":%lu}", millis);
+  return snapshot.commit(compared + length, compared);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_empty_before_first_commit() {
+  WindSnapshot snapshot;
+  char json[WindSnapshot::kSize];
+  uint32_t version;
+  TEST_ASSERT_EQUAL(0, snapshot.read(json, &version));
+  TEST_ASSERT_EQUAL_UINT32(0, version);
+}
+
+void test_read_returns_committed() {
+  WindSnapshot snapshot;
+  TEST_ASSERT_TRUE(update(snapshot, 5.25f, 1.5708f, 1000));
+
+  char json[WindSnapshot::kSize];
+  uint32_t version;
+  size_t length = snapshot.read(json, &version);
+  json[length] = '\0';
+  TEST_ASSERT_EQUAL_STRING(
+      "{\"speedApparent\":5.25,\"angleApparent\":1.5708,\"millis\":1000}",
+      json);
+  TEST_ASSERT_EQUAL_UINT32(1, version);
+}
+
+void test_timestamp_alone_keeps_version() {
+  WindSnapshot snapshot;
+  update(snapshot, 5.25f, 1.5708f, 1000);
+  for (unsigned long t = 1100; t < 2000; t += 100) {
+    TEST_ASSERT_FALSE(update(snapshot, 5.25f, 1.5708f, t));
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, snapshot.get_version());
+
+  // The front keeps the time of the sample that changed the wind
+  char json[WindSnapshot::kSize];
+  uint32_t version;
+  json[snapshot.read(json, &version)] = '\0';
+  TEST_ASSERT_NOT_NULL(strstr(json, "\"millis\":1000}"));
+}
+
+void test_wind_change_bumps_version() {
+  WindSnapshot snapshot;
+  update(snapshot, 5.25f, 1.5708f, 1000);
+  TEST_ASSERT_TRUE(update(snapshot, 5.30f, 1.5708f, 1100));
+  TEST_ASSERT_TRUE(update(snapshot, 5.30f, 1.6000f, 1200));
+  TEST_ASSERT_EQUAL_UINT32(3, snapshot.get_version());
+}
+
+void test_whole_snapshot_compared_by_default() {
+  WindSnapshot snapshot;
+  strcpy(snapshot.begin_update(), "abc");
+  TEST_ASSERT_TRUE(snapshot.commit(3));
+  strcpy(snapshot.begin_update(), "abc");
+  TEST_ASSERT_FALSE(snapshot.commit(3));
+  strcpy(snapshot.begin_update(), "abd");
+  TEST_ASSERT_TRUE(snapshot.commit(3));
+}
+
+// The work of a /wind request without the network: copy the snapshot, form
+// the ETag and match it against If-None-Match, against serializing the wind
+// for every request
+void test_benchmark_requests() {
+  const int n = 1000000;
+  WindSnapshot snapshot;
+  update(snapshot, 5.25f, 1.5708f, 1000);
+  const uint32_t nonce = 0x5eed1234;
+  char client_etag[24];
+  snprintf(client_etag, sizeof(client_etag), "\"%08x-%u\"", (unsigned)nonce,
+           (unsigned)snapshot.get_version());
+  volatile size_t sink = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < n; i++) {
+    char json[WindSnapshot::kSize];
+    uint32_t version;
+    size_t length = snapshot.read(json, &version);
+    char etag[24];
+    snprintf(etag, sizeof(etag), "\"%08x-%u\"", (unsigned)nonce,
+             (unsigned)version);
+    sink = sink + ((strcmp(etag, client_etag) == 0) ? 0 : length);
+  }
+  auto cached = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < n; i++) {
+    char json[WindSnapshot::kSize];
+    sink = sink + snprintf(json, sizeof(json),
+                           "{\"speedApparent\":%.2f,\"angleApparent\":%.4f,"
+                           "\"millis\":%lu}",
+                           5.25, 1.5708, 1000ul + i);
+  }
+  auto serialized = std::chrono::steady_clock::now() - start;
+
+  char message[128];
+  snprintf(message, sizeof(message),
+           "/wind: %.0f requests/s from the snapshot, %.0f serializing each",
+           n / std::chrono::duration<double>(cached).count(),
+           n / std::chrono::duration<double>(serialized).count());
+  TEST_MESSAGE(message);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_before_first_commit);
+  RUN_TEST(test_read_returns_committed);
+  RUN_TEST(test_timestamp_alone_keeps_version);
+  RUN_TEST(test_wind_change_bumps_version);
+  RUN_TEST(test_whole_snapshot_compared_by_default);
+  RUN_TEST(test_benchmark_requests);
+  return UNITY_END();
+}
@@ -0,0 +1,108 @@
+#include <unity.h>
+
+#include "write_behind.h"
+
+static const unsigned long kQuiet = 2000;
+static const unsigned long kMax = 10000;
+static const unsigned long kMaxRetry = 300000;
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_idle_not_due() {
+  WriteBehind write_behind(kQuiet, kMax, kMaxRetry);
+  TEST_ASSERT_FALSE(write_behind.is_due(0, false));
+  TEST_ASSERT_FALSE(write_behind.is_due(1000000, false));
+}
+
+void test_due_once_quiet() {
+  WriteBehind write_behind(kQuiet, kMax, kMaxRetry);
+  write_behind.mark(1000);
+  TEST_ASSERT_FALSE(write_behind.is_due(1000 + kQuiet - 1, true));
+  TEST_ASSERT_TRUE(write_behind.is_due(1000 + kQuiet, true));
+}
+
+// Edits every 500 ms coalesce until max_ms after the first one
+void test_burst_coalesced() {
+  WriteBehind write_behind(kQuiet, kMax, kMaxRetry);
+  unsigned long now = 1000;
+  int writes = 0;
+  for (; now < 1000 + 3 * kMax; now += 100) {
+    if (now % 500 == 0) write_behind.mark(now);
+    if (write_behind.is_due(now, true)) {
+      TEST_ASSERT_EQUAL_UINT32(1000 + kMax, now);
+      write_behind.take();
+      write_behind.written(true, now);
+      writes++;
+      break;
+    }
+  }
+  TEST_ASSERT_EQUAL(1, writes);
+}
+
+void test_written_not_due() {
+  WriteBehind write_behind(kQuiet, kMax, kMaxRetry);
+  write_behind.mark(1000);
+  write_behind.take();
+  write_behind.written(true, 3000);
+  TEST_ASSERT_FALSE(write_behind.is_due(3000 + kMaxRetry, false));
+  TEST_ASSERT_FALSE(write_behind.has_failed());
+}
+
+// A failed write is retried without a new mark, backing off up to max_retry_ms
+void test_failed_write_retried() {
+  WriteBehind write_behind(kQuiet, kMax, kMaxRetry);
+  write_behind.mark(1000);
+  write_behind.take();
+  unsigned long now = 3000;
+  write_behind.written(false, now);
+  TEST_ASSERT_TRUE(write_behind.has_failed());
+
+  unsigned long wait = kQuiet;
+  for (int i = 0; i < 12; i++) {
+    TEST_ASSERT_EQUAL_UINT32(wait, write_behind.get_retry_ms());
+    TEST_ASSERT_FALSE(write_behind.is_due(now + wait - 1, true));
+    TEST_ASSERT_TRUE(write_behind.is_due(now + wait, true));
+    now += wait;
+    write_behind.take();
+    write_behind.written(false, now);
+    wait = (wait * 2 < kMaxRetry) ? wait * 2 : kMaxRetry;
+  }
+  TEST_ASSERT_EQUAL_UINT32(kMaxRetry, write_behind.get_retry_ms());
+
+  // Success ends the retries and resets the backoff
+  write_behind.written(true, now);
+  TEST_ASSERT_FALSE(write_behind.is_due(now + kMaxRetry, false));
+  TEST_ASSERT_EQUAL_UINT32(kQuiet, write_behind.get_retry_ms());
+}
+
+// A change while retrying is written with the coalescing window, not the backoff
+void test_mark_while_failing() {
+  WriteBehind write_behind(kQuiet, kMax, kMaxRetry);
+  unsigned long now = 0;
+  for (int i = 0; i < 6; i++) {
+    now += write_behind.get_retry_ms();
+    write_behind.written(false, now);
+  }
+  write_behind.mark(now + 100);
+  TEST_ASSERT_TRUE(write_behind.is_due(now + 100 + kQuiet, true));
+}
+
+// Settings taken over from their own files at boot are dirty without a mark
+void test_dirty_without_mark() {
+  WriteBehind write_behind(kQuiet, kMax, kMaxRetry);
+  TEST_ASSERT_TRUE(write_behind.is_due(kQuiet, true));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_idle_not_due);
+  RUN_TEST(test_due_once_quiet);
+  RUN_TEST(test_burst_coalesced);
+  RUN_TEST(test_written_not_due);
+  RUN_TEST(test_failed_write_retried);
+  RUN_TEST(test_mark_while_failing);
+  RUN_TEST(test_dirty_without_mark);
+  return UNITY_END();
+}
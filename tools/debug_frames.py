@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+"""Decode the binary debug frames of the firmware, and optionally plot them.
+
+Enable "Debug Output Binary" in the settings, then read the serial port or a
+capture of it:
+
+    tools/debug_frames.py /dev/ttyUSB0 > debug.csv
+    tools/debug_frames.py capture.bin --plot spd_adj dir_adj
+
+A frame is 0xA5 0x5A, the field count n, n little-endian int32 values and a
+checksum, the sum of the count and value bytes modulo 256 (see
+src/debug_telemetry.h). The values are the fields times 10^decimals. The
+frames carry no names, so FIELDS must list the fields of printDebug() in
+main.cpp in their order; a frame with another field count is printed with
+numbered columns.
+"""
+
+import argparse
+import struct
+import sys
+
+SYNC = b"\xa5\x5a"
+
+# Name and decimals of each field, in the order printDebug() adds them
+FIELDS = [
+    ("f_g", 3),
+    ("d_o", 0),
+    ("dir_raw", 0),
+    ("dir_adj", 4),
+    ("spd_raw", 0),
+    ("spd_adj", 2),
+    ("gust_us", 0),
+    ("bus_ovr_sk", 0),
+    ("bus_ovr_rec", 0),
+    ("bus_ovr_gust", 0),
+    ("dbg_drop", 0),
+    ("rps", 0),
+]
+
+
+class FrameDecoder:
+    """Finds the frames in a byte stream, resynchronizing after garbage."""
+
+    def __init__(self):
+        self.buffer = bytearray()
+        self.bad_checksums = 0
+        self.skipped_bytes = 0
+
+    def feed(self, data):
+        """Add received bytes, return the value lists of the complete frames."""
+        self.buffer += data
+        frames = []
+        while True:
+            start = self.buffer.find(SYNC)
+            if start < 0:
+                # Keep a trailing first sync byte, the second may follow
+                keep = 1 if self.buffer[-1:] == SYNC[:1] else 0
+                self.skipped_bytes += len(self.buffer) - keep
+                del self.buffer[: len(self.buffer) - keep]
+                return frames
+            self.skipped_bytes += start
+            del self.buffer[:start]
+            if len(self.buffer) < 3:
+                return frames
+            count = self.buffer[2]
+            size = 3 + 4 * count + 1
+            if len(self.buffer) < size:
+                return frames
+            body = self.buffer[2 : size - 1]
+            if (sum(body) & 0xFF) != self.buffer[size - 1]:
+                # Not a frame after all, look for the next sync
+                self.bad_checksums += 1
+                self.skipped_bytes += 1
+                del self.buffer[:1]
+                continue
+            frames.append(list(struct.unpack("<%di" % count, bytes(body[1:]))))
+            del self.buffer[:size]
+
+
+def scale(values):
+    """The field values in their units, with the names of the columns."""
+    if len(values) == len(FIELDS):
+        names = [name for name, _ in FIELDS]
+        return names, [v / 10**d for v, (_, d) in zip(values, FIELDS)]
+    return ["field%d" % i for i in range(len(values))], values
+
+
+def open_input(path, baud):
+    if path == "-":
+        return sys.stdin.buffer
+    if path.startswith("/dev/") or path.upper().startswith("COM"):
+        import serial  # pyserial, only needed for a live port
+
+        return serial.Serial(path, baud, timeout=0.1)
+    return open(path, "rb")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("input", help="serial port, capture file or - for stdin")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument(
+        "--plot", nargs="*", metavar="FIELD",
+        help="plot these fields (all if none given) when the input ends or on Ctrl-C")
+    args = parser.parse_args()
+
+    decoder = FrameDecoder()
+    header = None
+    rows = []
+    source = open_input(args.input, args.baud)
+    try:
+        while True:
+            data = source.read(256)
+            if not data:
+                if hasattr(source, "in_waiting"):
+                    continue  # A port timeout, keep reading
+                break
+            for values in decoder.feed(data):
+                names, scaled = scale(values)
+                if names != header:
+                    header = names
+                    print(",".join(header))
+                print(",".join("%g" % v for v in scaled))
+                if args.plot is not None:
+                    rows.append(dict(zip(names, scaled)))
+    except KeyboardInterrupt:
+        pass
+
+    print("%d bytes skipped, %d bad checksums"
+          % (decoder.skipped_bytes, decoder.bad_checksums), file=sys.stderr)
+
+    if args.plot is not None and rows:
+        import matplotlib.pyplot as plt
+
+        fields = args.plot or list(rows[-1].keys())
+        figure, axes = plt.subplots(len(fields), 1, sharex=True, squeeze=False)
+        for axis, field in zip(axes[:, 0], fields):
+            axis.plot([row.get(field) for row in rows])
+            axis.set_ylabel(field)
+        axes[-1, 0].set_xlabel("record")
+        figure.tight_layout()
+        plt.show()
+
+
+if __name__ == "__main__":
+    main()